@@ -0,0 +1,79 @@
+#ifndef __BITBOARD_H__
+#define __BITBOARD_H__
+
+#include <stdint.h>
+
+namespace baxter_tictactoe
+{
+
+/**
+ * A set of cells of the board: bit i is cell i (from 0 to 8, row by row).
+ */
+typedef uint16_t BitMask;
+
+#define BOARD_MASK  0x1FF   // all the cells of the board
+
+/**
+ * The eight lines of three cells.
+ */
+static const BitMask LINE_MASKS[8] = { 0x007, 0x038, 0x1C0,    // rows
+                                       0x049, 0x092, 0x124,    // columns
+                                       0x111, 0x054 };         // diagonals
+
+/**
+ * Checks if a set of cells contains a line of three.
+ */
+inline bool hasLine(BitMask _m)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        if ((_m & LINE_MASKS[i]) == LINE_MASKS[i]) { return true; }
+    }
+
+    return false;
+}
+
+/**
+ * Finds the empty cells that would complete a line of three for a player.
+ *
+ * @param  _own   cells of the player
+ * @param  _other cells of the other player
+ * @return        the set of such cells
+ */
+inline BitMask winningCells(BitMask _own, BitMask _other)
+{
+    BitMask res = 0;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        if ((_other & LINE_MASKS[i]) == 0 && __builtin_popcount(_own & LINE_MASKS[i]) == 2)
+        {
+            res |= LINE_MASKS[i] & ~_own;
+        }
+    }
+
+    return res;
+}
+
+/* Self-explaining helpers */
+inline int     countCells(BitMask _m)  { return __builtin_popcount(_m);  };
+inline int     lowestCell(BitMask _m)  { return __builtin_ctz(_m);       };  // _m must not be empty
+inline BitMask cellMask(int _cell)     { return BitMask(1u << _cell);    };
+
+/**
+ * A board as two sets of cells, one per player.
+ */
+struct BitBoard
+{
+    BitMask robot;   // cells with a token of the robot
+    BitMask   opp;   // cells with a token of the opponent
+
+    BitBoard(BitMask _robot = 0, BitMask _opp = 0) : robot(_robot), opp(_opp) {};
+
+    BitMask empty()  const { return BOARD_MASK & ~(robot | opp); };
+    bool    isFull() const { return (robot | opp) == BOARD_MASK;  };
+};
+
+}
+
+#endif // __BITBOARD_H__
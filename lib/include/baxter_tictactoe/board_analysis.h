@@ -0,0 +1,192 @@
+#ifndef __BOARD_ANALYSIS_H__
+#define __BOARD_ANALYSIS_H__
+
+#include <string>
+#include <vector>
+
+#include "baxter_tictactoe/tictactoe_utils.h"
+
+#define SPRT_CONTINUE   0   // not enough evidence yet
+#define SPRT_ACCEPT     1   // the candidate move is accepted
+#define SPRT_REJECT     2   // the candidate move is rejected (and the test restarts)
+
+#define TRANS_NONE      0   // the reading equals the reference board
+#define TRANS_ADD       1   // one token of the expected color has been added (i.e. a legal move)
+#define TRANS_ADD_WRONG 2   // one token of the other color has been added
+#define TRANS_MULTI_ADD 3   // more than one token has been added
+#define TRANS_REMOVE    4   // one or more tokens have been removed
+#define TRANS_SWAP      5   // tokens have changed color, or have been moved to other cells
+#define TRANS_OCCLUSION 6   // tokens have disappeared for a short time (e.g. a hand over the board)
+
+namespace baxter_tictactoe
+{
+
+/**
+ * Accepts a move from a stream of noisy board readings by means of a sequential
+ * probability ratio test (SPRT). Every fresh reading either supports the move
+ * (i.e. it shows the candidate board) or not, and it updates the log-likelihood
+ * ratio between "the move has happened" (under which a reading supports it with
+ * probability hit_rate) and "it has not" (under which a reading supports it with
+ * probability false_rate). The move is accepted as soon as the ratio reaches
+ * log((1 - false_reject) / false_accept), so a clean stream is accepted in a few
+ * readings, and a glitch only costs the readings needed to compensate for it.
+ * A minimum time can also be required since the candidate was first seen (e.g.
+ * to keep the pace of the game): until then the ratio is capped at the acceptance
+ * threshold, so that a candidate that goes away is still rejected in a few readings.
+ */
+class MoveAcceptor
+{
+private:
+    double   llr_support;   // increment of the log-likelihood ratio for a supporting reading
+    double   llr_against;   // increment of the log-likelihood ratio for any other reading
+    double         upper;   // acceptance threshold
+    double         lower;   // rejection threshold
+    double      min_time;   // minimum time [s] between the first supporting reading and the acceptance
+
+    double           llr;   // current log-likelihood ratio
+    double       t_first;   // time [s] of the first supporting reading of the candidate
+    Board      candidate;   // board the test is about
+    bool   has_candidate;
+    size_t         n_obs;   // number of readings since the test (re)started
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _false_accept probability of accepting a move that has not happened
+     * @param _false_reject probability of rejecting a move that has happened
+     * @param _hit_rate     probability that a reading shows a move that has happened
+     * @param _false_rate   probability that a reading shows a move that has not happened
+     * @param _min_time     minimum time [s] the candidate has to be seen for before being accepted
+     */
+    MoveAcceptor(double _false_accept = 0.001, double _false_reject = 0.01,
+                 double _hit_rate     = 0.9,   double _false_rate   = 0.1,
+                 double _min_time     = 0.0);
+
+    /**
+     * Updates the test with a new reading. A supporting reading that shows a
+     * different board than the current candidate restarts the test on it.
+     *
+     * @param  _supports if the reading supports a move
+     * @param  _board    the board read
+     * @param  _time     time of the reading [s] (only needed if there is a minimum time)
+     * @return           SPRT_CONTINUE, SPRT_ACCEPT or SPRT_REJECT
+     */
+    int update(bool _supports, const Board &_board, double _time = 0.0);
+
+    /**
+     * Restarts the test, with no candidate.
+     */
+    void reset();
+
+    /* Self-explaining "getters" */
+    double getLLR()            const { return llr;           };
+    size_t getNumReadings()    const { return n_obs;         };
+    bool   hasCandidate()      const { return has_candidate; };
+    const Board& getCandidate() const { return candidate;    };
+    double getUpperThreshold() const { return upper;         };
+    double getLowerThreshold() const { return lower;         };
+    double getMinTime()        const { return min_time;      };
+};
+
+/**
+ * A transition between a reference board and a board reading.
+ */
+struct Transition
+{
+    int                       type;   // one of TRANS_*
+    std::vector<size_t>      added;   // cells that were empty and have a token now
+    std::vector<size_t>    removed;   // cells that had a token and are empty now
+    std::vector<size_t>    changed;   // cells whose token has changed color
+    size_t                  frames;   // number of consecutive readings that showed it
+
+    Transition() : type(TRANS_NONE), frames(0) {};
+
+    /**
+     * Checks if two transitions involve the same cells in the same way
+     * (the number of frames is not taken into account).
+     */
+    bool sameAs(const Transition &_t) const;
+};
+
+/**
+ * Classifies the transition from a reference board to a reading. A single token
+ * added is TRANS_ADD or TRANS_ADD_WRONG depending on its color, any removed token
+ * together with an added or changed one is TRANS_SWAP (e.g. a token moved to
+ * another cell), and removed tokens alone are TRANS_REMOVE.
+ *
+ * @param  _ref the reference board
+ * @param  _new the board read
+ * @param  _col color of the token that is expected to be added
+ * @return      the transition (with frames set to 1)
+ */
+Transition classifyTransition(const Board &_ref, const Board &_new, const std::string &_col);
+
+/**
+ * Tells if a type of transition is an illegal move, i.e. TRANS_ADD_WRONG,
+ * TRANS_MULTI_ADD, TRANS_REMOVE or TRANS_SWAP.
+ *
+ * @param  _type the type of the transition (one of TRANS_*)
+ * @return       true/false if illegal or not
+ */
+bool isIllegalTransition(int _type);
+
+/**
+ * Streaming stage that classifies every board reading against a reference board
+ * (e.g. the board the brain believes in) and emits typed events. A transition
+ * has to be shown by confirm_frames consecutive readings before it is emitted,
+ * and it is emitted only once, right on the reading that confirms it: the latency
+ * of an event is exactly confirm_frames readings from when the transition appears,
+ * and every update is O(number of cells). Since tokens do not vanish during a game,
+ * a transition that involves removed tokens is emitted as TRANS_OCCLUSION first,
+ * and with its own type only if it lasts occlusion_frames readings. When the readings
+ * go back to the reference board after an illegal move (see isIllegalTransition()),
+ * a TRANS_NONE event is emitted. Going back after an occlusion or a legal move
+ * (e.g. a hand passing over the board) is expected, and it is not an event.
+ */
+class TransitionAnalyzer
+{
+private:
+    size_t   confirm_frames;   // readings needed to emit an event
+    size_t occlusion_frames;   // readings needed to tell a removal from an occlusion
+
+    Board               ref;   // reference board
+    std::string         col;   // color of the token that is expected to be added
+
+    Transition      pending;   // transition shown by the latest readings
+    int        last_emitted;   // type of the latest event (TRANS_NONE if none)
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _confirm_frames   readings needed to emit an event
+     * @param _occlusion_frames readings needed to tell a removal from an occlusion
+     */
+    TransitionAnalyzer(size_t _confirm_frames = 3, size_t _occlusion_frames = 10);
+
+    /**
+     * Sets the reference board, and resets the analysis.
+     *
+     * @param _ref the reference board
+     * @param _col color of the token that is expected to be added
+     */
+    void setReference(const Board &_ref, const std::string &_col);
+
+    /**
+     * Analyzes a new reading.
+     *
+     * @param  _new   the board read
+     * @param  _event the event, if any
+     * @return        true/false if an event has been emitted or not
+     */
+    bool update(const Board &_new, Transition &_event);
+
+    /* Self-explaining "getters" */
+    const Transition& getPending() const { return pending;      };
+    int          getLastEmitted()  const { return last_emitted; };
+};
+
+}
+
+#endif // __BOARD_ANALYSIS_H__
@@ -0,0 +1,119 @@
+#ifndef __CHEATING_PLANNER_H__
+#define __CHEATING_PLANNER_H__
+
+#include <string>
+#include <vector>
+
+#include "baxter_tictactoe/bitboard.h"
+#include "baxter_tictactoe/tictactoe_utils.h"
+
+namespace baxter_tictactoe
+{
+
+/**
+ * A move chosen by the CheatingPlanner.
+ */
+struct CheatPlan
+{
+    int             cell;   // cell of the move (from 0 to 8, -1 if there is none)
+    double         value;   // expected score of the robot after the move (1 win, 0.5 tie, 0 loss)
+    double noticeability;   // how noticeable the move is (from 0 to 1, 0 for legal moves)
+
+    CheatPlan() : cell(-1), value(0.0), noticeability(0.0) {};
+};
+
+/**
+ * Builds a bitboard from a board.
+ *
+ * @param  _b         the board
+ * @param  _robot_col color of the tokens of the robot
+ * @param  _opp_col   color of the tokens of the opponent
+ * @return            the bitboard
+ */
+BitBoard makeBitBoard(const Board &_b, const std::string &_robot_col, const std::string &_opp_col);
+
+/**
+ * Plans the moves of the robot, cheats included (i.e. overwriting a token of the
+ * opponent with one of the robot). Every move is evaluated together with the follow-up
+ * play by an expectimax search in which the robot maximizes its expected score, and the
+ * opponent plays an optimal move with probability skill, and a random one otherwise.
+ * Values are memoized for every position and side to move (2^19 entries), so that once
+ * a position has been explored, evaluating all the moves from it takes a few microseconds.
+ */
+class CheatingPlanner
+{
+private:
+    double                 skill;   // probability that the opponent plays an optimal move
+
+    std::vector<int8_t>  minimax;   // value with optimal play from both sides (+1 win, 0 tie, -1 loss)
+    std::vector<float>  expected;   // expected score of the robot under the opponent model
+
+    /**
+     * Index of a position in the memoization tables.
+     */
+    static size_t index(const BitBoard &_b, bool _robot_turn)
+    {
+        return _b.robot | (size_t(_b.opp) << 9) | (size_t(_robot_turn) << 18);
+    };
+
+    /**
+     * Value of a position with optimal play from both sides.
+     */
+    int   getMinimax(const BitBoard &_b, bool _robot_turn);
+
+    /**
+     * Expected score of the robot in a position, under the opponent model.
+     */
+    float getExpected(const BitBoard &_b, bool _robot_turn);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _skill probability that the opponent plays an optimal move
+     */
+    CheatingPlanner(double _skill = 0.5);
+
+    /**
+     * Sets the skill of the opponent. Expected scores are recomputed if it changes.
+     *
+     * @param _skill probability that the opponent plays an optimal move
+     */
+    void setSkill(double _skill);
+
+    /**
+     * Finds the best legal move of the robot.
+     *
+     * @param  _b the board (robot to move)
+     * @return    the move (cell -1 if the board is full or the game is over)
+     */
+    CheatPlan bestMove(const BitBoard &_b);
+
+    /**
+     * Finds the best cheat of the robot. Cheats whose expected score is within
+     * _tolerance of the best one are considered equivalent, and the least noticeable
+     * of them is chosen, i.e. the one furthest from the last move of the opponent.
+     *
+     * @param  _b         the board (robot to move)
+     * @param  _last_opp  cell of the last move of the opponent (-1 if unknown)
+     * @param  _tolerance tolerance on the expected score
+     * @return            the cheat (cell -1 if the opponent has no tokens or the game is over)
+     */
+    CheatPlan bestCheat(const BitBoard &_b, int _last_opp = -1, double _tolerance = 0.05);
+
+    /**
+     * Evaluates a position.
+     *
+     * @param  _b          the board
+     * @param  _robot_turn if the robot is to move
+     * @return             the expected score of the robot
+     */
+    double evaluate(const BitBoard &_b, bool _robot_turn) { return getExpected(_b, _robot_turn); };
+
+    /* Self-explaining "getters" */
+    double getSkill() const { return skill; };
+};
+
+}
+
+#endif // __CHEATING_PLANNER_H__
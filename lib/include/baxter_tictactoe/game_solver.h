@@ -0,0 +1,242 @@
+#ifndef __GAME_SOLVER_H__
+#define __GAME_SOLVER_H__
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+namespace baxter_tictactoe
+{
+
+#define MAX_GAME_SIDE   5   // the cells of the largest board fit in 32 bits
+
+// Kinds of scores in the transposition table
+#define BOUND_EXACT     0   // the score of the position
+#define BOUND_LOWER     1   // the position scores at least this
+#define BOUND_UPPER     2   // the position scores at most this
+
+/**
+ * An n x n board where the first player to get k tokens in a row wins
+ * (tic tac toe is n = k = 3). Cells are numbered row by row, from 0 to n*n-1.
+ */
+class NKGame
+{
+private:
+    int                                           n;
+    int                                           k;
+    uint32_t                                   full;   // all the cells of the board
+
+    std::vector<uint32_t>                     lines;   // all the lines of k cells
+    std::vector<std::vector<uint32_t> >  cell_lines;   // the lines through every cell
+    std::vector<int>                     move_order;   // cells sorted by number of lines, most first
+
+public:
+    /**
+     * Constructor. Invalid sizes are clamped to 1 <= k <= n <= MAX_GAME_SIDE.
+     *
+     * @param _n side of the board
+     * @param _k number of tokens in a row to win
+     */
+    NKGame(int _n = 3, int _k = 3);
+
+    /**
+     * Checks if a set of cells contains a line of k cells.
+     */
+    bool hasLine(uint32_t _m) const;
+
+    /**
+     * Checks if playing a cell would complete a line of k cells.
+     *
+     * @param  _own  cells of the player
+     * @param  _cell the cell to play
+     * @return       true/false if the move wins or not
+     */
+    bool isWinningMove(uint32_t _own, int _cell) const;
+
+    /* Self-explaining "getters" */
+    int                     getN()         const { return n;          };
+    int                     getK()         const { return k;          };
+    int                     getNumCells()  const { return n * n;      };
+    uint32_t                getFullMask()  const { return full;       };
+    const std::vector<int>& getMoveOrder() const { return move_order; };
+};
+
+/**
+ * A position, seen from the player to move: its own cells and the other player's ones.
+ * Since it does not say who started, the same position is shared by both players.
+ */
+struct NKPosition
+{
+    uint32_t   own;
+    uint32_t other;
+
+    NKPosition(uint32_t _own = 0, uint32_t _other = 0) : own(_own), other(_other) {};
+
+    /**
+     * Plays a cell, and passes the turn to the other player.
+     */
+    NKPosition play(int _cell) const { return NKPosition(other, own | (1u << _cell)); };
+
+    /**
+     * A key that identifies the position (unique for a given board size).
+     */
+    uint64_t key(int _num_cells) const { return own | (uint64_t(other) << _num_cells); };
+
+    int numTokens() const { return __builtin_popcount(own | other); };
+};
+
+/**
+ * Result of the search of a position. Scores are from the point of view of the player to
+ * move: 0 for a tie, and for a win (loss) one plus the number of empty cells left at the
+ * end of the game (its opposite), so that quicker wins and slower losses are preferred.
+ */
+struct SolverResult
+{
+    int         move;   // best move (-1 if the game is over)
+    int        score;   // score of the position
+    uint64_t   nodes;   // number of positions visited
+
+    SolverResult() : move(-1), score(0), nodes(0) {};
+};
+
+/**
+ * An entry of a TranspositionTable.
+ */
+struct TTEntry
+{
+    int8_t   score;
+    int8_t    move;
+    uint8_t  bound;   // BOUND_EXACT, BOUND_LOWER or BOUND_UPPER
+
+    TTEntry(int8_t _s = 0, int8_t _m = -1, uint8_t _b = 0) : score(_s), move(_m), bound(_b) {};
+};
+
+/**
+ * A fixed size transposition table that can be shared by many threads without locks.
+ * Every slot is a pair of atomic words, the entry and the entry xor-ed with a mix of
+ * the key (keys are bitboards, far from random, so they are scrambled first): a slot
+ * torn by two concurrent writes does not match its key any more, except with a tiny
+ * probability, so it reads as missing instead of corrupted. Newer entries replace
+ * older ones in the same slot.
+ */
+class TranspositionTable
+{
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> check;   // mix(key) ^ data
+        std::atomic<uint64_t>  data;   // packed entry (0 if the slot is empty)
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    int                      bits;
+
+    size_t slotIndex(uint64_t _key) const
+    {
+        return (_key * 0x9E3779B97F4A7C15ULL) >> (64 - bits);
+    };
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _bits the table has 2^_bits slots (16 bytes each), with 1 <= _bits <= 30
+     */
+    TranspositionTable(int _bits = 20);
+
+    /**
+     * Looks a position up.
+     *
+     * @param  _key   key of the position
+     * @param  _entry the entry, if found
+     * @return        true/false if found or not
+     */
+    bool probe(uint64_t _key, TTEntry &_entry) const;
+
+    /**
+     * Stores the entry of a position.
+     */
+    void store(uint64_t _key, const TTEntry &_entry);
+
+    /**
+     * Reads a slot, to go through all the entries of the table.
+     *
+     * @param  _i     index of the slot (from 0 to getNumSlots()-1)
+     * @param  _key   key of the position in the slot
+     * @param  _entry its entry
+     * @return        true/false if the slot holds a (consistent) entry or not
+     */
+    bool getSlot(size_t _i, uint64_t &_key, TTEntry &_entry) const;
+
+    /**
+     * Empties the table. Not to be called during a search.
+     */
+    void clear();
+
+    /* Self-explaining "getters" */
+    size_t getNumSlots() const { return size_t(1) << bits; };
+};
+
+/**
+ * Solves the positions of an NKGame by negamax search with alpha-beta pruning and a
+ * transposition table, which is kept across searches so that solving many positions
+ * of the same game (e.g. to build an opening book) reuses the work already done.
+ *
+ * With more than one thread the search is a Lazy SMP: all the threads search the whole
+ * tree, each one starting from a different root move, and share their results through
+ * the lock-free table, so that each thread mostly skips the parts solved by the others.
+ * The first thread to finish gives the result, and stops the others. The score is
+ * always exact, but with several threads the best move may be any of the equivalent
+ * ones. With a single thread the search is deterministic.
+ */
+class Solver
+{
+private:
+    NKGame                   game;
+    TranspositionTable         tt;
+    int               num_threads;
+    std::atomic<bool>        stop;   // set by the first thread to finish
+
+    int negamax(const NKPosition &_p, int _alpha, int _beta, uint64_t &_nodes);
+
+    /**
+     * Searches all the moves of the root, starting from the _first-th one.
+     *
+     * @return the result (not valid if the search has been stopped)
+     */
+    SolverResult searchRoot(const NKPosition &_p, int _first);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _game       the game to solve
+     * @param _threads    number of threads of the search
+     * @param _table_bits the table has 2^_table_bits slots (16 bytes each)
+     */
+    Solver(const NKGame &_game, int _threads = 1, int _table_bits = 20);
+
+    /**
+     * Solves a position.
+     *
+     * @param  _p the position
+     * @return    the best move and its score (nodes are summed over all threads)
+     */
+    SolverResult solve(const NKPosition &_p);
+
+    /**
+     * Clears the transposition table.
+     */
+    void clear() { tt.clear(); };
+
+    /* Self-explaining "getters" and "setters" */
+    const NKGame&             getGame()    const { return game;        };
+    const TranspositionTable& getTable()   const { return tt;          };
+    int                       getThreads() const { return num_threads; };
+    void setThreads(int _threads) { num_threads = _threads > 1 ? _threads : 1; };
+};
+
+}
+
+#endif // __GAME_SOLVER_H__
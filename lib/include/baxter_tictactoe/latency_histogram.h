@@ -0,0 +1,71 @@
+#ifndef __LATENCY_HISTOGRAM_H__
+#define __LATENCY_HISTOGRAM_H__
+
+#include <string>
+#include <vector>
+
+namespace baxter_tictactoe
+{
+
+/**
+ * Histogram of latencies, with logarithmic bins (four per octave, from 0.1 ms
+ * to about 13 s) so that it has a constant relative resolution of about 19%.
+ * Adding a sample is O(1) and allocation-free; percentiles are approximated
+ * with the upper edge of the bin they fall in.
+ */
+class LatencyHistogram
+{
+private:
+    std::vector<unsigned long> bins;
+
+    unsigned long count;
+    double          sum;    // [s]
+    double          max;    // [s]
+
+    /**
+     * Gets the upper edge of a bin.
+     *
+     * @param  _i index of the bin
+     * @return    the upper edge [s]
+     */
+    static double upperEdge(size_t _i);
+
+public:
+    LatencyHistogram();
+
+    /**
+     * Adds a sample.
+     *
+     * @param _latency the latency [s] (negative values count as zero)
+     */
+    void add(double _latency);
+
+    /**
+     * Approximates a percentile of the samples.
+     *
+     * @param  _p the percentile, in [0, 100]
+     * @return    the latency [s] (0 if there are no samples)
+     */
+    double percentile(double _p) const;
+
+    /**
+     * Removes all the samples.
+     */
+    void reset();
+
+    /**
+     * Summarizes the histogram into a human-readable string.
+     *
+     * @return number of samples, mean, median, 90th and 99th percentiles, and max [ms]
+     */
+    std::string toString() const;
+
+    /* Self-explaining "getters" */
+    unsigned long getCount() const { return count;                       };
+    double        getMean()  const { return count > 0 ? sum / count : 0; };
+    double        getMax()   const { return max;                         };
+};
+
+}
+
+#endif // __LATENCY_HISTOGRAM_H__
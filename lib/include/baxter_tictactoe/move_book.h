@@ -0,0 +1,120 @@
+#ifndef __MOVE_BOOK_H__
+#define __MOVE_BOOK_H__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace baxter_tictactoe
+{
+
+/**
+ * A position of a MoveBook: its best move and score (see SolverResult).
+ */
+struct BookEntry
+{
+    int8_t    move;
+    int8_t   score;
+
+    BookEntry(int8_t _m = -1, int8_t _s = 0) : move(_m), score(_s) {};
+};
+
+/**
+ * Builds a MoveBook file, e.g. from the positions solved offline by a Solver.
+ */
+class MoveBookWriter
+{
+private:
+    std::vector<std::pair<uint64_t, BookEntry> > entries;
+
+public:
+    /**
+     * Adds a position. If a key is added more than once, the first entry is kept.
+     *
+     * @param _key   key of the position (see NKPosition::key)
+     * @param _entry its best move and score
+     */
+    void add(uint64_t _key, const BookEntry &_entry);
+
+    /**
+     * Writes the book to a file. The file is written aside and then renamed,
+     * so that a brain mapping the old one is never left with a partial file.
+     *
+     * @param  _filename name of the file
+     * @param  _n        side of the board of the game
+     * @param  _k        number of tokens in a row to win
+     * @return           true/false if success/failure
+     */
+    bool write(const std::string &_filename, int _n, int _k);
+
+    /* Self-explaining "getters" */
+    size_t getNumEntries() const { return entries.size(); };
+};
+
+/**
+ * An opening book and endgame tablebase: the best move and score of a set of positions,
+ * solved offline. The file is memory mapped read-only and used as is, with no parsing:
+ *
+ *   header     magic "TTTBOOK1", n, k (u32), number of entries and of index keys (u64)
+ *   index      every BOOK_BLOCK-th key (u64), to find the block of a key
+ *   keys       the keys of the positions, sorted (u64)
+ *   entries    the move and score of every position (2 x i8)
+ *
+ * A lookup is a binary search in the (small, cache friendly) index and then in one block
+ * of keys, i.e. O(log n) and a handful of cache misses even for millions of positions.
+ */
+class MoveBook
+{
+private:
+    const char          *data;   // NULL if not open
+    size_t          data_size;
+
+    int                     n;
+    int                     k;
+    size_t        num_entries;
+    size_t          num_index;
+
+    const uint64_t     *index;
+    const uint64_t      *keys;
+    const BookEntry  *entries;
+
+public:
+    MoveBook();
+    ~MoveBook();
+
+    // The book owns the mapping, so it can not be copied (it would be unmapped twice)
+    MoveBook(const MoveBook&)            = delete;
+    MoveBook& operator=(const MoveBook&) = delete;
+
+    /**
+     * Maps a book file.
+     *
+     * @param  _filename name of the file
+     * @return           true/false if success/failure (e.g. no such file, or not a valid book)
+     */
+    bool open(const std::string &_filename);
+
+    /**
+     * Unmaps the book.
+     */
+    void close();
+
+    /**
+     * Looks a position up.
+     *
+     * @param  _key   key of the position (see NKPosition::key)
+     * @param  _entry its best move and score, if found
+     * @return        true/false if the position is in the book or not
+     */
+    bool lookup(uint64_t _key, BookEntry &_entry) const;
+
+    /* Self-explaining "getters" */
+    bool   isOpen()        const { return data != NULL; };
+    int    getN()          const { return n;            };
+    int    getK()          const { return k;            };
+    size_t getNumEntries() const { return num_entries;  };
+};
+
+}
+
+#endif // __MOVE_BOOK_H__
@@ -0,0 +1,67 @@
+#ifndef __OPPONENT_MODEL_H__
+#define __OPPONENT_MODEL_H__
+
+#include "baxter_tictactoe/bitboard.h"
+
+namespace baxter_tictactoe
+{
+
+/**
+ * Online model of the skill of the opponent, estimated from its moves as the
+ * probability that it takes a chance: completing a line when it can, or blocking
+ * a line of the robot when it cannot. The probability has a Beta prior, and its
+ * estimate is the posterior mean. The model is a handful of counters, and every
+ * update is O(1); counters can be discounted at every chance, so that the estimate
+ * follows an opponent that improves during a match.
+ */
+class OpponentModel
+{
+private:
+    double       prior_a;   // prior number of chances taken
+    double       prior_b;   // prior number of chances missed
+    double         decay;   // discount of the counters at every chance (1 for none)
+
+    double   win_chances;   // chances to win
+    double     win_taken;   // chances to win taken
+    double block_chances;   // chances to block
+    double   block_taken;   // chances to block taken
+    unsigned long  moves;   // moves seen
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _prior_a prior number of chances taken
+     * @param _prior_b prior number of chances missed
+     * @param _decay   discount of the counters at every chance (1 for none)
+     */
+    OpponentModel(double _prior_a = 1.0, double _prior_b = 1.0, double _decay = 1.0);
+
+    /**
+     * Updates the model with a move of the opponent.
+     *
+     * @param _before the board before the move
+     * @param _cell   cell of the move (from 0 to 8)
+     */
+    void update(const BitBoard &_before, int _cell);
+
+    /**
+     * Forgets all the moves seen (e.g. for a new opponent).
+     */
+    void reset();
+
+    /**
+     * Estimate of the probability that the opponent takes a chance to win or to block.
+     */
+    double getSkill() const;
+
+    /* Self-explaining "getters" */
+    double        getWinRate()   const { return (win_taken + prior_a) / (win_chances + prior_a + prior_b);     };
+    double        getBlockRate() const { return (block_taken + prior_a) / (block_chances + prior_a + prior_b); };
+    double        getNumChances() const { return win_chances + block_chances; };
+    unsigned long getNumMoves()  const { return moves; };
+};
+
+}
+
+#endif // __OPPONENT_MODEL_H__
@@ -0,0 +1,182 @@
+#ifndef __SESSION_LOG_H__
+#define __SESSION_LOG_H__
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+namespace baxter_tictactoe
+{
+
+/**
+ * Types of the records stored in a session log.
+ */
+enum RecordType
+{
+    REC_IMAGE       = 1,    // encoded camera frame
+    REC_BOARD       = 2,    // serialized MsgBoard
+    REC_BRAIN_STATE = 3,    // serialized TTTBrainState
+    REC_ACTION      = 4,    // controller action (plain text)
+    REC_SPEECH      = 5     // sentence said by the robot (plain text)
+};
+
+/**
+ * A record of a session log. The payload points to memory owned by the
+ * SessionReader that produced it, and it is valid as long as the reader is.
+ */
+struct Record
+{
+    uint32_t           type;    // one of RecordType
+    uint64_t       stamp_ns;    // time of the record [ns]
+    const uint8_t     *data;    // payload
+    uint32_t           size;    // size of the payload [bytes]
+
+    Record() : type(0), stamp_ns(0), data(NULL), size(0) {};
+};
+
+/**
+ * Entry of the index of a session log. The index is stored at the end of
+ * the file, sorted by time, and it is used directly from the mapped file.
+ */
+struct IndexEntry
+{
+    uint64_t stamp_ns;
+    uint64_t   offset;    // offset of the record header from the beginning of the file
+    uint32_t     type;
+    uint32_t     size;
+};
+
+/**
+ * Append-only writer of session logs. Records are written as they come,
+ * and the index is written when the log is closed. A log whose writer did
+ * not close it (e.g. a crash) can still be read, see SessionReader.
+ *
+ * File layout (little endian, every block aligned to 8 bytes):
+ *   header:  magic[8], version (u32), reserved (u32), index offset (u64), number of records (u64)
+ *   records: type (u32), size (u32), stamp (u64), payload padded to 8 bytes
+ *   index:   number of records times IndexEntry
+ */
+class SessionWriter
+{
+private:
+    FILE                      *file;
+    std::string            filename;
+    uint64_t                 offset;    // current end of the file
+    uint64_t             last_stamp;    // to keep the records sorted by time
+    std::vector<IndexEntry>   index;
+
+public:
+    SessionWriter();
+    ~SessionWriter();
+
+    // The writer owns the file, so it can not be copied
+    SessionWriter(const SessionWriter&)            = delete;
+    SessionWriter& operator=(const SessionWriter&) = delete;
+
+    /**
+     * Opens a new log. An existing file with the same name is overwritten.
+     *
+     * @param  _filename name of the file
+     * @return           true/false if success/failure
+     */
+    bool open(const std::string &_filename);
+
+    /**
+     * Appends a record to the log. Records should come in chronological order:
+     * a record older than the previous one is stored with the previous stamp.
+     *
+     * @param  _type     type of the record (one of RecordType)
+     * @param  _stamp_ns time of the record [ns]
+     * @param  _data     payload
+     * @param  _size     size of the payload [bytes]
+     * @return           true/false if success/failure
+     */
+    bool write(uint32_t _type, uint64_t _stamp_ns, const void *_data, uint32_t _size);
+
+    /**
+     * Writes the index and closes the log.
+     *
+     * @return true/false if success/failure
+     */
+    bool close();
+
+    /* Self-explaining "getters" */
+    bool   isOpen()        { return file != NULL; };
+    size_t getNumRecords() { return index.size(); };
+};
+
+/**
+ * Reader of session logs. The file is memory mapped read-only, and records
+ * are accessed in place: no deserialization happens until the payload is used.
+ */
+class SessionReader
+{
+private:
+    int                        fd;
+    const uint8_t           *base;   // beginning of the mapped file
+    uint64_t            file_size;
+
+    const IndexEntry   *index;       // index in the mapped file
+    size_t            n_index;
+    std::vector<IndexEntry> rebuilt; // index rebuilt by scanning, if the log was not closed
+
+    /**
+     * Rebuilds the index by scanning the records in the file.
+     *
+     * @param  _end offset where the records end (i.e. the index begins, or the end of the file)
+     * @return      the number of valid records found
+     */
+    size_t rebuildIndex(uint64_t _end);
+
+public:
+    SessionReader();
+    ~SessionReader();
+
+    // The reader owns the mapping, so it can not be copied (it would be unmapped twice)
+    SessionReader(const SessionReader&)            = delete;
+    SessionReader& operator=(const SessionReader&) = delete;
+
+    /**
+     * Maps a log in memory. The header is checked against the size of the file,
+     * so that a truncated or corrupted log can not make the reader go past the
+     * mapping: if the index does not fit in the file, it is rebuilt by scanning.
+     *
+     * @param  _filename name of the file
+     * @return           true/false if success/failure
+     */
+    bool open(const std::string &_filename);
+
+    /**
+     * Unmaps the log.
+     */
+    void close();
+
+    /**
+     * Gets a record.
+     *
+     * @param  _i   index of the record (in chronological order)
+     * @param  _rec the record
+     * @return      true/false if success/failure (e.g. the record lies outside the file)
+     */
+    bool get(size_t _i, Record &_rec) const;
+
+    /**
+     * Finds the first record whose stamp is not earlier than a given time.
+     * It runs in O(log n) by binary search on the index.
+     *
+     * @param  _stamp_ns time to look for [ns]
+     * @return           the index of the record (getNumRecords() if none)
+     */
+    size_t seek(uint64_t _stamp_ns) const;
+
+    /* Self-explaining "getters" */
+    bool     isOpen()        const { return base != NULL; };
+    size_t   getNumRecords() const { return n_index;      };
+    uint64_t getStartStamp() const { return n_index > 0 ? index[0].stamp_ns           : 0; };
+    uint64_t getEndStamp()   const { return n_index > 0 ? index[n_index - 1].stamp_ns : 0; };
+};
+
+}
+
+#endif // __SESSION_LOG_H__
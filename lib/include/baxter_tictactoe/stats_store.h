@@ -0,0 +1,204 @@
+#ifndef __STATS_STORE_H__
+#define __STATS_STORE_H__
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+namespace baxter_tictactoe
+{
+
+/**
+ * Summary of the values of a column over a range of rows.
+ */
+struct StatsSummary
+{
+    size_t   count;
+    double     sum;
+    double     min;
+    double     max;
+
+    StatsSummary() : count(0), sum(0.0), min(0.0), max(0.0) {};
+
+    double mean() const { return count > 0 ? sum / count : 0.0; };
+};
+
+/**
+ * Append-only writer of a table of statistics. Tables are stored by columns,
+ * one file per column in a common directory, so that a query only reads the
+ * columns it uses. Every row has a time stamp and a fixed set of numeric values.
+ *
+ * Files of a table named T in a directory D:
+ *   D/T.schema       names of the columns, one per line
+ *   D/T.stamp.col    time stamps of the rows [ns] (u64, non decreasing)
+ *   D/T.<name>.col   values of column <name> (f64)
+ *
+ * A table can be reopened to append more rows, across any number of sessions.
+ * A row that was only partially written (e.g. a crash) is discarded on opening.
+ */
+class StatsWriter
+{
+private:
+    std::string                  dir;
+    std::string                table;
+    std::vector<std::string> columns;
+
+    FILE                  *stamp_file;
+    std::vector<FILE*>    value_files;
+
+    uint64_t                num_rows;
+    uint64_t              last_stamp;    // to keep the rows sorted by time
+
+public:
+    StatsWriter();
+    ~StatsWriter();
+
+    /**
+     * Opens a table for appending. If the table does not exist it is created
+     * (together with the directory, if needed), otherwise its columns have to match.
+     *
+     * @param  _dir     directory of the table
+     * @param  _table   name of the table
+     * @param  _columns names of the columns (besides the time stamp)
+     * @return          true/false if success/failure
+     */
+    bool open(const std::string &_dir, const std::string &_table,
+              const std::vector<std::string> &_columns);
+
+    /**
+     * Appends a row. Rows should come in chronological order: a row older
+     * than the previous one is stored with the previous stamp.
+     *
+     * @param  _stamp_ns time of the row [ns]
+     * @param  _values   values of the row, one per column
+     * @return           true/false if success/failure
+     */
+    bool append(uint64_t _stamp_ns, const std::vector<double> &_values);
+
+    /**
+     * Closes the table.
+     */
+    void close();
+
+    /* Self-explaining "getters" */
+    bool     isOpen()      const { return stamp_file != NULL; };
+    uint64_t getNumRows()  const { return num_rows;           };
+};
+
+/**
+ * Reader of a table of statistics. The columns are memory mapped read-only
+ * when they are first used, so that aggregate queries over months of data
+ * only touch the columns (and, thanks to the sorted stamps, the rows) they need.
+ * The reader sees the rows that were in the table when it was opened.
+ */
+class StatsReader
+{
+private:
+    struct Column
+    {
+        std::string        name;
+        std::string    filename;
+        const double    *values;   // NULL if not mapped yet
+        size_t        map_size;
+    };
+
+    bool                  is_open;
+
+    const uint64_t        *stamps;
+    size_t             stamps_size;
+    std::vector<Column>    columns;
+    size_t                num_rows;
+
+    /**
+     * Maps a column file in memory.
+     *
+     * @param  _filename name of the file
+     * @param  _size     size of the mapping [bytes]
+     * @return           the mapped memory (NULL if failure or empty)
+     */
+    static const void* mapFile(const std::string &_filename, size_t &_size);
+
+public:
+    StatsReader();
+    ~StatsReader();
+
+    /**
+     * Opens a table.
+     *
+     * @param  _dir   directory of the table
+     * @param  _table name of the table
+     * @return        true/false if success/failure
+     */
+    bool open(const std::string &_dir, const std::string &_table);
+
+    /**
+     * Unmaps the table.
+     */
+    void close();
+
+    /**
+     * Gets the values of a column, mapping it if needed.
+     *
+     * @param  _column name of the column
+     * @return         the values (getNumRows() of them), or NULL if the column does not exist
+     */
+    const double* getValues(const std::string &_column);
+
+    /**
+     * Finds the first row whose stamp is not earlier than a given time,
+     * in O(log n) by binary search on the stamps.
+     *
+     * @param  _stamp_ns time to look for [ns]
+     * @return           the index of the row (getNumRows() if none)
+     */
+    size_t seek(uint64_t _stamp_ns) const;
+
+    /**
+     * Summarizes a column over the rows in a time range [_from_ns, _to_ns).
+     *
+     * @param  _column  name of the column
+     * @param  _from_ns beginning of the time range [ns]
+     * @param  _to_ns   end of the time range [ns]
+     * @return          the summary (with count 0 if no rows or no such column)
+     */
+    StatsSummary summarize(const std::string &_column,
+                           uint64_t _from_ns = 0, uint64_t _to_ns = UINT64_MAX);
+
+    /**
+     * Summarizes a column over the rows in a time range [_from_ns, _to_ns)
+     * whose value in another column equals a given one.
+     *
+     * @param  _column  name of the column to summarize
+     * @param  _where   name of the column to filter the rows by
+     * @param  _equals  value the rows must have in the _where column
+     * @param  _from_ns beginning of the time range [ns]
+     * @param  _to_ns   end of the time range [ns]
+     * @return          the summary (with count 0 if no rows or no such columns)
+     */
+    StatsSummary summarize(const std::string &_column, const std::string &_where, double _equals,
+                           uint64_t _from_ns = 0, uint64_t _to_ns = UINT64_MAX);
+
+    /**
+     * Counts the rows in a time range [_from_ns, _to_ns) whose value in a column equals a given one.
+     *
+     * @param  _column  name of the column
+     * @param  _value   value to look for
+     * @param  _from_ns beginning of the time range [ns]
+     * @param  _to_ns   end of the time range [ns]
+     * @return          the number of rows
+     */
+    size_t count(const std::string &_column, double _value,
+                 uint64_t _from_ns = 0, uint64_t _to_ns = UINT64_MAX);
+
+    /* Self-explaining "getters" */
+    bool            isOpen()                const { return is_open;         };
+    size_t          getNumRows()            const { return num_rows;        };
+    size_t          getNumColumns()         const { return columns.size();  };
+    std::string     getColumnName(size_t i) const { return columns[i].name; };
+    const uint64_t* getStamps()             const { return stamps;          };
+};
+
+}
+
+#endif // __STATS_STORE_H__
@@ -0,0 +1,350 @@
+#ifndef __STRATEGY_H__
+#define __STRATEGY_H__
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "baxter_tictactoe/tictactoe_utils.h"
+#include "baxter_tictactoe/cheating_planner.h"
+#include "baxter_tictactoe/game_solver.h"
+#include "baxter_tictactoe/move_book.h"
+#include "baxter_tictactoe/latency_histogram.h"
+
+// Name of the function a strategy plug-in exports (see StrategyRegistry::loadPlugin)
+#define STRATEGY_PLUGIN_SYMBOL  "registerStrategies"
+
+namespace baxter_tictactoe
+{
+
+/**
+ * A move chosen by a strategy.
+ */
+struct StrategyMove
+{
+    int           cell;     // cell of the move (from 0 to 8, -1 if there is none)
+    bool         cheat;     // if the move overwrites a token of the opponent
+    std::string reason;     // why the move has been chosen, for the logs (e.g. "Victory")
+
+    StrategyMove(int _cell = -1, bool _cheat = false, const std::string &_reason = "") :
+                 cell(_cell), cheat(_cheat), reason(_reason) {};
+};
+
+/**
+ * The best move found so far by a strategy that is still running. Strategies
+ * that take long report their moves as they find better ones, so that one of
+ * them can be played if the time to decide runs out.
+ */
+class AnytimeMove
+{
+private:
+    mutable std::mutex mtx;
+    StrategyMove      move;     // best move so far (cell -1 if none)
+
+public:
+    void report(const StrategyMove &_move) { std::lock_guard<std::mutex> lck(mtx); move = _move; };
+
+    StrategyMove get() const { std::lock_guard<std::mutex> lck(mtx); return move; };
+};
+
+/**
+ * Everything a strategy gets to choose a move: a read-only view of the board, what
+ * is known about the opponent, the time it has to decide, and the engines shared by all
+ * the strategies (which may be NULL, if the caller has none).
+ */
+struct StrategyContext
+{
+    const Board           *board;   // the board (robot to move)
+    std::string        robot_col;   // color of the tokens of the robot
+    std::string          opp_col;   // color of the tokens of the opponent
+    int                 last_opp;   // cell of the last move of the opponent (from 0 to 8, -1 if unknown)
+    double             opp_skill;   // estimated probability that the opponent plays an optimal move
+    double           time_budget;   // time [s] the strategy has to decide
+
+    std::chrono::steady_clock::time_point deadline;     // time the move has to be chosen by
+    AnytimeMove            *best;   // where to report the best move found so far
+
+    CheatingPlanner     *planner;   // planner of the moves and cheats, on bitboards
+    const MoveBook         *book;   // opening book and endgame tablebase
+    std::mt19937            *rng;   // random number generator
+
+    StrategyContext() : board(NULL), robot_col(COL_BLUE), opp_col(COL_RED), last_opp(-1),
+                        opp_skill(0.5), time_budget(1.0),
+                        deadline(std::chrono::steady_clock::time_point::max()), best(NULL),
+                        planner(NULL), book(NULL), rng(NULL) {};
+
+    /**
+     * Tells if the time to decide has run out (the strategy should return as soon as possible).
+     */
+    bool expired() const { return std::chrono::steady_clock::now() >= deadline; };
+
+    /**
+     * Reports the best move found so far.
+     */
+    void report(const StrategyMove &_move) const { if (best != NULL) { best->report(_move); } };
+};
+
+/**
+ * Counters of the moves chosen by a strategy, and of the time it took to choose them.
+ */
+struct StrategyStats
+{
+    unsigned long    moves;     // moves chosen
+    unsigned long   cheats;     // cheats among them
+    unsigned long failures;     // times no move was found
+    double      total_time;     // time [s] spent choosing them
+    double        max_time;     // longest time [s] spent choosing one
+
+    StrategyStats() : moves(0), cheats(0), failures(0), total_time(0.0), max_time(0.0) {};
+};
+
+/**
+ * Configuration of a strategy, as key-value pairs (e.g. from the parameter server).
+ */
+typedef std::map<std::string, std::string> StrategyConfig;
+
+/**
+ * Reads a number from a configuration.
+ *
+ * @param  _config the configuration
+ * @param  _key    the key
+ * @param  _def    the value if the key is missing or not a number
+ * @return         the value
+ */
+double getConfig(const StrategyConfig &_config, const std::string &_key, double _def);
+
+/**
+ * Heuristics shared by the strategies. Each of them returns the cell
+ * of the move (from 0 to 8), or -1 if there is none.
+ */
+int victoryMove  (const StrategyContext &_ctx);    // a move that completes a line of the robot
+int defensiveMove(const StrategyContext &_ctx);    // a move that blocks a line of the opponent
+int randomMove   (const StrategyContext &_ctx);    // a uniformly random legal move
+int bookMove     (const StrategyContext &_ctx);    // the move in the book, if any
+
+/**
+ * The fast move played when a strategy runs out of time: a victory move if there is one,
+ * otherwise a defensive move, otherwise a random one. It takes a few microseconds.
+ *
+ * @param  _ctx the board and what is known about the game
+ * @return      the move (cell -1 if the board is full)
+ */
+StrategyMove fallbackMove(const StrategyContext &_ctx);
+
+/**
+ * Checks if a move can be played on a board: a legal move on an empty cell,
+ * or a cheat on a cell of the opponent.
+ *
+ * @param  _ctx  the board and the colors
+ * @param  _move the move
+ * @return       true/false if the move can be played or not
+ */
+bool isPlayable(const StrategyContext &_ctx, const StrategyMove &_move);
+
+/**
+ * Base class of the strategies of the robot. A strategy only has to implement
+ * chooseMove(); its statistics are kept by move().
+ */
+class Strategy
+{
+private:
+    std::string        name;    // name of the strategy, as registered
+    std::string description;    // what the strategy does, for the logs
+    StrategyStats     stats;    // counters of the moves chosen
+
+protected:
+    /**
+     * Chooses the next move of the robot. Strategies that may take longer than the time
+     * budget should report their best move so far with _ctx.report(), and return when
+     * _ctx.expired() (their move is not waited for past the deadline anyway).
+     *
+     * @param  _ctx the board and what is known about the game
+     * @return      the move (cell -1 if there is none)
+     */
+    virtual StrategyMove chooseMove(const StrategyContext &_ctx) = 0;
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _name        name of the strategy
+     * @param _description what the strategy does, for the logs
+     */
+    Strategy(const std::string &_name, const std::string &_description = "");
+
+    virtual ~Strategy() {};
+
+    /**
+     * Configures the strategy. Unknown keys are ignored.
+     *
+     * @param  _config the configuration
+     * @return         true/false if success/failure
+     */
+    virtual bool configure(const StrategyConfig &_config) { return true; };
+
+    /**
+     * Chooses the next move of the robot, and updates the statistics.
+     *
+     * @param  _ctx the board and what is known about the game
+     * @return      the move (cell -1 if there is none)
+     */
+    StrategyMove move(const StrategyContext &_ctx);
+
+    /**
+     * Resets the statistics.
+     */
+    void resetStats() { stats = StrategyStats(); };
+
+    /* Self-explaining "getters" */
+    const std::string&        getName() const { return        name; };
+    const std::string& getDescription() const { return description; };
+    const StrategyStats&     getStats() const { return       stats; };
+};
+
+typedef std::function<Strategy*(const std::string &_name)> StrategyFactory;
+
+/**
+ * Registry of the strategies, by name. The built-in ones ("random", "smart",
+ * "cheating" and "adaptive") are always there, and more can be added by the
+ * code that owns the registry or by plug-ins (shared libraries) loaded at runtime.
+ */
+class StrategyRegistry
+{
+private:
+    std::map<std::string, StrategyFactory> factories;
+    std::vector<void*>                       plugins;   // handles of the plug-ins loaded
+
+public:
+    /**
+     * Constructor. Registers the built-in strategies.
+     */
+    StrategyRegistry();
+
+    /**
+     * Plug-ins are never unloaded: strategies created from them may outlive the registry.
+     */
+    ~StrategyRegistry() {};
+
+    /**
+     * Registers a strategy.
+     *
+     * @param  _name    name of the strategy
+     * @param  _factory function that creates it (given its name)
+     * @return          true/false if success/failure (i.e. the name is already taken)
+     */
+    bool add(const std::string &_name, const StrategyFactory &_factory);
+
+    /**
+     * Creates a strategy.
+     *
+     * @param  _name name of the strategy
+     * @return       the strategy (NULL if there is no strategy with that name)
+     */
+    std::unique_ptr<Strategy> create(const std::string &_name) const;
+
+    /**
+     * Loads a plug-in, i.e. a shared library that exports a function
+     *     extern "C" void registerStrategies(baxter_tictactoe::StrategyRegistry &_registry);
+     * which adds its strategies to the registry.
+     *
+     * @param  _filename the shared library
+     * @return           true/false if success/failure
+     */
+    bool loadPlugin(const std::string &_filename);
+
+    /**
+     * Tells if a strategy is registered.
+     */
+    bool has(const std::string &_name) const { return factories.count(_name) > 0; };
+
+    /**
+     * Names of the strategies registered, in alphabetical order.
+     */
+    std::vector<std::string> getNames() const;
+};
+
+/**
+ * Runs strategies with a deadline. The strategy runs asynchronously, on its own copy of the
+ * board, and if it has not returned by the deadline the best move it has reported so far is
+ * played instead or, if there is none, the fallback move. A strategy that overran keeps running
+ * in the background until it returns, and meanwhile every move is a fallback one.
+ */
+class StrategyRunner
+{
+private:
+    /**
+     * What a running strategy needs, kept alive until it returns.
+     */
+    struct Task
+    {
+        Board               board;
+        StrategyContext       ctx;
+        AnytimeMove          best;
+    };
+
+    std::shared_ptr<Task>        task;  // last task run
+    std::future<StrategyMove> pending;  // result of the last task (valid until collected)
+    std::mt19937                  rng;  // random number generator of the fallback moves
+
+    LatencyHistogram          latency;  // time [s] taken to get every move
+    unsigned long               moves;  // moves chosen
+    unsigned long            overruns;  // strategies that missed their deadline
+    unsigned long             anytime;  // moves reported by strategies that missed their deadline
+    unsigned long           fallbacks;  // fallback moves
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _seed seed of the random number generator of the fallback moves
+     */
+    StrategyRunner(unsigned int _seed = 0);
+
+    /**
+     * Destructor. It waits for the strategy that is running, if any.
+     */
+    ~StrategyRunner();
+
+    /**
+     * Chooses the next move with a strategy, within the time budget of the context (no limit
+     * if not positive, in which case the strategy runs synchronously). The strategy has to be
+     * kept alive until it returns, i.e. until isBusy() is false or the runner is destroyed.
+     *
+     * @param  _strategy the strategy
+     * @param  _ctx      the board and what is known about the game
+     * @return           the move (cell -1 if there is none)
+     */
+    StrategyMove run(Strategy &_strategy, const StrategyContext &_ctx);
+
+    /**
+     * Tells if a strategy that overran is still running.
+     */
+    bool isBusy() const;
+
+    /**
+     * Waits for the strategy that is running, if any (e.g. before changing what it uses).
+     */
+    void wait();
+
+    /**
+     * Resets the metrics.
+     */
+    void resetStats();
+
+    /* Self-explaining "getters" */
+    const LatencyHistogram& getLatency() const { return   latency; };
+    unsigned long          getNumMoves() const { return     moves; };
+    unsigned long       getNumOverruns() const { return  overruns; };
+    unsigned long        getNumAnytime() const { return   anytime; };
+    unsigned long      getNumFallbacks() const { return fallbacks; };
+};
+
+}
+
+#endif // __STRATEGY_H__
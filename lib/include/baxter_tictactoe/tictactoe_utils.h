@@ -2,10 +2,12 @@
 #define __TICTACTOE_UTILS_H__
 
 #include <ros/ros.h>
+#include <functional>
 #include <sensor_msgs/image_encodings.h>
 #include <opencv2/core/core.hpp>
 
 #include "baxter_tictactoe/MsgBoard.h"
+#include "baxter_tictactoe/bitboard.h"
 
 namespace enc = sensor_msgs::image_encodings;
 
@@ -31,25 +33,95 @@ namespace baxter_tictactoe
 
 #define VOICE   "voice_kal_diphone"
 
+#define POLYGON_MAX_POINTS  8
+
 typedef std::vector<cv::Point>  Contour;
 typedef std::vector<Contour>    Contours;
 
+/**
+ * A polygon of up to POLYGON_MAX_POINTS points, stored inline (i.e. without touching
+ * the heap), such as the quadrilateral of a calibrated cell. It is a plain array of
+ * coordinates, so copying it is a flat copy of a few bytes.
+ */
+class Polygon
+{
+private:
+    int coords[2 * POLYGON_MAX_POINTS];  // x and y of the points, interleaved as in a CV_32SC2 matrix
+    int                              n;  // number of points
+
+public:
+    /* CONSTRUCTORS */
+    Polygon() : coords(), n(0) {};
+
+    /**
+     * Builds a polygon from a contour. Points beyond POLYGON_MAX_POINTS are dropped.
+     *
+     * @param _c the contour
+     */
+    Polygon(const Contour &_c);
+
+    /**
+     * Appends a point to the polygon.
+     *
+     * @param  _p the point
+     * @return    true/false if success/failure (i.e. the polygon is full)
+     */
+    bool push_back(const cv::Point &_p);
+
+    /**
+     * Removes all the points.
+     */
+    void clear() { n = 0; };
+
+    /**
+     * Wraps the points into a matrix header (Nx1, CV_32SC2), without copying them,
+     * so that the polygon can be passed to OpenCV wherever a point set is expected
+     * (e.g. cv::moments, cv::boundingRect). The header is valid as long as the
+     * polygon is alive and not modified.
+     *
+     * @return the matrix header
+     */
+    cv::Mat getMat() const;
+
+    /**
+     * Copies the points into a contour.
+     *
+     * @return the contour
+     */
+    Contour toContour() const;
+
+    /* Self-explaining "getters" */
+    size_t    size()               const { return n;                                           };
+    bool      empty()              const { return n == 0;                                      };
+    cv::Point operator[](size_t i) const { return cv::Point(coords[2 * i], coords[2 * i + 1]); };
+};
+
 class Cell
 {
+public:
+    enum CellState { STATE_EMPTY, STATE_RED, STATE_BLUE };
+
 private:
-    Contour     contour;
-    std::string   state;
+    static const std::string STATES[3];     // names of the states, indexed by CellState
+
+    Polygon     contour;
+    uint8_t       state;    // a CellState, so that the cell holds no heap memory
     size_t     area_red;
     size_t    area_blue;
 
 public:
-    /* CONSTRUCTORS */
-    Cell(            std::string _s = COL_EMPTY, int _ar = 0, int _ab = 0);
-    Cell(Contour _c, std::string _s = COL_EMPTY, int _ar = 0, int _ab = 0);
-    Cell(const Cell &_c);
+    /**
+     * Converts the name of a state (e.g. COL_RED) to a CellState.
+     *
+     * @param  _s the name of the state
+     * @return    the state, or -1 if the name is not allowed
+     */
+    static int parseState(const std::string& _s);
 
-    /* DESTRUCTOR */
-    ~Cell() {};
+    /* CONSTRUCTORS */
+    Cell() : state(STATE_EMPTY), area_red(0), area_blue(0) {};
+    Cell(                   const std::string &_s,             int _ar = 0, int _ab = 0);
+    Cell(const Polygon &_c, const std::string &_s = COL_EMPTY, int _ar = 0, int _ab = 0);
 
     /**
      * Checks for the integrity of the cell according to the state. If there
@@ -59,11 +131,6 @@ public:
      */
     bool checkIntegrity();
 
-    /**
-     * Assignment operator
-     */
-    Cell& operator=(const Cell& _c);
-
     /**
      * Comparison operator (isEqual). It compares only the state of the cell,
      * which is the only value that matters.
@@ -104,50 +171,96 @@ public:
      * @param      the original image, where the mask will be extracted from.
      * @return     the mask. It has the same size than the original image.
      */
-    cv::Mat maskImage(const cv::Mat &);
+    cv::Mat maskImage(const cv::Mat &) const;
 
     /**
      * Prints some useful information from the cell
      *
      * @return the string with the information
      */
-    std::string toString();
+    std::string toString() const;
 
     /* Self-explaining "getters" */
-    std::string getState()    { return state;     };
-    Contour     getContour()  { return contour;   };
-    cv::Point   getCentroid();
-    int         getContourArea();
-    int         getRedArea()  { return area_red;  };
-    int         getBlueArea() { return area_blue; };
+    const std::string& getState()       const { return STATES[state]; };
+    int                getStateCode()   const { return state;         };
+    const Polygon&     getContour()     const { return contour;       };
+    cv::Point          getCentroid()    const;
+    int                getContourArea() const;
+    int                getRedArea()     const { return area_red;      };
+    int                getBlueArea()    const { return area_blue;     };
 
     /* Self-explaining "setters" */
     bool setState(const std::string& _s);
+    bool setStateCode(int _s);      // _s is a CellState (false if it is not)
     void setRedArea (size_t _a) { area_red  = _a; };
     void setBlueArea(size_t _a) { area_blue = _a; };
 };
 
+/**
+ * A board made of up to NUMBER_OF_CELLS cells. Cells are stored inline, so copying
+ * a board is a flat copy of a few hundred bytes, and never allocates.
+ *
+ * Thread safety: all the const methods only read the board, so any number of threads
+ * can query the same board concurrently, as long as no thread modifies it at the same
+ * time. Boards shared between threads that can change (e.g. the one updated by a ROS
+ * callback) have to be protected by their owner, which usually hands out copies.
+ */
 class Board
 {
 private:
-    std::vector<Cell> cells;
+    Cell   cells[NUMBER_OF_CELLS];    // the cells, of which only the first n_cells are in use
+    size_t                n_cells;    // number of cells in use
+    uint64_t                 hash;    // zobrist hash of the cell states
+
+    /**
+     * Random-looking key of a cell in a given state, for the zobrist hash.
+     * Empty cells have a zero key, so the hash of an empty board is zero.
+     */
+    static uint64_t zobristKey(size_t i, int _s);
+
+    /**
+     * Recomputes the hash from scratch, after the states of many cells have changed.
+     */
+    void rehash();
+
+    /**
+     * Finds the cells in a particular state, as a bitmask (bit i is cell i).
+     * Only the first nine cells are considered.
+     *
+     * @param _s  The state of the cells (a Cell::CellState)
+     * @return    The set of cells
+     */
+    BitMask cellsInState(int _s) const;
+
+    /**
+     * Sets the state of a cell and updates the hash, without going through the state names.
+     *
+     * @param i   The cell
+     * @param _s  The new state (a Cell::CellState)
+     * @return    true/false if success/failure
+     */
+    bool setCellStateCode(size_t i, int _s);
 
 public:
     /* CONSTRUCTORS */
     Board();
-    Board(size_t n_cells);
-    Board(const Board &_b);
-
-    /* DESTRUCTOR */
-    ~Board();
+    Board(size_t _n_cells);
+    Board(const Board &_b) = default;
+    Board(Board &&_b) noexcept;
 
     /**
      * Assignment operator. Does not care about boards with different sizes.
      */
-    Board& operator=(const Board& _c);
+    Board& operator=(const Board& _b) = default;
+
+    /**
+     * Move assignment operator. The moved-from board is left empty.
+     */
+    Board& operator=(Board &&_b) noexcept;
 
     /**
-     * Comparison operator (isEqual).
+     * Comparison operator (isEqual). Boards with different hashes are told apart
+     * without looking at the cells.
      *
      * @return true/false if equal/different
      */
@@ -163,7 +276,8 @@ public:
     /**
      * Adds a cell to the board.
      *
-     * @param c The cell to be added.
+     * @param  _c The cell to be added.
+     * @return    true/false if success/failure (i.e. the board has NUMBER_OF_CELLS cells already)
      */
     bool addCell(const Cell& _c);
 
@@ -173,7 +287,7 @@ public:
      * @param      the original image.
      * @return     the masked image.
      */
-    cv::Mat maskImage(const cv::Mat &);
+    cv::Mat maskImage(const cv::Mat &) const;
 
     /**
      * Resets only the cells' states to empty
@@ -201,13 +315,13 @@ public:
      * Indicates if the board is full.
      * @return  true/false if full or not
      **/
-    bool isFull();
+    bool isFull() const;
 
     /**
      * Indicates if the board is empty.
      * @return  true/false if empty or not
      **/
-    bool isEmpty();
+    bool isEmpty() const;
 
     /**
      * Counts the total number of tokens on the board.
@@ -215,7 +329,7 @@ public:
      *
      * @return The number of cells where there is a red or blue token.
      **/
-    size_t getNumTokens();
+    size_t getNumTokens() const;
 
     /**
      * Counts the number of tokens of a particular color on the board.
@@ -223,7 +337,7 @@ public:
      * @param _col  The color of tokens we are counting
      * @return      The number of cells where there is a _col token.
      **/
-    size_t getNumTokens(const std::string& _col);
+    size_t getNumTokens(const std::string& _col) const;
 
     /**
      * Checks if one token of any color has been either added to or removed from the
@@ -233,7 +347,7 @@ public:
      * @param  _new new board to check against
      * @return      true/false if success/failure
      */
-    bool isOneTokenAddedRemoved(const Board& _new);
+    bool isOneTokenAddedRemoved(const Board& _new) const;
 
     /**
      * Checks if one token of any color has been added to the board by
@@ -243,7 +357,7 @@ public:
      * @param  _new new board to check against
      * @return      true/false if success/failure
      */
-    bool isOneTokenAdded(const Board& _new);
+    bool isOneTokenAdded(const Board& _new) const;
 
     /**
      * Checks if one token of a specific color has been added to the board by
@@ -254,7 +368,7 @@ public:
      * @param  _col The color of tokens to check against
      * @return      true/false if success/failure
      */
-    bool isOneTokenAdded(const Board &_new, const std::string& _col);
+    bool isOneTokenAdded(const Board &_new, const std::string& _col) const;
 
     /**
      * Checks if one token of any color has been removed from the board by
@@ -264,7 +378,7 @@ public:
      * @param  _new new board to check against
      * @return      true/false if success/failure
      */
-    bool isOneTokenRemoved(const Board& _new);
+    bool isOneTokenRemoved(const Board& _new) const;
 
     /**
      * Checks if one token of a specific color has been removed from the board by
@@ -275,7 +389,7 @@ public:
      * @param  _col The color of tokens to check against
      * @return      true/false if success/failure
      */
-    bool isOneTokenRemoved(const Board &_new, const std::string& _col);
+    bool isOneTokenRemoved(const Board &_new, const std::string& _col) const;
 
     /**
      * Checks if there are 3 tokens of any color in a row. In a 3x3 board there
@@ -283,7 +397,7 @@ public:
      *
      * @return True in case of a 3 token row is found, false otherwise.
      **/
-    bool threeInARow();
+    bool threeInARow() const;
 
     /**
      * Checks if there are 3 tokens of the same color in a row. In a 3x3 board there
@@ -293,7 +407,51 @@ public:
      *
      * @return True in case of a 3 token row of the specific color is found.
      **/
-    bool threeInARow(const std::string& _col);
+    bool threeInARow(const std::string& _col) const;
+
+    /**
+     * Finds the cells of a particular color, as a bitmask (bit i is cell i).
+     * Only the first nine cells are considered.
+     *
+     * @param _col  The color of the cells (COL_EMPTY for the empty ones)
+     * @return      The set of cells
+     **/
+    BitMask getCells(const std::string& _col) const;
+
+    /**
+     * Finds the legal moves, i.e. the empty cells. To iterate over them:
+     *     for (BitMask m = b.legalMoves(); m != 0; m &= m - 1) { int move = lowestCell(m); }
+     *
+     * @return The set of cells where a token can be placed
+     **/
+    BitMask legalMoves() const { return cellsInState(Cell::STATE_EMPTY); };
+
+    /**
+     * Plays a legal move, i.e. places a token on an empty cell.
+     *
+     * @param _move The cell (from 0 to getNumCells()-1)
+     * @param _col  The color of the token
+     * @return      true/false if success/failure (e.g. the cell is not empty)
+     **/
+    bool play(size_t _move, const std::string& _col);
+
+    /**
+     * Undoes a move played with play(), i.e. empties the cell.
+     *
+     * @param _move The cell (from 0 to getNumCells()-1)
+     * @return      true/false if success/failure (e.g. the cell is already empty)
+     **/
+    bool undo(size_t _move);
+
+    /**
+     * Checks if a move would complete a row of three tokens of a particular color.
+     * Only the lines through the cell are checked, and the board is not modified.
+     *
+     * @param _move The cell (from 0 to 8)
+     * @param _col  The color of the token
+     * @return      true/false if the cell is empty and the move wins or not
+     **/
+    bool wouldWin(size_t _move, const std::string& _col) const;
 
     /**
      * Converts a MsgBoard object to the board.
@@ -305,26 +463,50 @@ public:
      *
      * @return the MsgBoard
      */
-    baxter_tictactoe::MsgBoard toMsgBoard();
+    baxter_tictactoe::MsgBoard toMsgBoard() const;
 
     /**
      * Print function.
      *
      * @return A text description of the board
      */
-    std::string toString();
+    std::string toString() const;
+
+    /**
+     * Computes the bounding rectangle of the contours of all the cells.
+     *
+     * @return the bounding rectangle (empty if the cells have no contours)
+     */
+    cv::Rect getBoundingRect() const;
+
+    /**
+     * Gets the 64-bit zobrist hash of the states of the cells. It is updated in O(1) by
+     * setCellState(), play() and undo(), so it is always up to date as long as the states
+     * are changed through the board (and not through the cells returned by getCell()).
+     *
+     * @return the hash (0 for an empty board)
+     */
+    uint64_t getHash() const { return hash; };
+
+    /**
+     * Gets the contours of the cells, as matrix headers over their points (see Polygon::getMat()),
+     * ready to be drawn with cv::drawContours. They are valid as long as the board is not modified.
+     *
+     * @return the contours of the cells
+     */
+    std::vector<cv::Mat> getContours() const;
 
     /* Self-explaining "getters" */
-    Contours    getContours();
-    size_t      getNumCells()             { return cells.size();              };
+    size_t             getNumCells()                    const { return n_cells;                   };
 
-    Cell&       getCell(size_t i)         { return cells[i];                  };
-    int         getCellArea(size_t i)     { return cells[i].getContourArea(); };
-    int         getCellAreaRed(size_t i)  { return cells[i].getRedArea();     };
-    int         getCellAreaBlue(size_t i) { return cells[i].getBlueArea();    };
-    std::string getCellState(size_t i)    { return cells[i].getState();       };
-    Contour     getCellContour(size_t i)  { return cells[i].getContour();     };
-    cv::Point   getCellCentroid(size_t i) { return cells[i].getCentroid();    };
+    Cell&              getCell(size_t i)                      { return cells[i];                  };
+    const Cell&        getCell(size_t i)                const { return cells[i];                  };
+    int                getCellArea(size_t i)            const { return cells[i].getContourArea(); };
+    int                getCellAreaRed(size_t i)         const { return cells[i].getRedArea();     };
+    int                getCellAreaBlue(size_t i)        const { return cells[i].getBlueArea();    };
+    const std::string& getCellState(size_t i)           const { return cells[i].getState();       };
+    const Polygon&     getCellContour(size_t i)         const { return cells[i].getContour();     };
+    cv::Point          getCellCentroid(size_t i)        const { return cells[i].getCentroid();    };
 
     /* Self-explaining "setters" */
     bool setCellState(size_t i, const std::string& _s);
@@ -333,4 +515,15 @@ public:
 
 }
 
+namespace std
+{
+    /**
+     * Hash of a board, to be used in unordered containers.
+     */
+    template<> struct hash<baxter_tictactoe::Board>
+    {
+        size_t operator()(const baxter_tictactoe::Board &_b) const { return _b.getHash(); }
+    };
+}
+
 #endif // __TICTACTOE_UTILS_H__
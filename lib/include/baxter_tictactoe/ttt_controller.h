@@ -16,6 +16,7 @@
 #include <robot_interface/gripper.h>
 
 #include "tictactoe_utils.h"
+#include "vision_utils.h"
 
 #define HOVER_BOARD_X   0.575  // [m]
 #define HOVER_BOARD_Y   0.100  // [m]
@@ -34,6 +35,8 @@ private:
     hsvColorRange  hsv_red;
     hsvColorRange hsv_blue;
 
+    baxter_tictactoe::Thresholder black_thresholder;   // isolates the black board boundaries
+
     geometry_msgs::Point _tiles_pile_pos;
 
     std::vector<geometry_msgs::Point>  _offsets;   // Legacy, it does not work
@@ -0,0 +1,363 @@
+#ifndef __VISION_UTILS_H__
+#define __VISION_UTILS_H__
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <robot_perception/hsv_detection.h>
+
+#include "baxter_tictactoe/tictactoe_utils.h"
+
+#define DETECT_CONTOURS     0   // cell areas counted within the cell contours
+#define DETECT_INTEGRAL     1   // cell areas read from integral images of the rectified board
+
+#define THRESH_MODE_FIXED       0   // global threshold, fixed value
+#define THRESH_MODE_OTSU        1   // global threshold, computed with Otsu's method
+#define THRESH_MODE_ADAPTIVE    2   // local threshold, mean of a window around each pixel
+
+namespace baxter_tictactoe
+{
+
+/**
+ * Runs a sequence of 3x3 binary erosions and dilations on a mask, with the same
+ * result as the equivalent chain of cv::erode / cv::dilate calls (with default
+ * kernel and border). The mask is bit-packed (64 pixels per word), and the whole
+ * sequence is applied strip by strip, so that every strip stays in cache for all
+ * the operations instead of streaming the full frame once per operation.
+ *
+ * @param _src       the binary mask (CV_8UC1, nonzero pixels are set)
+ * @param _dst       the output mask (0/255 values, it can be the same as _src)
+ * @param _ops       the operations (cv::MORPH_ERODE or cv::MORPH_DILATE), in order
+ * @param _tile_rows number of output rows processed per strip
+ */
+void binaryMorphology(const cv::Mat &_src, cv::Mat &_dst, const std::vector<int> &_ops,
+                      int _tile_rows = 32);
+
+/**
+ * Counts the pixels within a region of a binary mask once smoothed, i.e. the pixels
+ * that have at least one set pixel of the region in their 3x3 neighborhood. It gives
+ * the same result as masking the image to the region, blurring it with a 3x3
+ * Gaussian kernel and counting the nonzero pixels, but only the bounding rectangle
+ * of the region is processed (by means of an integral image).
+ *
+ * @param  _bin  the binary mask (CV_8UC1)
+ * @param  _rect the bounding rectangle of the region
+ * @param  _mask the mask of the region, as big as _rect
+ * @param  _buf  caller-provided buffer for the integral image
+ * @return       the number of pixels
+ */
+int countSmoothedArea(const cv::Mat &_bin, const cv::Rect &_rect, const cv::Mat &_mask,
+                      cv::Mat &_buf);
+
+/**
+ * Binarizes grayscale images: pixels brighter than the threshold are set to 255,
+ * the others to 0. A fixed global threshold fails under uneven lighting (e.g.
+ * spotlights), so the threshold can also be computed at every frame, either
+ * globally with Otsu's method (optionally on a region of interest only, e.g.
+ * the board), or locally as the mean of a window around each pixel minus an
+ * offset. The local means come from an integral image, so that the cost per
+ * pixel does not depend on the size of the window. A window without contrast
+ * (e.g. inside a dark region wider than half the window) is no darker than its
+ * own mean, so in that case the fixed threshold is used instead.
+ */
+class Thresholder
+{
+private:
+    int         mode;   // THRESH_MODE_FIXED, THRESH_MODE_OTSU or THRESH_MODE_ADAPTIVE
+    double     value;   // threshold in THRESH_MODE_FIXED mode
+    int        block;   // side of the window in THRESH_MODE_ADAPTIVE mode [pixels]
+    double    offset;   // offset from the local mean in THRESH_MODE_ADAPTIVE mode
+    double  contrast;   // min standard deviation of a window to use its mean in THRESH_MODE_ADAPTIVE mode
+
+    cv::Rect     roi;   // region Otsu's threshold is computed on (the whole image if empty)
+    cv::Mat      sum;   // integral image, reused across frames
+    cv::Mat    sqsum;   // integral image of the squares, reused across frames
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _mode     THRESH_MODE_FIXED, THRESH_MODE_OTSU or THRESH_MODE_ADAPTIVE
+     * @param _value    threshold in THRESH_MODE_FIXED mode (and in uniform windows)
+     * @param _block    side of the window in THRESH_MODE_ADAPTIVE mode [pixels]
+     * @param _offset   offset from the local mean in THRESH_MODE_ADAPTIVE mode
+     * @param _contrast min standard deviation of a window in THRESH_MODE_ADAPTIVE mode:
+     *                  pixels whose window is more uniform than that are compared with _value
+     */
+    Thresholder(int _mode = THRESH_MODE_FIXED, double _value = 100.0,
+                int _block = 31, double _offset = 10.0, double _contrast = 5.0);
+
+    /**
+     * Binarizes a grayscale image.
+     *
+     * @param  _gray   the grayscale image (CV_8UC1)
+     * @param  _binary the binary image
+     * @return         the global threshold used (-1 in THRESH_MODE_ADAPTIVE mode)
+     */
+    double apply(const cv::Mat &_gray, cv::Mat &_binary);
+
+    /**
+     * Parses the name of a threshold mode.
+     *
+     * @param  _name "fixed", "otsu" or "adaptive"
+     * @return       the mode (THRESH_MODE_FIXED if the name is unknown)
+     */
+    static int modeFromString(const std::string &_name);
+
+    /* Self-explaining "getters" */
+    int    getMode()   { return   mode; };
+    double getValue()  { return  value; };
+    int    getBlock()  { return  block; };
+    double getOffset() { return offset; };
+    double getContrast() { return contrast; };
+
+    /* Self-explaining "setters" */
+    void setRoi(const cv::Rect &_roi) { roi = _roi; };
+};
+
+/**
+ * Calibrates the board by fitting a 3x3 grid to the cell-like blobs of a binary
+ * image (i.e. the white cells of the board). Every contour whose polygonal
+ * approximation is a convex quadrilateral is a candidate cell, and a lattice
+ * (center o and axes u, v, so that cell (i,j) is at o + i*u + j*v) is fitted to
+ * their centroids with RANSAC: two candidates generate a hypothesis (the first
+ * at any of the 9 positions, the second as its neighbor), which is then refined
+ * by least squares on its inliers. The fit is invariant to rotation and scale.
+ * The cells are added to the board row by row in a canonical orientation: u is
+ * the lattice axis closest to the x axis of the image, and v is u rotated by 90
+ * degrees (i.e. pointing down for a board that is not rotated).
+ *
+ * The quality of the fit, in [0, 1], is the product of how close the centroids
+ * of the cells are to the lattice and the ratio between the smallest and the
+ * largest cell area. It is 0 if not all the cells have been found.
+ *
+ * @param  _binary     the binary image
+ * @param  _min_area   the minimum area of a cell [pixels]
+ * @param  _board      the board (reset, and filled only if all the cells are found)
+ * @param  _iterations maximum number of hypotheses
+ * @return             the quality of the fit (0 if no grid has been found)
+ */
+double fitBoardGrid(const cv::Mat &_binary, double _min_area, Board &_board,
+                    int _iterations = 300);
+
+/**
+ * Classifies the pixels of an HSV image into red and blue tokens. The board
+ * mask is computed once (at calibration), and only the pixels within the
+ * bounding rectangle of the board are processed. Masking and thresholding are
+ * fused into a single pass that uses per-channel lookup tables, so that the
+ * (possibly wrapping) hue ranges cost the same as the plain ones.
+ */
+class ColorClassifier
+{
+private:
+    uint8_t lut_h[256];     // bit 0 set if the value is in the red  range,
+    uint8_t lut_s[256];     // bit 1 set if the value is in the blue range
+    uint8_t lut_v[256];
+
+    cv::Mat      mask;      // mask of the board, as big as roi
+    cv::Rect      roi;      // bounding rectangle of the board
+    cv::Rect old_roi;       // roi before the last call to setBoard (to be cleared)
+
+    /**
+     * Fills a lookup table for a channel.
+     *
+     * @param _lut   the lookup table
+     * @param _range the range of values
+     * @param _bit   the bit to set for the values in the range
+     */
+    static void fillLUT(uint8_t *_lut, const colorRange &_range, uint8_t _bit);
+
+public:
+    ColorClassifier();
+
+    /**
+     * Sets the color ranges of the tokens.
+     *
+     * @param _red  range of the red  tokens
+     * @param _blue range of the blue tokens
+     */
+    void setColors(const hsvColorRange &_red, const hsvColorRange &_blue);
+
+    /**
+     * Computes and caches the mask of the board. To be called once the board
+     * has been calibrated.
+     *
+     * @param  _board the board
+     * @param  _size  size of the images to be classified
+     * @return        true/false if success/failure (i.e. the board has no contours)
+     */
+    bool setBoard(const Board &_board, const cv::Size &_size);
+
+    /**
+     * Classifies an HSV image into red and blue binary masks (255 for the token
+     * pixels, 0 otherwise). Only the pixels within the bounding rectangle of the
+     * board are processed: the output buffers are allocated and zeroed when their
+     * size changes, and only the board region is written afterwards. For this
+     * reason, the same buffers are expected to be used at every call.
+     *
+     * @param _hsv  the HSV image
+     * @param _red  the red  mask (caller-provided buffer)
+     * @param _blue the blue mask (caller-provided buffer)
+     * @return      true/false if success/failure (i.e. the board has not been set)
+     */
+    bool classify(const cv::Mat &_hsv, cv::Mat &_red, cv::Mat &_blue);
+
+    /* Self-explaining "getters" */
+    cv::Rect getRoi()  { return  roi; };
+    cv::Mat  getMask() { return mask; };
+};
+
+/**
+ * Detects the state of the cells of a calibrated board. Frames can be processed
+ * at a lower resolution than the camera one: they are downsampled through an
+ * image pyramid (each level halves the resolution), and the board geometry and
+ * the area threshold are expressed in the coordinates of the processing level.
+ * Each cell covers thousands of pixels at full resolution, so that a couple of
+ * levels trade a little precision for a large cut in per-frame CPU.
+ */
+class BoardDetector
+{
+private:
+    int                    levels;  // number of pyramid levels (0 means full resolution)
+    double         area_threshold;  // minimum area for a cell to be colored, at full resolution
+
+    int                      mode;  // DETECT_CONTOURS or DETECT_INTEGRAL
+    double            inner_ratio;  // fraction of the side of the rectified cells that is counted
+
+    ColorClassifier    classifier;  // in DETECT_INTEGRAL mode, it works on the rectified board
+
+    std::vector<cv::Rect> cell_rects;   // bounding rectangles of the cells
+    std::vector<cv::Mat>  cell_masks;   // masks of the cells, as big as their rectangles
+
+    cv::Rect            board_roi;  // bounding rectangle of the board
+    cv::Mat            homography;  // from the board roi to the rectified board
+    int                 cell_side;  // side of the cells in the rectified board
+    std::vector<double> cell_scale; // from rectified areas to the areas of the cells
+
+    std::vector<cv::Mat>  pyramid;  // buffers reused across frames, so that
+    cv::Mat              img_proc;  // they are not allocated at every frame
+    cv::Mat              img_rect;
+    cv::Mat               img_hsv;
+    cv::Mat               img_red;
+    cv::Mat              img_blue;
+    cv::Mat              integral;
+    cv::Mat               sum_red;
+    cv::Mat              sum_blue;
+
+    /**
+     * Computes the red and blue areas of the cells within their contours.
+     *
+     * @param _board the board
+     */
+    void countContours(Board &_board);
+
+    /**
+     * Computes the red and blue areas of the cells from the integral images of
+     * the rectified board, within the central part of each cell. The counts are
+     * extrapolated to the whole cell, so that the areas (and the area threshold)
+     * mean the same as in DETECT_CONTOURS mode.
+     *
+     * @param _board the board
+     */
+    void countIntegral(Board &_board);
+
+    /**
+     * Computes the homography that rectifies the board, from the centroids of
+     * the corner cells. The rectified board is a 3x3 grid of square cells.
+     *
+     * @param  _board the board
+     * @return        true/false if success/failure
+     */
+    bool setRectification(const Board &_board);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _levels         number of pyramid levels
+     * @param _area_threshold minimum area for a cell to be colored, at full resolution
+     */
+    BoardDetector(int _levels = 0, double _area_threshold = 0.0);
+
+    /**
+     * Sets the color ranges of the tokens.
+     *
+     * @param _red  range of the red  tokens
+     * @param _blue range of the blue tokens
+     */
+    void setColors(const hsvColorRange &_red, const hsvColorRange &_blue);
+
+    /**
+     * Downsamples a frame to the processing resolution.
+     *
+     * @param  _img the frame, at full resolution
+     * @return      the frame at the processing resolution (valid until the next call)
+     */
+    const cv::Mat& downscale(const cv::Mat &_img);
+
+    /**
+     * Sets the detection mode. In DETECT_INTEGRAL mode, the board is rectified
+     * so that the cells are axis-aligned squares, and the areas of all the cells
+     * are read from one integral image per color: per-frame work beyond the
+     * classification does not depend on the number (or size) of the cells.
+     * To be called before setBoard.
+     *
+     * @param _mode        DETECT_CONTOURS or DETECT_INTEGRAL
+     * @param _inner_ratio fraction of the side of each cell that is counted in DETECT_INTEGRAL
+     *                     mode (e.g. 0.6 ignores tokens straddling the grid lines)
+     */
+    void setMode(int _mode, double _inner_ratio = 0.6);
+
+    /**
+     * Sets the board to detect, once it has been calibrated.
+     *
+     * @param  _board the board, in the coordinates of the processing resolution
+     * @param  _size  size of the frames at the processing resolution
+     * @return        true/false if success/failure
+     */
+    bool setBoard(const Board &_board, const cv::Size &_size);
+
+    /**
+     * Detects the state of the cells of a board on a frame. It computes the red and
+     * blue area of each cell, and updates the state of the cells accordingly.
+     *
+     * @param  _img   the frame, at full resolution
+     * @param  _board the board, in the coordinates of the processing resolution
+     * @return        true/false if success/failure
+     */
+    bool detect(const cv::Mat &_img, Board &_board);
+
+    /**
+     * Converts a contour from the processing resolution to the full one.
+     *
+     * @param  _c the contour at the processing resolution
+     * @return    the contour at full resolution
+     */
+    Polygon toFullRes(const Polygon &_c);
+
+    /**
+     * Converts a point from the processing resolution to the full one.
+     *
+     * @param  _p the point at the processing resolution
+     * @return    the point at full resolution
+     */
+    cv::Point toFullRes(const cv::Point &_p) { return _p * (1 << levels); };
+
+    /* Self-explaining "getters" */
+    int     getLevels()        { return levels;                                };
+    int     getMode()          { return mode;                                  };
+    double  getScale()         { return 1.0 / (1 << levels);                   };
+    double  getAreaThreshold() { return area_threshold / (1 << (2 * levels));  };
+    cv::Rect getRoi()          { return board_roi;                             };
+    cv::Mat getRedMask()       { return img_red;                               };
+    cv::Mat getBlueMask()      { return img_blue;                              };
+
+    /* Self-explaining "setters" */
+    void setAreaThreshold(double _a) { area_threshold = _a; };
+};
+
+}
+
+#endif // __VISION_UTILS_H__
@@ -0,0 +1,192 @@
+#include "baxter_tictactoe/board_analysis.h"
+
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+/**************************************************************************/
+/**                          MOVE ACCEPTOR                               **/
+/**************************************************************************/
+
+MoveAcceptor::MoveAcceptor(double _false_accept, double _false_reject,
+                           double _hit_rate,     double _false_rate, double _min_time) :
+                           min_time(std::max(_min_time, 0.0)), llr(0.0), t_first(0.0),
+                           has_candidate(false), n_obs(0)
+{
+    // Rates are kept away from 0 and 1, where the logarithms diverge
+    _false_accept = std::min(std::max(_false_accept, 1e-9), 0.5);
+    _false_reject = std::min(std::max(_false_reject, 1e-9), 0.5);
+    _hit_rate     = std::min(std::max(_hit_rate,     1e-3), 1.0 - 1e-3);
+    _false_rate   = std::min(std::max(_false_rate,   1e-3), _hit_rate - 1e-3);
+
+    llr_support = log(       _hit_rate  /        _false_rate);
+    llr_against = log((1.0 - _hit_rate) / (1.0 - _false_rate));
+
+    upper = log((1.0 - _false_reject) /        _false_accept);
+    lower = log(       _false_reject  / (1.0 - _false_accept));
+}
+
+int MoveAcceptor::update(bool _supports, const Board &_board, double _time)
+{
+    if (_supports && has_candidate && not (_board == candidate))
+    {
+        reset();
+    }
+
+    if (_supports && not has_candidate)
+    {
+        candidate     = _board;
+        has_candidate = true;
+        t_first       = _time;
+    }
+
+    // Readings that do not support anything are only relevant while there is a candidate
+    if (not has_candidate)  { return SPRT_CONTINUE; }
+
+    llr += _supports ? llr_support : llr_against;
+    ++n_obs;
+
+    if (llr >= upper)
+    {
+        if (_time - t_first >= min_time)    { return SPRT_ACCEPT; }
+
+        // Enough evidence, but not for long enough: more of it would only slow down a rejection
+        llr = upper;
+    }
+
+    if (llr <= lower)
+    {
+        reset();
+        return SPRT_REJECT;
+    }
+
+    return SPRT_CONTINUE;
+}
+
+void MoveAcceptor::reset()
+{
+    llr           = 0.0;
+    has_candidate = false;
+    n_obs         = 0;
+    candidate.resetCellStates();
+}
+
+/**************************************************************************/
+/**                        TRANSITION ANALYZER                           **/
+/**************************************************************************/
+
+bool Transition::sameAs(const Transition &_t) const
+{
+    return type == _t.type && added == _t.added && removed == _t.removed && changed == _t.changed;
+}
+
+Transition baxter_tictactoe::classifyTransition(const Board &_ref, const Board &_new, const string &_col)
+{
+    Transition t;
+    t.frames = 1;
+
+    if (_ref.getNumCells() != _new.getNumCells()) { return t; }
+
+    string added_col = COL_EMPTY;
+
+    for (size_t i = 0; i < _ref.getNumCells(); ++i)
+    {
+        const string &s0 = _ref.getCellState(i);
+        const string &s1 = _new.getCellState(i);
+
+        if (s0 == s1)             { continue; }
+
+        if      (s0 == COL_EMPTY)
+        {
+            t.added.push_back(i);
+            added_col = s1;
+        }
+        else if (s1 == COL_EMPTY) { t.removed.push_back(i); }
+        else                      { t.changed.push_back(i); }
+    }
+
+    if (not t.changed.empty() || (not t.removed.empty() && not t.added.empty()))
+    {
+        t.type = TRANS_SWAP;
+    }
+    else if (not t.removed.empty())
+    {
+        t.type = TRANS_REMOVE;
+    }
+    else if (t.added.size() > 1)
+    {
+        t.type = TRANS_MULTI_ADD;
+    }
+    else if (t.added.size() == 1)
+    {
+        t.type = added_col == _col ? TRANS_ADD : TRANS_ADD_WRONG;
+    }
+
+    return t;
+}
+
+bool baxter_tictactoe::isIllegalTransition(int _type)
+{
+    return _type == TRANS_ADD_WRONG || _type == TRANS_MULTI_ADD ||
+           _type == TRANS_REMOVE    || _type == TRANS_SWAP;
+}
+
+TransitionAnalyzer::TransitionAnalyzer(size_t _confirm_frames, size_t _occlusion_frames) :
+                                       confirm_frames(std::max(_confirm_frames, size_t(1))),
+                                       occlusion_frames(_occlusion_frames), col(COL_EMPTY),
+                                       last_emitted(TRANS_NONE)
+{
+
+}
+
+void TransitionAnalyzer::setReference(const Board &_ref, const string &_col)
+{
+    ref          = _ref;
+    col          = _col;
+    pending      = Transition();
+    last_emitted = TRANS_NONE;
+}
+
+bool TransitionAnalyzer::update(const Board &_new, Transition &_event)
+{
+    Transition t = classifyTransition(ref, _new, col);
+
+    if (t.sameAs(pending)) { ++pending.frames; }
+    else                   { pending = t;      }
+
+    // Going back to the reference board is only worth an event after an illegal move
+    if (pending.type == TRANS_NONE)
+    {
+        if (last_emitted != TRANS_NONE && pending.frames == confirm_frames)
+        {
+            bool was_illegal = isIllegalTransition(last_emitted);
+
+            _event       = pending;
+            last_emitted = TRANS_NONE;
+            return was_illegal;
+        }
+
+        return false;
+    }
+
+    bool may_be_occlusion = not pending.removed.empty() && occlusion_frames > confirm_frames;
+
+    if (pending.frames == confirm_frames)
+    {
+        _event = pending;
+        if (may_be_occlusion) { _event.type = TRANS_OCCLUSION; }
+    }
+    else if (may_be_occlusion && pending.frames == occlusion_frames)
+    {
+        _event = pending;
+    }
+    else
+    {
+        return false;
+    }
+
+    last_emitted = _event.type;
+    return true;
+}
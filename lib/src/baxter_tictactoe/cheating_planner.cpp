@@ -0,0 +1,183 @@
+#include "baxter_tictactoe/cheating_planner.h"
+
+#include <stdlib.h>
+#include <algorithm>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+#define MEMO_SIZE       (size_t(1) << 19)
+#define MINIMAX_UNKNOWN 2
+#define EXPECTED_UNKNOWN -1.0f
+
+BitBoard baxter_tictactoe::makeBitBoard(const Board &_b, const string &_robot_col, const string &_opp_col)
+{
+    return BitBoard(_b.getCells(_robot_col), _b.getCells(_opp_col));
+}
+
+/**************************************************************************/
+/**                         CHEATING PLANNER                             **/
+/**************************************************************************/
+
+CheatingPlanner::CheatingPlanner(double _skill) : skill(std::min(std::max(_skill, 0.0), 1.0)),
+                                                  minimax(MEMO_SIZE, MINIMAX_UNKNOWN),
+                                                  expected(MEMO_SIZE, EXPECTED_UNKNOWN)
+{
+
+}
+
+void CheatingPlanner::setSkill(double _skill)
+{
+    _skill = std::min(std::max(_skill, 0.0), 1.0);
+
+    if (_skill == skill) { return; }
+
+    skill = _skill;
+    std::fill(expected.begin(), expected.end(), EXPECTED_UNKNOWN);
+}
+
+int CheatingPlanner::getMinimax(const BitBoard &_b, bool _robot_turn)
+{
+    if (hasLine(_b.robot)) { return  1; }
+    if (hasLine(_b.opp))   { return -1; }
+    if (_b.isFull())       { return  0; }
+
+    int8_t &memo = minimax[index(_b, _robot_turn)];
+    if (memo != MINIMAX_UNKNOWN) { return memo; }
+
+    int best = _robot_turn ? -1 : 1;
+
+    for (BitMask m = _b.empty(); m != 0; m &= m - 1)
+    {
+        BitMask c = m & -m;
+        int v = _robot_turn ? getMinimax(BitBoard(_b.robot | c, _b.opp), false) :
+                              getMinimax(BitBoard(_b.robot, _b.opp | c), true);
+
+        best = _robot_turn ? std::max(best, v) : std::min(best, v);
+    }
+
+    memo = best;
+    return best;
+}
+
+float CheatingPlanner::getExpected(const BitBoard &_b, bool _robot_turn)
+{
+    if (hasLine(_b.robot)) { return 1.0f; }
+    if (hasLine(_b.opp))   { return 0.0f; }
+    if (_b.isFull())       { return 0.5f; }
+
+    float &memo = expected[index(_b, _robot_turn)];
+    if (memo != EXPECTED_UNKNOWN) { return memo; }
+
+    float res = 0.0f;
+
+    if (_robot_turn)
+    {
+        for (BitMask m = _b.empty(); m != 0; m &= m - 1)
+        {
+            res = std::max(res, getExpected(BitBoard(_b.robot | (m & -m), _b.opp), false));
+        }
+    }
+    else
+    {
+        // The opponent plays one of its optimal moves with probability skill,
+        // and any move with probability 1 - skill (all uniformly)
+        int   best_minimax = 1;
+        float sum_all = 0.0f, sum_best = 0.0f;
+        int   n_all   = 0,    n_best   = 0;
+
+        for (BitMask m = _b.empty(); m != 0; m &= m - 1)
+        {
+            BitBoard next(_b.robot, _b.opp | (m & -m));
+            int   mm = getMinimax(next, true);
+            float ex = getExpected(next, true);
+
+            if (mm < best_minimax)
+            {
+                best_minimax = mm;
+                sum_best = 0.0f;
+                n_best   = 0;
+            }
+
+            if (mm == best_minimax)
+            {
+                sum_best += ex;
+                ++n_best;
+            }
+
+            sum_all += ex;
+            ++n_all;
+        }
+
+        res = skill * sum_best / n_best + (1.0 - skill) * sum_all / n_all;
+    }
+
+    memo = res;
+    return res;
+}
+
+CheatPlan CheatingPlanner::bestMove(const BitBoard &_b)
+{
+    CheatPlan res;
+
+    if (hasLine(_b.robot) || hasLine(_b.opp)) { return res; }
+
+    for (BitMask m = _b.empty(); m != 0; m &= m - 1)
+    {
+        BitMask c = m & -m;
+        double  v = getExpected(BitBoard(_b.robot | c, _b.opp), false);
+
+        if (res.cell == -1 || v > res.value)
+        {
+            res.cell  = lowestCell(c);
+            res.value = v;
+        }
+    }
+
+    return res;
+}
+
+CheatPlan CheatingPlanner::bestCheat(const BitBoard &_b, int _last_opp, double _tolerance)
+{
+    CheatPlan res;
+
+    if (hasLine(_b.robot) || hasLine(_b.opp)) { return res; }
+
+    std::vector<CheatPlan> cheats;
+    double best_value = 0.0;
+
+    for (BitMask m = _b.opp; m != 0; m &= m - 1)
+    {
+        BitMask c = m & -m;
+
+        CheatPlan p;
+        p.cell  = lowestCell(c);
+        p.value = getExpected(BitBoard(_b.robot | c, _b.opp & ~c), false);
+
+        // The closer to the last move of the opponent, the more it is noticed
+        // (the manhattan distance between two cells is at most 4)
+        if (_last_opp >= 0)
+        {
+            int d = abs(p.cell / 3 - _last_opp / 3) + abs(p.cell % 3 - _last_opp % 3);
+            p.noticeability = 1.0 - d / 4.0;
+        }
+
+        best_value = std::max(best_value, p.value);
+        cheats.push_back(p);
+    }
+
+    for (size_t i = 0; i < cheats.size(); ++i)
+    {
+        const CheatPlan &p = cheats[i];
+
+        if (p.value < best_value - _tolerance) { continue; }
+
+        if (res.cell == -1 || p.noticeability < res.noticeability ||
+            (p.noticeability == res.noticeability && p.value > res.value))
+        {
+            res = p;
+        }
+    }
+
+    return res;
+}
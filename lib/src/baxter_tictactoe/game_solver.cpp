@@ -0,0 +1,354 @@
+#include "baxter_tictactoe/game_solver.h"
+
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+#define SCORE_INF   127
+
+/**************************************************************************/
+/**                               NK GAME                                **/
+/**************************************************************************/
+
+NKGame::NKGame(int _n, int _k) : n(std::min(std::max(_n, 1), MAX_GAME_SIDE)),
+                                 k(std::min(std::max(_k, 1), n)),
+                                 full((1u << (n * n)) - 1), cell_lines(n * n)
+{
+    // Rows, columns, diagonals and anti-diagonals (single cells only once)
+    const int dirs[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+
+    for (int d = 0; d < (k == 1 ? 1 : 4); ++d)
+    {
+        for (int r = 0; r < n; ++r)
+        {
+            for (int c = 0; c < n; ++c)
+            {
+                int r_end = r + (k - 1) * dirs[d][0];
+                int c_end = c + (k - 1) * dirs[d][1];
+                if (r_end < 0 || r_end >= n || c_end < 0 || c_end >= n) { continue; }
+
+                uint32_t line = 0;
+                for (int i = 0; i < k; ++i)
+                {
+                    line |= 1u << ((r + i * dirs[d][0]) * n + c + i * dirs[d][1]);
+                }
+
+                lines.push_back(line);
+                for (int i = 0; i < n * n; ++i)
+                {
+                    if (line & (1u << i)) { cell_lines[i].push_back(line); }
+                }
+            }
+        }
+    }
+
+    // Cells on more lines are usually better moves, and searching them first prunes more
+    for (int i = 0; i < n * n; ++i) { move_order.push_back(i); }
+
+    std::stable_sort(move_order.begin(), move_order.end(), [this](int a, int b)
+    {
+        return cell_lines[a].size() > cell_lines[b].size();
+    });
+}
+
+bool NKGame::hasLine(uint32_t _m) const
+{
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        if ((_m & lines[i]) == lines[i]) { return true; }
+    }
+
+    return false;
+}
+
+bool NKGame::isWinningMove(uint32_t _own, int _cell) const
+{
+    uint32_t m = _own | (1u << _cell);
+    const std::vector<uint32_t> &l = cell_lines[_cell];
+
+    for (size_t i = 0; i < l.size(); ++i)
+    {
+        if ((m & l[i]) == l[i]) { return true; }
+    }
+
+    return false;
+}
+
+/**************************************************************************/
+/**                        TRANSPOSITION TABLE                           **/
+/**************************************************************************/
+
+namespace
+{
+    // The top bit tells full slots from empty ones (whose data is 0)
+    uint64_t pack(const TTEntry &_e)
+    {
+        return (1ULL << 63) | uint64_t(uint8_t(_e.score)) | (uint64_t(uint8_t(_e.move)) << 8) |
+                              (uint64_t(_e.bound) << 16);
+    }
+
+    TTEntry unpack(uint64_t _d)
+    {
+        return TTEntry(int8_t(_d & 0xFF), int8_t((_d >> 8) & 0xFF), uint8_t((_d >> 16) & 0xFF));
+    }
+
+    // Keys are bitboards, i.e. highly structured, so the check word stores them mixed by
+    // the (invertible) splitmix64 finalizer: a torn pair is then as unlikely to pass the
+    // check as with a random key
+    uint64_t mixKey(uint64_t _k)
+    {
+        _k = (_k ^ (_k >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        _k = (_k ^ (_k >> 27)) * 0x94D049BB133111EBULL;
+        return _k ^ (_k >> 31);
+    }
+
+    // Inverse of x ^= x >> _s
+    uint64_t unshift(uint64_t _x, int _s)
+    {
+        uint64_t y = _x;
+        for (int i = _s; i < 64; i += _s) { y = _x ^ (y >> _s); }
+        return y;
+    }
+
+    uint64_t unmixKey(uint64_t _k)
+    {
+        _k = unshift(_k, 31) * 0x319642B2D24D8EC3ULL;   // inverse of 0x94D049BB133111EB
+        _k = unshift(_k, 27) * 0x96DE1B173F119089ULL;   // inverse of 0xBF58476D1CE4E5B9
+        return unshift(_k, 30);
+    }
+}
+
+TranspositionTable::TranspositionTable(int _bits) : bits(std::min(std::max(_bits, 1), 30))
+{
+    slots.reset(new Slot[getNumSlots()]);
+    clear();
+}
+
+bool TranspositionTable::probe(uint64_t _key, TTEntry &_entry) const
+{
+    const Slot &s = slots[slotIndex(_key)];
+
+    // Relaxed loads are enough: an inconsistent pair fails the check below
+    uint64_t data  = s.data.load(std::memory_order_relaxed);
+    uint64_t check = s.check.load(std::memory_order_relaxed);
+
+    if (data == 0 || (check ^ data) != mixKey(_key)) { return false; }
+
+    _entry = unpack(data);
+    return true;
+}
+
+void TranspositionTable::store(uint64_t _key, const TTEntry &_entry)
+{
+    Slot &s = slots[slotIndex(_key)];
+    uint64_t data = pack(_entry);
+
+    s.check.store(mixKey(_key) ^ data, std::memory_order_relaxed);
+    s.data.store(data, std::memory_order_relaxed);
+}
+
+bool TranspositionTable::getSlot(size_t _i, uint64_t &_key, TTEntry &_entry) const
+{
+    uint64_t data  = slots[_i].data.load(std::memory_order_relaxed);
+    uint64_t check = slots[_i].check.load(std::memory_order_relaxed);
+
+    uint64_t key = unmixKey(check ^ data);
+
+    if (data == 0 || slotIndex(key) != _i) { return false; }
+
+    _key   = key;
+    _entry = unpack(data);
+    return true;
+}
+
+void TranspositionTable::clear()
+{
+    for (size_t i = 0; i < getNumSlots(); ++i)
+    {
+        slots[i].check.store(0, std::memory_order_relaxed);
+        slots[i].data.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**************************************************************************/
+/**                               SOLVER                                 **/
+/**************************************************************************/
+
+Solver::Solver(const NKGame &_game, int _threads, int _table_bits) : game(_game), tt(_table_bits),
+                                                                    num_threads(1), stop(false)
+{
+    setThreads(_threads);
+}
+
+int Solver::negamax(const NKPosition &_p, int _alpha, int _beta, uint64_t &_nodes)
+{
+    // The parent never plays past a win, so the game is not over yet unless the board is full
+    ++_nodes;
+
+    uint32_t empty   = game.getFullMask() & ~(_p.own | _p.other);
+    int      n_empty = __builtin_popcount(empty);
+    uint64_t key     = _p.key(game.getNumCells());
+
+    if (empty == 0) { return 0; }
+
+    // An immediate win is the best outcome, and an immediate threat of the
+    // other player has to be blocked (if there are two of them, the game is lost)
+    uint32_t threats = 0;
+
+    for (uint32_t m = empty; m != 0; m &= m - 1)
+    {
+        int c = __builtin_ctz(m);
+
+        if (game.isWinningMove(_p.own, c))
+        {
+            tt.store(key, TTEntry(n_empty, c, BOUND_EXACT));
+            return n_empty;
+        }
+
+        if (game.isWinningMove(_p.other, c)) { threats |= 1u << c; }
+    }
+
+    if (__builtin_popcount(threats) > 1)
+    {
+        tt.store(key, TTEntry(-(n_empty - 1), __builtin_ctz(threats), BOUND_EXACT));
+        return -(n_empty - 1);
+    }
+
+    // At best the player wins with its next move, at worst the other player does
+    _beta  = std::min(_beta,  std::max(n_empty - 2, 0));
+    _alpha = std::max(_alpha, -(n_empty - 1));
+    if (_alpha >= _beta) { return _alpha; }
+
+    int alpha_orig = _alpha;
+    int tt_move    = -1;
+
+    TTEntry e;
+    if (tt.probe(key, e))
+    {
+        tt_move = e.move;
+
+        if      (e.bound == BOUND_EXACT) { return e.score; }
+        else if (e.bound == BOUND_LOWER) { _alpha = std::max(_alpha, int(e.score)); }
+        else if (e.bound == BOUND_UPPER) { _beta  = std::min(_beta,  int(e.score)); }
+
+        if (_alpha >= _beta) { return e.score; }
+    }
+
+    uint32_t moves = threats != 0 ? threats : empty;
+    const std::vector<int> &order = game.getMoveOrder();
+
+    int best = -SCORE_INF, best_move = -1;
+
+    // The move from the table goes first, then the others in the static order
+    for (int i = -1; i < int(order.size()); ++i)
+    {
+        int c = i < 0 ? tt_move : order[i];
+
+        if (c < 0 || (moves & (1u << c)) == 0 || (i >= 0 && c == tt_move)) { continue; }
+
+        int v = -negamax(_p.play(c), -_beta, -_alpha, _nodes);
+
+        // A stopped search must not leave its partial results in the table
+        if (stop.load(std::memory_order_relaxed)) { return 0; }
+
+        if (v > best)
+        {
+            best      = v;
+            best_move = c;
+        }
+
+        _alpha = std::max(_alpha, v);
+        if (_alpha >= _beta) { break; }
+    }
+
+    uint8_t bound = best <= alpha_orig ? BOUND_UPPER :
+                    best >= _beta      ? BOUND_LOWER : BOUND_EXACT;
+    tt.store(key, TTEntry(best, best_move, bound));
+
+    return best;
+}
+
+SolverResult Solver::searchRoot(const NKPosition &_p, int _first)
+{
+    SolverResult res;
+
+    uint32_t empty   = game.getFullMask() & ~(_p.own | _p.other);
+    int      n_empty = __builtin_popcount(empty);
+
+    // The legal moves in the static order, rotated so that the _first-th one goes first
+    std::vector<int> moves;
+    const std::vector<int> &order = game.getMoveOrder();
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        if (empty & (1u << order[i])) { moves.push_back(order[i]); }
+    }
+    std::rotate(moves.begin(), moves.begin() + _first % moves.size(), moves.end());
+
+    // The root is searched move by move, so that its best move is always known
+    int alpha = -SCORE_INF;
+
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        int c = moves[i];
+
+        ++res.nodes;
+        int v = game.isWinningMove(_p.own, c) ? n_empty :
+                                               -negamax(_p.play(c), -SCORE_INF, -alpha, res.nodes);
+
+        if (stop.load(std::memory_order_relaxed)) { break; }
+
+        if (res.move == -1 || v > res.score)
+        {
+            res.move  = c;
+            res.score = v;
+        }
+
+        alpha = std::max(alpha, v);
+    }
+
+    return res;
+}
+
+SolverResult Solver::solve(const NKPosition &_p)
+{
+    SolverResult res;
+
+    uint32_t empty   = game.getFullMask() & ~(_p.own | _p.other);
+    int      n_empty = __builtin_popcount(empty);
+
+    if      (game.hasLine(_p.other)) { res.score = -(1 + n_empty); }
+    else if (game.hasLine(_p.own))   { res.score =   1 + n_empty;  }
+
+    if (game.hasLine(_p.own) || game.hasLine(_p.other) || empty == 0) { return res; }
+
+    stop = false;
+
+    std::vector<SolverResult> results(num_threads);
+    std::vector<std::thread>  helpers;
+    int                       winner = 0;
+
+    // Every thread searches from a different root move, and the first one to finish stops the others
+    std::function<void(int)> search = [&](int _t)
+    {
+        results[_t] = searchRoot(_p, _t);
+
+        if (not stop.exchange(true)) { winner = _t; }
+    };
+
+    for (int t = 1; t < num_threads; ++t) { helpers.push_back(std::thread(search, t)); }
+    search(0);
+    for (size_t t = 0; t < helpers.size(); ++t) { helpers[t].join(); }
+
+    res = results[winner];
+    for (int t = 0; t < num_threads; ++t)
+    {
+        if (t != winner) { res.nodes += results[t].nodes; }
+    }
+
+    tt.store(_p.key(game.getNumCells()), TTEntry(res.score, res.move, BOUND_EXACT));
+
+    return res;
+}
@@ -0,0 +1,78 @@
+#include "baxter_tictactoe/latency_histogram.h"
+
+#include <math.h>
+#include <stdio.h>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+#define LATENCY_MIN          1e-4   // lower edge of the second bin [s]
+#define LATENCY_BINS_OCTAVE     4
+#define LATENCY_NUM_BINS       68
+
+LatencyHistogram::LatencyHistogram() : bins(LATENCY_NUM_BINS, 0), count(0), sum(0.0), max(0.0)
+{
+
+}
+
+double LatencyHistogram::upperEdge(size_t _i)
+{
+    return LATENCY_MIN * pow(2.0, double(_i) / LATENCY_BINS_OCTAVE);
+}
+
+void LatencyHistogram::add(double _latency)
+{
+    if (_latency < 0.0)  { _latency = 0.0; }
+
+    // bin 0 holds everything below LATENCY_MIN, the last bin everything above the range
+    int i = 0;
+    if (_latency >= LATENCY_MIN)
+    {
+        i = 1 + int(floor(LATENCY_BINS_OCTAVE * log2(_latency / LATENCY_MIN)));
+        if (i >= LATENCY_NUM_BINS) { i = LATENCY_NUM_BINS - 1; }
+    }
+
+    ++bins[i];
+    ++count;
+    sum += _latency;
+    if (_latency > max) { max = _latency; }
+}
+
+double LatencyHistogram::percentile(double _p) const
+{
+    if (count == 0) { return 0.0; }
+
+    double target = _p / 100.0 * count;
+    unsigned long cum = 0;
+
+    for (size_t i = 0; i < bins.size(); ++i)
+    {
+        cum += bins[i];
+        if (cum >= target && cum > 0)
+        {
+            // the upper edge of the bin, but never more than the largest sample
+            double edge = upperEdge(i);
+            return edge < max ? edge : max;
+        }
+    }
+
+    return max;
+}
+
+void LatencyHistogram::reset()
+{
+    bins.assign(bins.size(), 0);
+    count = 0;
+    sum   = 0.0;
+    max   = 0.0;
+}
+
+string LatencyHistogram::toString() const
+{
+    char buf[160];
+    snprintf(buf, sizeof(buf), "n %lu mean %.1f p50 %.1f p90 %.1f p99 %.1f max %.1f [ms]",
+             count, 1e3 * getMean(), 1e3 * percentile(50), 1e3 * percentile(90),
+             1e3 * percentile(99), 1e3 * max);
+
+    return string(buf);
+}
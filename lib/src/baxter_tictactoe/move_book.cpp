@@ -0,0 +1,185 @@
+#include "baxter_tictactoe/move_book.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+#define BOOK_MAGIC  "TTTBOOK1"
+#define BOOK_BLOCK  64          // keys per block of the index
+
+namespace
+{
+    struct BookHeader
+    {
+        char       magic[8];
+        uint32_t          n;
+        uint32_t          k;
+        uint64_t   num_entries;
+        uint64_t     num_index;
+    };
+
+    bool keyLess(const pair<uint64_t, BookEntry> &_a, const pair<uint64_t, BookEntry> &_b)
+    {
+        return _a.first < _b.first;
+    }
+
+    bool keyEqual(const pair<uint64_t, BookEntry> &_a, const pair<uint64_t, BookEntry> &_b)
+    {
+        return _a.first == _b.first;
+    }
+}
+
+/**************************************************************************/
+/**                          MOVE BOOK WRITER                            **/
+/**************************************************************************/
+
+void MoveBookWriter::add(uint64_t _key, const BookEntry &_entry)
+{
+    entries.push_back(make_pair(_key, _entry));
+}
+
+bool MoveBookWriter::write(const string &_filename, int _n, int _k)
+{
+    // The sort is stable, so the first entry of every key survives unique()
+    std::stable_sort(entries.begin(), entries.end(), keyLess);
+    entries.erase(std::unique(entries.begin(), entries.end(), keyEqual), entries.end());
+
+    BookHeader h;
+    memcpy(h.magic, BOOK_MAGIC, sizeof(h.magic));
+    h.n           = _n;
+    h.k           = _k;
+    h.num_entries = entries.size();
+    h.num_index   = (entries.size() + BOOK_BLOCK - 1) / BOOK_BLOCK;
+
+    vector<uint64_t>  index, keys;
+    vector<BookEntry> values;
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (i % BOOK_BLOCK == 0) { index.push_back(entries[i].first); }
+
+        keys.push_back(entries[i].first);
+        values.push_back(entries[i].second);
+    }
+
+    string tmp_filename = _filename + ".tmp";
+    FILE *f = fopen(tmp_filename.c_str(), "wb");
+    if (f == NULL) { return false; }
+
+    bool res = fwrite(&h, sizeof(h), 1, f) == 1;
+    res = res && fwrite(index.data(),  sizeof(uint64_t),  index.size(),  f) == index.size();
+    res = res && fwrite(keys.data(),   sizeof(uint64_t),  keys.size(),   f) == keys.size();
+    res = res && fwrite(values.data(), sizeof(BookEntry), values.size(), f) == values.size();
+    res = (fclose(f) == 0) && res;
+
+    if (not res || rename(tmp_filename.c_str(), _filename.c_str()) != 0)
+    {
+        remove(tmp_filename.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+/**************************************************************************/
+/**                              MOVE BOOK                               **/
+/**************************************************************************/
+
+MoveBook::MoveBook() : data(NULL), data_size(0), n(0), k(0), num_entries(0), num_index(0),
+                       index(NULL), keys(NULL), entries(NULL)
+{
+
+}
+
+bool MoveBook::open(const string &_filename)
+{
+    if (isOpen()) { close(); }
+
+    int fd = ::open(_filename.c_str(), O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(BookHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);    // the mapping stays valid
+
+    if (addr == MAP_FAILED) { return false; }
+
+    data      = static_cast<const char*>(addr);
+    data_size = st.st_size;
+
+    const BookHeader *h = reinterpret_cast<const BookHeader*>(data);
+
+    // The size of the file has to match the header exactly
+    if (memcmp(h->magic, BOOK_MAGIC, sizeof(h->magic)) != 0 ||
+        h->num_index != (h->num_entries + BOOK_BLOCK - 1) / BOOK_BLOCK ||
+        data_size != sizeof(BookHeader) + (h->num_index + h->num_entries) * sizeof(uint64_t) +
+                                          h->num_entries * sizeof(BookEntry))
+    {
+        close();
+        return false;
+    }
+
+    n           = h->n;
+    k           = h->k;
+    num_entries = h->num_entries;
+    num_index   = h->num_index;
+
+    index   = reinterpret_cast<const uint64_t*>(data + sizeof(BookHeader));
+    keys    = index + num_index;
+    entries = reinterpret_cast<const BookEntry*>(keys + num_entries);
+
+    return true;
+}
+
+bool MoveBook::lookup(uint64_t _key, BookEntry &_entry) const
+{
+    if (not isOpen() || num_entries == 0) { return false; }
+
+    // The block is the last one whose first key is not greater than the key
+    size_t block = std::upper_bound(index, index + num_index, _key) - index;
+    if (block == 0) { return false; }
+    --block;
+
+    const uint64_t *begin = keys + block * BOOK_BLOCK;
+    const uint64_t *end   = keys + std::min((block + 1) * BOOK_BLOCK, num_entries);
+    const uint64_t *it    = std::lower_bound(begin, end, _key);
+
+    if (it == end || *it != _key) { return false; }
+
+    _entry = entries[it - keys];
+    return true;
+}
+
+void MoveBook::close()
+{
+    if (data != NULL) { munmap(const_cast<char*>(data), data_size); }
+
+    data        = NULL;
+    data_size   = 0;
+    n           = 0;
+    k           = 0;
+    num_entries = 0;
+    num_index   = 0;
+    index       = NULL;
+    keys        = NULL;
+    entries     = NULL;
+}
+
+MoveBook::~MoveBook()
+{
+    close();
+}
@@ -0,0 +1,57 @@
+#include "baxter_tictactoe/opponent_model.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+OpponentModel::OpponentModel(double _prior_a, double _prior_b, double _decay) :
+                             prior_a(std::max(_prior_a, 1e-3)), prior_b(std::max(_prior_b, 1e-3)),
+                             decay(std::min(std::max(_decay, 0.0), 1.0))
+{
+    reset();
+}
+
+void OpponentModel::update(const BitBoard &_before, int _cell)
+{
+    ++moves;
+
+    if (_cell < 0 || _cell > 8) { return; }
+
+    // Winning is a chance on its own, and blocking only if the opponent cannot win
+    BitMask to_win   = winningCells(_before.opp, _before.robot);
+    BitMask to_block = winningCells(_before.robot, _before.opp);
+    BitMask move     = cellMask(_cell);
+
+    if (to_win == 0 && to_block == 0) { return; }
+
+    win_chances   *= decay;
+    win_taken     *= decay;
+    block_chances *= decay;
+    block_taken   *= decay;
+
+    if (to_win != 0)
+    {
+        win_chances += 1.0;
+        if (to_win & move)   { win_taken += 1.0; }
+    }
+    else
+    {
+        block_chances += 1.0;
+        if (to_block & move) { block_taken += 1.0; }
+    }
+}
+
+void OpponentModel::reset()
+{
+    win_chances   = 0.0;
+    win_taken     = 0.0;
+    block_chances = 0.0;
+    block_taken   = 0.0;
+    moves         =   0;
+}
+
+double OpponentModel::getSkill() const
+{
+    return (win_taken + block_taken + prior_a) / (win_chances + block_chances + prior_a + prior_b);
+}
@@ -0,0 +1,264 @@
+#include "baxter_tictactoe/session_log.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+#define SESSION_LOG_MAGIC   "TTTLOG01"
+#define SESSION_LOG_VERSION 1
+
+namespace
+{
+    struct FileHeader
+    {
+        char            magic[8];
+        uint32_t         version;
+        uint32_t        reserved;
+        uint64_t    index_offset;   // 0 if the log has not been closed
+        uint64_t       n_records;
+    };
+
+    struct RecordHeader
+    {
+        uint32_t     type;
+        uint32_t     size;
+        uint64_t stamp_ns;
+    };
+
+    uint64_t padded(uint64_t _size) { return (_size + 7) & ~uint64_t(7); }
+
+    bool stampLessThan(const IndexEntry &_e, uint64_t _stamp_ns)
+    {
+        return _e.stamp_ns < _stamp_ns;
+    }
+}
+
+/**************************************************************************/
+/**                          SESSION WRITER                              **/
+/**************************************************************************/
+
+SessionWriter::SessionWriter() : file(NULL), offset(0), last_stamp(0)
+{
+
+}
+
+bool SessionWriter::open(const string &_filename)
+{
+    if (isOpen()) { close(); }
+
+    file = fopen(_filename.c_str(), "wb");
+    if (file == NULL) { return false; }
+
+    filename   = _filename;
+    last_stamp = 0;
+    index.clear();
+
+    FileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SESSION_LOG_MAGIC, sizeof(h.magic));
+    h.version = SESSION_LOG_VERSION;
+
+    offset = fwrite(&h, 1, sizeof(h), file);
+
+    return offset == sizeof(h);
+}
+
+bool SessionWriter::write(uint32_t _type, uint64_t _stamp_ns, const void *_data, uint32_t _size)
+{
+    if (not isOpen()) { return false; }
+
+    last_stamp = std::max(last_stamp, _stamp_ns);
+
+    RecordHeader rh;
+    rh.type     = _type;
+    rh.size     = _size;
+    rh.stamp_ns = last_stamp;
+
+    static const uint8_t zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    size_t padding = padded(_size) - _size;
+
+    if (fwrite(&rh,      1, sizeof(rh), file) != sizeof(rh) ||
+        fwrite(_data,    1,      _size, file) !=      _size ||
+        fwrite(zeros,    1,    padding, file) !=    padding)
+    {
+        return false;
+    }
+
+    IndexEntry e;
+    e.stamp_ns = last_stamp;
+    e.offset   = offset;
+    e.type     = _type;
+    e.size     = _size;
+    index.push_back(e);
+
+    offset += sizeof(rh) + padded(_size);
+
+    return true;
+}
+
+bool SessionWriter::close()
+{
+    if (not isOpen()) { return false; }
+
+    bool res = fwrite(index.data(), sizeof(IndexEntry), index.size(), file) == index.size();
+
+    // Patches the header so that the index can be found
+    FileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SESSION_LOG_MAGIC, sizeof(h.magic));
+    h.version      = SESSION_LOG_VERSION;
+    h.index_offset = res?offset:0;
+    h.n_records    = index.size();
+
+    res = res && fseek(file, 0, SEEK_SET) == 0;
+    res = res && fwrite(&h, 1, sizeof(h), file) == sizeof(h);
+    res = fclose(file) == 0 && res;
+
+    file = NULL;
+    return res;
+}
+
+SessionWriter::~SessionWriter()
+{
+    if (isOpen()) { close(); }
+}
+
+/**************************************************************************/
+/**                          SESSION READER                              **/
+/**************************************************************************/
+
+SessionReader::SessionReader() : fd(-1), base(NULL), file_size(0), index(NULL), n_index(0)
+{
+
+}
+
+bool SessionReader::open(const string &_filename)
+{
+    if (isOpen()) { close(); }
+
+    fd = ::open(_filename.c_str(), O_RDONLY);
+    if (fd < 0) { return false; }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(FileHeader))
+    {
+        close();
+        return false;
+    }
+
+    file_size = st.st_size;
+    void *addr = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (addr == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    base = static_cast<const uint8_t*>(addr);
+
+    const FileHeader *h = reinterpret_cast<const FileHeader*>(base);
+
+    if (memcmp(h->magic, SESSION_LOG_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != SESSION_LOG_VERSION)
+    {
+        close();
+        return false;
+    }
+
+    // The index has to lie within the file (the check is written so that it can not overflow)
+    bool has_index = h->index_offset >= sizeof(FileHeader) && h->index_offset <= file_size &&
+                     h->index_offset % 8 == 0;
+
+    if (has_index && h->n_records <= (file_size - h->index_offset) / sizeof(IndexEntry))
+    {
+        index   = reinterpret_cast<const IndexEntry*>(base + h->index_offset);
+        n_index = h->n_records;
+    }
+    else
+    {
+        // The log has not been closed properly (or it is corrupted): let's recover what we can
+        rebuildIndex(has_index ? h->index_offset : file_size);
+    }
+
+    return true;
+}
+
+size_t SessionReader::rebuildIndex(uint64_t _end)
+{
+    rebuilt.clear();
+
+    uint64_t off = sizeof(FileHeader);
+
+    while (off + sizeof(RecordHeader) <= _end)
+    {
+        const RecordHeader *rh = reinterpret_cast<const RecordHeader*>(base + off);
+
+        if (off + sizeof(RecordHeader) + padded(rh->size) > _end) { break; }
+
+        IndexEntry e;
+        e.stamp_ns = rh->stamp_ns;
+        e.offset   = off;
+        e.type     = rh->type;
+        e.size     = rh->size;
+        rebuilt.push_back(e);
+
+        off += sizeof(RecordHeader) + padded(rh->size);
+    }
+
+    index   = rebuilt.data();
+    n_index = rebuilt.size();
+
+    return n_index;
+}
+
+bool SessionReader::get(size_t _i, Record &_rec) const
+{
+    if (_i >= n_index) { return false; }
+
+    const IndexEntry &e = index[_i];
+
+    // A corrupted index could point anywhere
+    if (e.offset > file_size || file_size - e.offset < sizeof(RecordHeader) ||
+        file_size - e.offset - sizeof(RecordHeader) < e.size)
+    {
+        return false;
+    }
+
+    _rec.type     = e.type;
+    _rec.stamp_ns = e.stamp_ns;
+    _rec.size     = e.size;
+    _rec.data     = base + e.offset + sizeof(RecordHeader);
+
+    return true;
+}
+
+size_t SessionReader::seek(uint64_t _stamp_ns) const
+{
+    return std::lower_bound(index, index + n_index, _stamp_ns, stampLessThan) - index;
+}
+
+void SessionReader::close()
+{
+    if (base != NULL)  { munmap(const_cast<uint8_t*>(base), file_size); }
+    if (fd   >= 0)     { ::close(fd); }
+
+    fd        =   -1;
+    base      = NULL;
+    file_size =    0;
+    index     = NULL;
+    n_index   =    0;
+    rebuilt.clear();
+}
+
+SessionReader::~SessionReader()
+{
+    close();
+}
@@ -0,0 +1,349 @@
+#include "baxter_tictactoe/stats_store.h"
+
+#include <fstream>
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+namespace
+{
+    string schemaFile(const string &_dir, const string &_table)
+    {
+        return _dir + "/" + _table + ".schema";
+    }
+
+    string columnFile(const string &_dir, const string &_table, const string &_column)
+    {
+        return _dir + "/" + _table + "." + _column + ".col";
+    }
+
+    /**
+     * Reads the names of the columns of a table.
+     *
+     * @return true/false if the schema exists or not
+     */
+    bool readSchema(const string &_dir, const string &_table, vector<string> &_columns)
+    {
+        ifstream f(schemaFile(_dir, _table).c_str());
+        if (not f.is_open()) { return false; }
+
+        _columns.clear();
+        string line;
+        while (getline(f, line))
+        {
+            if (not line.empty()) { _columns.push_back(line); }
+        }
+
+        return true;
+    }
+
+    void addValue(StatsSummary &_s, double _v)
+    {
+        if (_s.count == 0) { _s.min = _s.max = _v; }
+
+        _s.min  = std::min(_s.min, _v);
+        _s.max  = std::max(_s.max, _v);
+        _s.sum += _v;
+        ++_s.count;
+    }
+
+    /**
+     * Size of a file [bytes], 0 if it does not exist.
+     */
+    uint64_t fileSize(const string &_filename)
+    {
+        struct stat st;
+        return stat(_filename.c_str(), &st) == 0 ? st.st_size : 0;
+    }
+}
+
+/**************************************************************************/
+/**                           STATS WRITER                               **/
+/**************************************************************************/
+
+StatsWriter::StatsWriter() : stamp_file(NULL), num_rows(0), last_stamp(0)
+{
+
+}
+
+bool StatsWriter::open(const string &_dir, const string &_table, const vector<string> &_columns)
+{
+    if (isOpen()) { close(); }
+
+    if (mkdir(_dir.c_str(), 0755) != 0 && errno != EEXIST) { return false; }
+
+    for (size_t i = 0; i < _columns.size(); ++i)
+    {
+        // "stamp" is taken, and names end up in file names
+        if (_columns[i].empty() || _columns[i] == "stamp" ||
+            _columns[i].find_first_of("/\n") != string::npos)
+        {
+            return false;
+        }
+    }
+
+    vector<string> existing;
+    if (readSchema(_dir, _table, existing))
+    {
+        if (existing != _columns) { return false; }
+    }
+    else
+    {
+        ofstream f(schemaFile(_dir, _table).c_str());
+        for (size_t i = 0; i < _columns.size(); ++i) { f << _columns[i] << "\n"; }
+        if (not f.good()) { return false; }
+    }
+
+    dir     = _dir;
+    table   = _table;
+    columns = _columns;
+
+    // A row is complete only if all of its columns have been written
+    vector<string> files(1, columnFile(dir, table, "stamp"));
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        files.push_back(columnFile(dir, table, columns[i]));
+    }
+
+    num_rows = fileSize(files[0]) / sizeof(uint64_t);
+    for (size_t i = 1; i < files.size(); ++i)
+    {
+        num_rows = std::min(num_rows, fileSize(files[i]) / sizeof(double));
+    }
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        if (fileSize(files[i]) > num_rows * sizeof(double) &&
+            truncate(files[i].c_str(), num_rows * sizeof(double)) != 0)
+        {
+            return false;
+        }
+    }
+
+    last_stamp = 0;
+    if (num_rows > 0)
+    {
+        FILE *f = fopen(files[0].c_str(), "rb");
+        if (f == NULL) { return false; }
+
+        bool res = fseek(f, (num_rows - 1) * sizeof(uint64_t), SEEK_SET) == 0 &&
+                   fread(&last_stamp, sizeof(uint64_t), 1, f) == 1;
+        fclose(f);
+        if (not res) { return false; }
+    }
+
+    stamp_file = fopen(files[0].c_str(), "ab");
+    for (size_t i = 1; i < files.size(); ++i)
+    {
+        value_files.push_back(fopen(files[i].c_str(), "ab"));
+    }
+
+    if (stamp_file == NULL ||
+        std::find(value_files.begin(), value_files.end(), (FILE*)NULL) != value_files.end())
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+bool StatsWriter::append(uint64_t _stamp_ns, const vector<double> &_values)
+{
+    if (not isOpen() || _values.size() != columns.size()) { return false; }
+
+    last_stamp = std::max(last_stamp, _stamp_ns);
+
+    // The stamp goes last, so that readers never see a row before its values
+    bool res = true;
+    for (size_t i = 0; i < value_files.size(); ++i)
+    {
+        res = res && fwrite(&_values[i], sizeof(double), 1, value_files[i]) == 1;
+        res = res && fflush(value_files[i]) == 0;
+    }
+
+    res = res && fwrite(&last_stamp, sizeof(uint64_t), 1, stamp_file) == 1;
+    res = res && fflush(stamp_file) == 0;
+
+    if (res) { ++num_rows; }
+
+    return res;
+}
+
+void StatsWriter::close()
+{
+    if (stamp_file != NULL) { fclose(stamp_file); }
+
+    for (size_t i = 0; i < value_files.size(); ++i)
+    {
+        if (value_files[i] != NULL) { fclose(value_files[i]); }
+    }
+
+    stamp_file = NULL;
+    value_files.clear();
+    num_rows   = 0;
+    last_stamp = 0;
+}
+
+StatsWriter::~StatsWriter()
+{
+    close();
+}
+
+/**************************************************************************/
+/**                           STATS READER                               **/
+/**************************************************************************/
+
+StatsReader::StatsReader() : is_open(false), stamps(NULL), stamps_size(0), num_rows(0)
+{
+
+}
+
+const void* StatsReader::mapFile(const string &_filename, size_t &_size)
+{
+    _size = 0;
+
+    int fd = ::open(_filename.c_str(), O_RDONLY);
+    if (fd < 0) { return NULL; }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return NULL;
+    }
+
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);    // the mapping stays valid
+
+    if (addr == MAP_FAILED) { return NULL; }
+
+    _size = st.st_size;
+    return addr;
+}
+
+bool StatsReader::open(const string &_dir, const string &_table)
+{
+    if (isOpen()) { close(); }
+
+    vector<string> names;
+    if (not readSchema(_dir, _table, names)) { return false; }
+
+    stamps   = static_cast<const uint64_t*>(mapFile(columnFile(_dir, _table, "stamp"), stamps_size));
+    num_rows = stamps_size / sizeof(uint64_t);
+
+    // Columns are only mapped when they are used, but they bound the number of rows
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        Column c;
+        c.name     = names[i];
+        c.filename = columnFile(_dir, _table, names[i]);
+        c.values   = NULL;
+        c.map_size = 0;
+        columns.push_back(c);
+
+        num_rows = std::min(num_rows, size_t(fileSize(c.filename) / sizeof(double)));
+    }
+
+    is_open = true;
+    return true;
+}
+
+const double* StatsReader::getValues(const string &_column)
+{
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        Column &c = columns[i];
+        if (c.name != _column) { continue; }
+
+        if (c.values == NULL && num_rows > 0)
+        {
+            c.values = static_cast<const double*>(mapFile(c.filename, c.map_size));
+        }
+
+        return c.values;
+    }
+
+    return NULL;
+}
+
+size_t StatsReader::seek(uint64_t _stamp_ns) const
+{
+    if (num_rows == 0) { return 0; }
+
+    return std::lower_bound(stamps, stamps + num_rows, _stamp_ns) - stamps;
+}
+
+StatsSummary StatsReader::summarize(const string &_column, uint64_t _from_ns, uint64_t _to_ns)
+{
+    StatsSummary res;
+
+    const double *v = getValues(_column);
+    if (v == NULL) { return res; }
+
+    size_t end = seek(_to_ns);
+
+    for (size_t i = seek(_from_ns); i < end; ++i) { addValue(res, v[i]); }
+
+    return res;
+}
+
+StatsSummary StatsReader::summarize(const string &_column, const string &_where, double _equals,
+                                    uint64_t _from_ns, uint64_t _to_ns)
+{
+    StatsSummary res;
+
+    const double *v = getValues(_column);
+    const double *w = getValues(_where);
+    if (v == NULL || w == NULL) { return res; }
+
+    size_t end = seek(_to_ns);
+
+    for (size_t i = seek(_from_ns); i < end; ++i)
+    {
+        if (w[i] == _equals) { addValue(res, v[i]); }
+    }
+
+    return res;
+}
+
+size_t StatsReader::count(const string &_column, double _value, uint64_t _from_ns, uint64_t _to_ns)
+{
+    const double *v = getValues(_column);
+    if (v == NULL) { return 0; }
+
+    size_t end = seek(_to_ns);
+
+    return std::count(v + seek(_from_ns), v + end, _value);
+}
+
+void StatsReader::close()
+{
+    if (stamps != NULL) { munmap(const_cast<uint64_t*>(stamps), stamps_size); }
+
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        if (columns[i].values != NULL)
+        {
+            munmap(const_cast<double*>(columns[i].values), columns[i].map_size);
+        }
+    }
+
+    is_open     = false;
+    stamps      = NULL;
+    stamps_size = 0;
+    num_rows    = 0;
+    columns.clear();
+}
+
+StatsReader::~StatsReader()
+{
+    close();
+}
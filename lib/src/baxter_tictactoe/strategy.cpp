@@ -0,0 +1,422 @@
+#include "baxter_tictactoe/strategy.h"
+
+#include <stdlib.h>
+#include <dlfcn.h>
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+double baxter_tictactoe::getConfig(const StrategyConfig &_config, const string &_key, double _def)
+{
+    StrategyConfig::const_iterator it = _config.find(_key);
+    if (it == _config.end()) { return _def; }
+
+    char *end = NULL;
+    double res = strtod(it->second.c_str(), &end);
+
+    return (end == it->second.c_str() || *end != '\0') ? _def : res;
+}
+
+/**************************************************************************/
+/**                             HEURISTICS                               **/
+/**************************************************************************/
+
+int baxter_tictactoe::victoryMove(const StrategyContext &_ctx)
+{
+    for (BitMask m = _ctx.board->legalMoves(); m != 0; m &= m - 1)
+    {
+        int i = lowestCell(m);
+        if (_ctx.board->wouldWin(i, _ctx.robot_col)) { return i; }
+    }
+
+    return -1;
+}
+
+int baxter_tictactoe::defensiveMove(const StrategyContext &_ctx)
+{
+    for (BitMask m = _ctx.board->legalMoves(); m != 0; m &= m - 1)
+    {
+        int i = lowestCell(m);
+        if (_ctx.board->wouldWin(i, _ctx.opp_col)) { return i; }
+    }
+
+    return -1;
+}
+
+int baxter_tictactoe::randomMove(const StrategyContext &_ctx)
+{
+    BitMask moves = _ctx.board->legalMoves();
+    if (moves == 0) { return -1; }
+
+    // Picks one of the legal moves uniformly
+    int n = countCells(moves);
+    int k = _ctx.rng != NULL ? std::uniform_int_distribution<int>(0, n - 1)(*_ctx.rng) : rand() % n;
+
+    for (; k > 0; --k) { moves &= moves - 1; }
+
+    return lowestCell(moves);
+}
+
+int baxter_tictactoe::bookMove(const StrategyContext &_ctx)
+{
+    if (_ctx.book == NULL || not _ctx.book->isOpen()) { return -1; }
+
+    // The book is indexed from the point of view of the player to move
+    BitBoard  b = makeBitBoard(*_ctx.board, _ctx.robot_col, _ctx.opp_col);
+    BookEntry e;
+
+    if (not _ctx.book->lookup(NKPosition(b.robot, b.opp).key(NUMBER_OF_CELLS), e)) { return -1; }
+
+    return e.move;
+}
+
+StrategyMove baxter_tictactoe::fallbackMove(const StrategyContext &_ctx)
+{
+    int c = -1;
+    if ((c =   victoryMove(_ctx)) != -1) { return StrategyMove(c, false,   "Victory"); }
+    if ((c = defensiveMove(_ctx)) != -1) { return StrategyMove(c, false, "Defensive"); }
+    return StrategyMove(randomMove(_ctx), false, "Random");
+}
+
+bool baxter_tictactoe::isPlayable(const StrategyContext &_ctx, const StrategyMove &_move)
+{
+    if (_move.cell < 0 || _move.cell >= NUMBER_OF_CELLS) { return false; }
+
+    BitMask cells = _move.cheat ? _ctx.board->getCells(_ctx.opp_col) : _ctx.board->legalMoves();
+
+    return (cells & cellMask(_move.cell)) != 0;
+}
+
+namespace
+{
+    /**
+     * Probability test, with the generator of the context if there is one.
+     */
+    bool chance(const StrategyContext &_ctx, double _p)
+    {
+        if (_ctx.rng != NULL) { return std::uniform_real_distribution<double>(0.0, 1.0)(*_ctx.rng) < _p; }
+
+        return rand() < _p * RAND_MAX;
+    }
+
+    /**
+     * A defensive move if there is one, otherwise a random one. It is
+     * reported first by the strategies that take longer to decide.
+     */
+    StrategyMove safeMove(const StrategyContext &_ctx)
+    {
+        int c = defensiveMove(_ctx);
+        return c != -1 ? StrategyMove(c, false, "Defensive") : StrategyMove(randomMove(_ctx), false, "Random");
+    }
+
+    /**
+     * Places the tokens randomly.
+     */
+    class RandomStrategy : public Strategy
+    {
+    protected:
+        StrategyMove chooseMove(const StrategyContext &_ctx)
+        {
+            return StrategyMove(randomMove(_ctx), false, "Random");
+        }
+
+    public:
+        RandomStrategy(const string &_name) : Strategy(_name, "Randomly place tokens") {};
+    };
+
+    /**
+     * Wins if it can, blocks the opponent if it has to, and plays randomly otherwise.
+     */
+    class SmartStrategy : public Strategy
+    {
+    protected:
+        StrategyMove chooseMove(const StrategyContext &_ctx)
+        {
+            return fallbackMove(_ctx);
+        }
+
+    public:
+        SmartStrategy(const string &_name) : Strategy(_name, "Try to win without cheating") {};
+    };
+
+    /**
+     * As the smart strategy, but it first tries to (almost surely) win by cheating, i.e. by
+     * placing a token on a cell occupied by the opponent. All the cheats are evaluated together
+     * with the follow-up play, and the strongest one is chosen (the least noticeable among the
+     * equivalent ones), if its expected score is at least cheat_min_value.
+     */
+    class CheatingStrategy : public Strategy
+    {
+    private:
+        double min_value;   // minimum expected score of a cheat to perform it
+        double tolerance;   // cheats within this expected score are equivalent
+
+    protected:
+        StrategyMove chooseMove(const StrategyContext &_ctx)
+        {
+            int c = -1;
+            if ((c = victoryMove(_ctx)) != -1) { return StrategyMove(c, false, "Victory"); }
+
+            StrategyMove safe = safeMove(_ctx);
+            _ctx.report(safe);
+
+            if (_ctx.planner != NULL)
+            {
+                BitBoard  b    = makeBitBoard(*_ctx.board, _ctx.robot_col, _ctx.opp_col);
+                CheatPlan plan = _ctx.planner->bestCheat(b, _ctx.last_opp, tolerance);
+
+                if (plan.cell != -1 && plan.value >= min_value)
+                {
+                    ROS_DEBUG("Cheat to cell # %i: expected score %g, noticeability %g",
+                              plan.cell+1, plan.value, plan.noticeability);
+                    return StrategyMove(plan.cell, true, "Cheating");
+                }
+            }
+
+            return safe;
+        }
+
+    public:
+        CheatingStrategy(const string &_name) : Strategy(_name, "Try to win by cheating"),
+                                                min_value(0.9), tolerance(0.05) {};
+
+        bool configure(const StrategyConfig &_config)
+        {
+            min_value = getConfig(_config, "cheat_min_value", min_value);
+            tolerance = getConfig(_config, "cheat_tolerance", tolerance);
+            return true;
+        }
+    };
+
+    /**
+     * As the smart strategy, but the harder the opponent is, the more often it plays the
+     * strongest move (from the move book or, if not there, the planner) instead of the
+     * defensive or random one. This way the difficulty adapts to the opponent.
+     */
+    class AdaptiveStrategy : public Strategy
+    {
+    protected:
+        StrategyMove chooseMove(const StrategyContext &_ctx)
+        {
+            int c = -1;
+            if ((c = victoryMove(_ctx)) != -1) { return StrategyMove(c, false, "Victory"); }
+
+            StrategyMove safe = safeMove(_ctx);
+            _ctx.report(safe);
+
+            if (chance(_ctx, _ctx.opp_skill))
+            {
+                if ((c = bookMove(_ctx)) != -1) { return StrategyMove(c, false, "Book"); }
+
+                if (_ctx.planner != NULL)
+                {
+                    CheatPlan plan = _ctx.planner->bestMove(makeBitBoard(*_ctx.board, _ctx.robot_col,
+                                                                                      _ctx.opp_col));
+                    if (plan.cell != -1)
+                    {
+                        ROS_DEBUG("Strongest move to cell # %i: expected score %g", plan.cell+1, plan.value);
+                        return StrategyMove(plan.cell, false, "Strongest");
+                    }
+                }
+            }
+
+            return safe;
+        }
+
+    public:
+        AdaptiveStrategy(const string &_name) :
+                         Strategy(_name, "Try to win without cheating, as hard as the opponent") {};
+    };
+
+    template<class T>
+    Strategy* makeStrategy(const string &_name) { return new T(_name); }
+}
+
+/**************************************************************************/
+/**                              STRATEGY                                **/
+/**************************************************************************/
+
+Strategy::Strategy(const string &_name, const string &_description) :
+                   name(_name), description(_description.empty() ? _name : _description)
+{
+
+}
+
+StrategyMove Strategy::move(const StrategyContext &_ctx)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    StrategyMove res = chooseMove(_ctx);
+
+    double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    ++stats.moves;
+    if (res.cheat)      { ++stats.cheats;   }
+    if (res.cell == -1) { ++stats.failures; }
+    stats.total_time += time;
+    stats.max_time    = std::max(stats.max_time, time);
+
+    return res;
+}
+
+/**************************************************************************/
+/**                          STRATEGY REGISTRY                           **/
+/**************************************************************************/
+
+StrategyRegistry::StrategyRegistry()
+{
+    add(  "random", makeStrategy<RandomStrategy>);
+    add(   "smart", makeStrategy<SmartStrategy>);
+    add("cheating", makeStrategy<CheatingStrategy>);
+    add("adaptive", makeStrategy<AdaptiveStrategy>);
+}
+
+bool StrategyRegistry::add(const string &_name, const StrategyFactory &_factory)
+{
+    if (_name.empty() || not _factory) { return false; }
+
+    return factories.insert(make_pair(_name, _factory)).second;
+}
+
+std::unique_ptr<Strategy> StrategyRegistry::create(const string &_name) const
+{
+    std::map<string, StrategyFactory>::const_iterator it = factories.find(_name);
+
+    if (it == factories.end()) { return std::unique_ptr<Strategy>(); }
+
+    return std::unique_ptr<Strategy>(it->second(_name));
+}
+
+bool StrategyRegistry::loadPlugin(const string &_filename)
+{
+    void *handle = dlopen(_filename.c_str(), RTLD_NOW | RTLD_LOCAL);
+
+    if (handle == NULL)
+    {
+        ROS_ERROR("Cannot load the strategy plug-in %s: %s", _filename.c_str(), dlerror());
+        return false;
+    }
+
+    typedef void (*RegisterFn)(StrategyRegistry&);
+    RegisterFn reg = reinterpret_cast<RegisterFn>(dlsym(handle, STRATEGY_PLUGIN_SYMBOL));
+
+    if (reg == NULL)
+    {
+        ROS_ERROR("%s is not a strategy plug-in (no %s)", _filename.c_str(), STRATEGY_PLUGIN_SYMBOL);
+        dlclose(handle);
+        return false;
+    }
+
+    reg(*this);
+    plugins.push_back(handle);
+
+    return true;
+}
+
+vector<string> StrategyRegistry::getNames() const
+{
+    vector<string> res;
+
+    for (std::map<string, StrategyFactory>::const_iterator it = factories.begin();
+                                                           it != factories.end(); ++it)
+    {
+        res.push_back(it->first);
+    }
+
+    return res;
+}
+
+/**************************************************************************/
+/**                           STRATEGY RUNNER                            **/
+/**************************************************************************/
+
+StrategyRunner::StrategyRunner(unsigned int _seed) : rng(_seed), moves(0), overruns(0),
+                                                     anytime(0), fallbacks(0)
+{
+
+}
+
+StrategyMove StrategyRunner::run(Strategy &_strategy, const StrategyContext &_ctx)
+{
+    typedef std::chrono::steady_clock clock;
+    clock::time_point start = clock::now();
+
+    StrategyMove res;
+    ++moves;
+
+    if (isBusy())
+    {
+        // The last strategy is still running: the fallback move does not share anything with it
+        StrategyContext ctx = _ctx;
+        ctx.rng = &rng;
+
+        res = fallbackMove(ctx);
+        ++fallbacks;
+    }
+    else if (_ctx.time_budget <= 0.0)
+    {
+        res = _strategy.move(_ctx);
+    }
+    else
+    {
+        if (pending.valid()) { pending.get(); }     // the result of a strategy that overran
+
+        task.reset(new Task());
+        task->board        = *_ctx.board;
+        task->ctx          = _ctx;
+        task->ctx.board    = &task->board;
+        task->ctx.best     = &task->best;
+        task->ctx.deadline = start + std::chrono::duration_cast<clock::duration>(
+                                     std::chrono::duration<double>(_ctx.time_budget));
+
+        std::shared_ptr<Task> t = task;
+        pending = std::async(std::launch::async, [&_strategy, t]() { return _strategy.move(t->ctx); });
+
+        if (pending.wait_until(task->ctx.deadline) == std::future_status::ready)
+        {
+            res = pending.get();
+        }
+        else
+        {
+            ++overruns;
+            res = task->best.get();
+
+            if (isPlayable(_ctx, res)) { ++anytime; }
+            else
+            {
+                StrategyContext ctx = _ctx;
+                ctx.rng = &rng;
+
+                res = fallbackMove(ctx);
+                ++fallbacks;
+            }
+        }
+    }
+
+    latency.add(std::chrono::duration<double>(clock::now() - start).count());
+
+    return res;
+}
+
+bool StrategyRunner::isBusy() const
+{
+    return pending.valid() && pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+void StrategyRunner::wait()
+{
+    if (pending.valid()) { pending.wait(); }
+}
+
+void StrategyRunner::resetStats()
+{
+    latency.reset();
+    moves = overruns = anytime = fallbacks = 0;
+}
+
+StrategyRunner::~StrategyRunner()
+{
+    wait();
+}
@@ -1,6 +1,7 @@
 #include "baxter_tictactoe/tictactoe_utils.h"
 
 #include <stdlib.h>
+#include <limits.h>
 
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
@@ -14,41 +15,83 @@
 using namespace std;
 using namespace baxter_tictactoe;
 
+/**************************************************************************/
+/**                        POLYGON                                       **/
+/**************************************************************************/
+
+Polygon::Polygon(const Contour &_c) : n(0)
+{
+    for (size_t i = 0; i < _c.size() && push_back(_c[i]); ++i) {}
+}
+
+bool Polygon::push_back(const cv::Point &_p)
+{
+    if (n == POLYGON_MAX_POINTS) { return false; }
+
+    coords[2 * n]     = _p.x;
+    coords[2 * n + 1] = _p.y;
+    ++n;
+
+    return true;
+}
+
+cv::Mat Polygon::getMat() const
+{
+    // OpenCV does not write through the header of a point set taken as an input
+    return cv::Mat(n, 1, CV_32SC2, const_cast<int*>(coords));
+}
+
+Contour Polygon::toContour() const
+{
+    Contour res(n);
+
+    for (int i = 0; i < n; ++i)
+    {
+        res[i] = (*this)[i];
+    }
+
+    return res;
+}
+
 /**************************************************************************/
 /**                        CELL                                          **/
 /**************************************************************************/
 
-Cell::Cell(string _s, int _ar, int _ab) :
-           state(_s), area_red(_ar), area_blue(_ab)
+const string Cell::STATES[3] = { COL_EMPTY, COL_RED, COL_BLUE };
+
+Cell::Cell(const string &_s, int _ar, int _ab) :
+           state(STATE_EMPTY), area_red(_ar), area_blue(_ab)
 {
-    contour.clear();
+    int s = parseState(_s);
+    if (s == -1) { resetState(); }
+    else         { state = s;    }
+
     checkIntegrity();
 }
 
-Cell::Cell(Contour _c, string _s, int _ar, int _ab) :
-           contour(_c), state(_s), area_red(_ar), area_blue(_ab)
+Cell::Cell(const Polygon &_c, const string &_s, int _ar, int _ab) :
+           contour(_c), state(STATE_EMPTY), area_red(_ar), area_blue(_ab)
 {
+    int s = parseState(_s);
+    if (s == -1) { resetState(); }
+    else         { state = s;    }
+
     checkIntegrity();
 }
 
-Cell::Cell(const Cell &_c) :
-           contour(_c.contour), state(_c.state),
-           area_red(_c.area_red), area_blue(_c.area_blue)
+int Cell::parseState(const string& _s)
 {
-    checkIntegrity();
+    if (_s == COL_EMPTY) { return STATE_EMPTY; }
+    if (_s == COL_RED)   { return STATE_RED;   }
+    if (_s == COL_BLUE)  { return STATE_BLUE;  }
+
+    return -1;
 }
 
 bool Cell::checkIntegrity()
 {
-    // check for integrity of state
-    if (state != COL_RED && state != COL_BLUE && state != COL_EMPTY)
-    {
-        resetState();
-        return false;
-    }
-
     // check for integrity for state and area colors
-    if (state == COL_EMPTY)
+    if (state == STATE_EMPTY)
     {
         if (area_red == 0 && area_blue == 0) { return true; }
         else
@@ -57,7 +100,7 @@ bool Cell::checkIntegrity()
             return false;
         }
     }
-    else if (state == COL_RED)
+    else if (state == STATE_RED)
     {
         if (area_red > area_blue) { return true; }
         else
@@ -66,7 +109,7 @@ bool Cell::checkIntegrity()
             return false;
         }
     }
-    else if (state == COL_BLUE)
+    else if (state == STATE_BLUE)
     {
         if (area_blue > area_red) { return true; }
         else
@@ -77,20 +120,6 @@ bool Cell::checkIntegrity()
     return true;
 }
 
-Cell& Cell::operator=(const Cell& _c)
-{
-    // self-assignment check
-    if (this != &_c)
-    {
-        contour   = _c.contour;
-        state     = _c.state;
-        area_red  = _c.area_red;
-        area_blue = _c.area_blue;
-    }
-
-    return *this;
-}
-
 bool Cell::operator==(const Cell &_c) const
 {
     return state == _c.state;
@@ -103,9 +132,9 @@ bool Cell::operator!=(const Cell &_c) const
 
 bool Cell::resetState()
 {
-    state     = COL_EMPTY;
-    area_red  =         0;
-    area_blue =         0;
+    state     = STATE_EMPTY;
+    area_red  =           0;
+    area_blue =           0;
 
     return true;
 }
@@ -130,12 +159,12 @@ bool Cell::computeState()
     return false;
 }
 
-cv::Mat Cell::maskImage(const cv::Mat &_src)
+cv::Mat Cell::maskImage(const cv::Mat &_src) const
 {
     cv::Mat mask = cv::Mat::zeros(_src.rows, _src.cols, CV_8UC1);
 
     // CV_FILLED fills the connected components found with white
-    cv::drawContours(mask, vector<vector<cv::Point> >(1,contour),
+    cv::drawContours(mask, vector<cv::Mat>(1, contour.getMat()),
                                             -1, cv::Scalar(255), CV_FILLED);
 
     cv::Mat im_crop(_src.rows, _src.cols, CV_8UC3);
@@ -145,54 +174,56 @@ cv::Mat Cell::maskImage(const cv::Mat &_src)
     return im_crop;
 }
 
-cv::Point Cell::getCentroid()
+cv::Point Cell::getCentroid() const
 {
     cv::Point centroid(0,0);
 
     if (contour.size() > 0)
     {
         cv::Moments mom;
-        mom = cv::moments(contour, false);
+        mom = cv::moments(contour.getMat(), false);
         centroid = cv::Point( int(mom.m10/mom.m00) , int(mom.m01/mom.m00) );
     }
 
     return centroid;
 }
 
-int Cell::getContourArea()
+int Cell::getContourArea() const
 {
-    if (contour.size() > 0)  return cv::moments(getContour(),false).m00;
+    if (contour.size() > 0)  return cv::moments(contour.getMat(),false).m00;
 
     return 0;
 }
 
 bool Cell::setState(const string& _s)
 {
-    if (_s == COL_RED || _s == COL_BLUE || _s == COL_EMPTY)
-    {
-        state = _s;
+    return setStateCode(parseState(_s));
+}
 
-        // Ensure consistency of the number pixels w.r.t. the state
-        if (_s == COL_RED && getRedArea() < getBlueArea())
-        {
-            setRedArea(getBlueArea()+1);
-        }
-        else if (_s == COL_BLUE && getBlueArea() < getRedArea())
-        {
-            setBlueArea(getRedArea()+1);
-        }
-        else if (_s == COL_EMPTY)
-        {
-            resetState();
-        }
+bool Cell::setStateCode(int _s)
+{
+    if (_s != STATE_EMPTY && _s != STATE_RED && _s != STATE_BLUE) { return false; }
 
-        return true;
+    state = _s;
+
+    // Ensure consistency of the number pixels w.r.t. the state
+    if (_s == STATE_RED && getRedArea() < getBlueArea())
+    {
+        setRedArea(getBlueArea()+1);
+    }
+    else if (_s == STATE_BLUE && getBlueArea() < getRedArea())
+    {
+        setBlueArea(getRedArea()+1);
+    }
+    else if (_s == STATE_EMPTY)
+    {
+        resetState();
     }
 
-    return false;
+    return true;
 }
 
-string Cell::toString()
+string Cell::toString() const
 {
     stringstream res;
 
@@ -219,45 +250,68 @@ string Cell::toString()
 /**************************************************************************/
 /**                                 BOARD                                **/
 /**************************************************************************/
-Board::Board()
+Board::Board() : n_cells(0), hash(0)
 {
 
 }
 
-Board::Board(size_t n_cells)
+Board::Board(size_t _n_cells) : n_cells(_n_cells), hash(0)
 {
-    for (size_t i = 0; i < n_cells; ++i)
+    if (n_cells > NUMBER_OF_CELLS)
     {
-        addCell(Cell());
+        ROS_WARN("A board can not have more than %i cells, not %lu.", NUMBER_OF_CELLS, n_cells);
+        n_cells = NUMBER_OF_CELLS;
     }
 }
 
-Board::Board(const Board &_b) : cells(_b.cells)
+Board::Board(Board &&_b) noexcept : Board(_b)
 {
-
+    _b.resetBoard();
 }
 
-Board& Board::operator=(const Board& _b)
+Board& Board::operator=(Board &&_b) noexcept
 {
-    // self-assignment check
     if (this != &_b)
     {
-        resetBoard();
-
-        for (size_t i = 0; i < _b.cells.size(); ++i)
-        {
-            addCell(Cell(_b.cells[i]));
-        }
+        *this = _b;
+        _b.resetBoard();
     }
 
     return *this;
 }
 
+uint64_t Board::zobristKey(size_t i, int _s)
+{
+    uint64_t x = 0;
+
+    if      (_s == Cell::STATE_RED)  { x = 2 * i + 1; }
+    else if (_s == Cell::STATE_BLUE) { x = 2 * i + 2; }
+    else                             { return 0;      }
+
+    // splitmix64 finalizer: distinct inputs give well spread, independent-looking keys
+    x += 0x9E3779B97F4A7C15ULL;
+    x  = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x  = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+
+    return x ^ (x >> 31);
+}
+
+void Board::rehash()
+{
+    hash = 0;
+
+    for (size_t i = 0; i < getNumCells(); ++i)
+    {
+        hash ^= zobristKey(i, cells[i].getStateCode());
+    }
+}
+
 bool Board::operator==(const Board &_b) const
 {
-    if (cells.size() != _b.cells.size())  { return false; };
+    if (n_cells != _b.n_cells)            { return false; };
+    if (hash != _b.hash)                  { return false; };
 
-    for (size_t i = 0; i < _b.cells.size(); ++i)
+    for (size_t i = 0; i < _b.n_cells; ++i)
     {
         if (cells[i] != _b.cells[i])      { return false; };
     }
@@ -272,7 +326,11 @@ bool Board::operator!=(const Board &_b) const
 
 bool Board::addCell(const Cell& _c)
 {
-    cells.push_back(_c);
+    if (n_cells == NUMBER_OF_CELLS) { return false; }
+
+    cells[n_cells] = _c;
+    hash ^= zobristKey(n_cells, _c.getStateCode());
+    ++n_cells;
 
     return true;
 }
@@ -285,6 +343,7 @@ bool Board::resetCellStates()
     {
         cells[i].resetState();
     }
+    hash = 0;
 
     return true;
 }
@@ -297,13 +356,19 @@ bool Board::resetCells()
     {
         cells[i].resetCell();
     }
+    hash = 0;
 
     return true;
 }
 
 bool Board::resetBoard()
 {
-    cells.clear();
+    for (size_t i = 0; i < n_cells; ++i)
+    {
+        cells[i].resetCell();
+    }
+    n_cells = 0;
+    hash = 0;
 
     return true;
 }
@@ -316,11 +381,12 @@ bool Board::computeState()
     {
         cells[i].computeState();
     }
+    rehash();
 
     return true;
 }
 
-bool Board::isFull()
+bool Board::isFull() const
 {
     for (size_t i = 0; i < getNumCells(); i++)
     {
@@ -329,7 +395,7 @@ bool Board::isFull()
     return true;
 }
 
-bool Board::isEmpty()
+bool Board::isEmpty() const
 {
     for (size_t i = 0; i < getNumCells(); i++)
     {
@@ -338,12 +404,12 @@ bool Board::isEmpty()
     return true;
 }
 
-size_t Board::getNumTokens()
+size_t Board::getNumTokens() const
 {
     return getNumTokens(COL_RED) + getNumTokens(COL_BLUE);
 }
 
-size_t Board::getNumTokens(const string& _col)
+size_t Board::getNumTokens(const string& _col) const
 {
     if (_col != COL_RED && _col != COL_BLUE) { return 0; }
 
@@ -357,15 +423,15 @@ size_t Board::getNumTokens(const string& _col)
     return cnt;
 }
 
-bool Board::isOneTokenAddedRemoved(const Board& _new)
+bool Board::isOneTokenAddedRemoved(const Board& _new) const
 {
-    if (getNumCells() != _new.cells.size())  { return false; };
+    if (getNumCells() != _new.getNumCells()) { return false; };
 
     size_t sum = 0;
 
     for (size_t i = 0; i < getNumCells(); i++)
     {
-        Cell c = _new.cells[i];
+        const Cell &c = _new.cells[i];
 
         if (getCell(i) != c)
         {
@@ -384,44 +450,42 @@ bool Board::isOneTokenAddedRemoved(const Board& _new)
     return sum == 1;
 }
 
-bool Board::isOneTokenAdded(const Board& _new)
+bool Board::isOneTokenAdded(const Board& _new) const
 {
     if (not isOneTokenAddedRemoved(_new)) { return false; }
 
     return isOneTokenAdded(_new, COL_RED) || isOneTokenAdded(_new, COL_BLUE);
 }
 
-bool Board::isOneTokenAdded(const Board &_new, const string& _col)
+bool Board::isOneTokenAdded(const Board &_new, const string& _col) const
 {
     if (not isOneTokenAddedRemoved(_new)) { return false; }
     if (_col!=COL_BLUE && _col!=COL_RED)  { return false; }
 
-    Board b(_new);
-    return b.getNumTokens(_col) > getNumTokens(_col);
+    return _new.getNumTokens(_col) > getNumTokens(_col);
 }
 
-bool Board::isOneTokenRemoved(const Board& _new)
+bool Board::isOneTokenRemoved(const Board& _new) const
 {
     if (not isOneTokenAddedRemoved(_new)) { return false; }
 
     return isOneTokenRemoved(_new, COL_RED) || isOneTokenRemoved(_new, COL_BLUE);
 }
 
-bool Board::isOneTokenRemoved(const Board &_new, const string& _col)
+bool Board::isOneTokenRemoved(const Board &_new, const string& _col) const
 {
     if (not isOneTokenAddedRemoved(_new)) { return false; }
     if (_col!=COL_BLUE && _col!=COL_RED)  { return false; }
 
-    Board b(_new);
-    return b.getNumTokens(_col) < getNumTokens(_col);
+    return _new.getNumTokens(_col) < getNumTokens(_col);
 }
 
-bool Board::threeInARow()
+bool Board::threeInARow() const
 {
     return threeInARow(COL_RED) || threeInARow(COL_BLUE);
 }
 
-bool Board::threeInARow(const string& _col)
+bool Board::threeInARow(const string& _col) const
 {
     if (_col!=COL_BLUE && _col!=COL_RED) { return false; }
 
@@ -440,25 +504,90 @@ bool Board::threeInARow(const string& _col)
     return false;
 }
 
+BitMask Board::cellsInState(int _s) const
+{
+    BitMask res = 0;
+
+    for (size_t i = 0; i < getNumCells() && i < 9; ++i)
+    {
+        if (cells[i].getStateCode() == _s) { res |= cellMask(i); }
+    }
+
+    return res;
+}
+
+BitMask Board::getCells(const string& _col) const
+{
+    // The color is parsed once, and the cells are compared by their state codes
+    int s = Cell::parseState(_col);
+
+    return s == -1 ? 0 : cellsInState(s);
+}
+
+bool Board::play(size_t _move, const string& _col)
+{
+    int s = Cell::parseState(_col);
+
+    if (_move >= getNumCells() || cells[_move].getStateCode() != Cell::STATE_EMPTY) { return false; }
+    if (s != Cell::STATE_RED && s != Cell::STATE_BLUE)                            { return false; }
+
+    return setCellStateCode(_move, s);
+}
+
+bool Board::undo(size_t _move)
+{
+    if (_move >= getNumCells() || cells[_move].getStateCode() == Cell::STATE_EMPTY) { return false; }
+
+    return setCellStateCode(_move, Cell::STATE_EMPTY);
+}
+
+bool Board::wouldWin(size_t _move, const string& _col) const
+{
+    int s = Cell::parseState(_col);
+
+    if (_move >= getNumCells() || _move >= 9)                    { return false; }
+    if (cells[_move].getStateCode() != Cell::STATE_EMPTY)        { return false; }
+    if (s != Cell::STATE_RED && s != Cell::STATE_BLUE)           { return false; }
+
+    BitMask move = cellMask(_move);
+    BitMask own  = cellsInState(s) | move;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        if ((LINE_MASKS[i] & move) && (own & LINE_MASKS[i]) == LINE_MASKS[i]) { return true; }
+    }
+
+    return false;
+}
+
 void Board::fromMsgBoard(const baxter_tictactoe::MsgBoard &msgb)
 {
-    resetBoard();
+    size_t n = 0;
 
-    for (size_t i = 0; i < msgb.cells.size(); ++i)
+    for (size_t i = 0; i < msgb.cells.size() && n < NUMBER_OF_CELLS; ++i)
     {
-        // We want to keep the cell self-consistent. To this end, we add a fake
-        // non empty area if the cell is red or blue colored.
-        if      (msgb.cells[i].state == COL_RED  ) addCell(Cell(COL_RED  , 1, 0));
-        else if (msgb.cells[i].state == COL_BLUE ) addCell(Cell(COL_BLUE , 0, 1));
-        else if (msgb.cells[i].state == COL_EMPTY) addCell(Cell(COL_EMPTY, 0, 0));
-        else
+        const string &st = msgb.cells[i].state;
+
+        if (st != COL_RED && st != COL_BLUE && st != COL_EMPTY)
         {
-            ROS_WARN("MsgBoard cell state %s not allowed!", msgb.cells[i].state.c_str());
+            ROS_WARN("MsgBoard cell state %s not allowed!", st.c_str());
+            continue;
         }
+
+        // We want to keep the cell self-consistent. To this end, we add a fake
+        // non empty area if the cell is red or blue colored.
+        cells[n].resetCell();
+        cells[n].setRedArea (st == COL_RED  ? 1 : 0);
+        cells[n].setBlueArea(st == COL_BLUE ? 1 : 0);
+        cells[n].setState(st);
+        ++n;
     }
+
+    n_cells = n;
+    rehash();
 }
 
-baxter_tictactoe::MsgBoard Board::toMsgBoard()
+baxter_tictactoe::MsgBoard Board::toMsgBoard() const
 {
     baxter_tictactoe::MsgBoard res;
     res.header = std_msgs::Header();
@@ -487,7 +616,7 @@ baxter_tictactoe::MsgBoard Board::toMsgBoard()
     return res;
 }
 
-string Board::toString()
+string Board::toString() const
 {
     if (getNumCells()==0)   return "";
 
@@ -501,47 +630,86 @@ string Board::toString()
     return res.str();
 }
 
-Contours Board::getContours()
+vector<cv::Mat> Board::getContours() const
 {
-    Contours result;
+    vector<cv::Mat> result(getNumCells());
 
     for (size_t i = 0; i < getNumCells(); ++i)
     {
-        result.push_back(getCellContour(i));
+        result[i] = getCellContour(i).getMat();
     }
 
     return result;
 };
 
-cv::Mat Board::maskImage(const cv::Mat &_src)
+cv::Rect Board::getBoundingRect() const
 {
-    cv::Mat mask = cv::Mat::zeros(_src.rows, _src.cols, CV_8UC1);
+    int min_x = INT_MAX, min_y = INT_MAX;
+    int max_x = INT_MIN, max_y = INT_MIN;
+
+    for (size_t i = 0; i < getNumCells(); ++i)
+    {
+        const Polygon &c = getCellContour(i);
+
+        for (size_t j = 0; j < c.size(); ++j)
+        {
+            min_x = std::min(min_x, c[j].x);
+            min_y = std::min(min_y, c[j].y);
+            max_x = std::max(max_x, c[j].x);
+            max_y = std::max(max_y, c[j].y);
+        }
+    }
+
+    if (min_x > max_x)  { return cv::Rect(); }
+
+    // Same as cv::boundingRect, which counts both the first and the last pixel
+    return cv::Rect(min_x, min_y, max_x - min_x + 1, max_y - min_y + 1);
+}
+
+cv::Mat Board::maskImage(const cv::Mat &_src) const
+{
+    cv::Mat im_crop = cv::Mat::zeros(_src.rows, _src.cols, _src.type());
+
+    // Only the bounding rectangle of the board is masked and copied
+    cv::Rect roi = getBoundingRect() & cv::Rect(0, 0, _src.cols, _src.rows);
+    if (roi.area() == 0)    { return im_crop; }
+
+    cv::Mat mask = cv::Mat::zeros(roi.size(), CV_8UC1);
 
     // CV_FILLED fills the connected components found with white
-    cv::drawContours(mask, getContours(), -1, cv::Scalar(255), CV_FILLED);
+    cv::drawContours(mask, getContours(), -1, cv::Scalar(255), CV_FILLED, 8,
+                     cv::noArray(), INT_MAX, -roi.tl());
 
-    cv::Mat im_crop(_src.rows, _src.cols, CV_8UC3);
-    im_crop.setTo(cv::Scalar(0));
-    _src.copyTo(im_crop, mask);
+    cv::Mat im_crop_roi = im_crop(roi);
+    _src(roi).copyTo(im_crop_roi, mask);
 
     return im_crop;
 }
 
 bool Board::setCellState(size_t i, const string& _s)
+{
+    return setCellStateCode(i, Cell::parseState(_s));
+}
+
+bool Board::setCellStateCode(size_t i, int _s)
 {
     if (i >= getNumCells()) { return false; }
 
-    return cells[i].setState(_s);
+    // The hash is updated by swapping the key of the old state with the new one
+    hash ^= zobristKey(i, cells[i].getStateCode());
+    bool res = cells[i].setStateCode(_s);
+    hash ^= zobristKey(i, cells[i].getStateCode());
+
+    return res;
 }
 
 bool Board::setCell(size_t i, const Cell& _c)
 {
+    if (i >= getNumCells()) { return false; }
+
+    hash ^= zobristKey(i, cells[i].getStateCode());
     cells[i] = _c;
+    hash ^= zobristKey(i, cells[i].getStateCode());
 
     return true;
 }
-
-Board::~Board()
-{
-
-}
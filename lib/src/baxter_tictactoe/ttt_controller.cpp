@@ -26,6 +26,18 @@ TTTController::TTTController(string name, string limb, bool legacy_code, bool us
         ROS_ASSERT_MSG(nh.getParam("hsv_blue",hsv_blue_symbols), "No HSV params for BLUE!");
         hsv_blue=hsvColorRange(hsv_blue_symbols);
 
+        // Segmentation of the board: "fixed" (the default), "otsu" or "adaptive"
+        string threshold_mode;
+        double threshold_value, threshold_offset, threshold_contrast;
+        int    threshold_block;
+        nh.param<string>("threshold_mode",     threshold_mode,  "fixed");
+        nh.param<double>("threshold_value",    threshold_value,    55.0);
+        nh.param<int>   ("threshold_block",    threshold_block,      61);
+        nh.param<double>("threshold_offset",   threshold_offset,   10.0);
+        nh.param<double>("threshold_contrast", threshold_contrast,  5.0);
+        black_thresholder = Thresholder(Thresholder::modeFromString(threshold_mode), threshold_value,
+                                        threshold_block, threshold_offset, threshold_contrast);
+
         XmlRpc::XmlRpcValue tiles_pile_pos;
         ROS_ASSERT_MSG(nh.getParam("tile_pile_position",tiles_pile_pos), "No 3D position of the pile of tiles!");
         tilesPilePosFromParam(tiles_pile_pos);
@@ -318,9 +330,10 @@ Mat TTTController::isolateToken(Mat pool)
     bitwise_and(blue, pool, out);
 
     // Some morphological operations to remove noise and clean up the image
-    for (size_t i = 0; i < 2; ++i)  erode(out, out, Mat());
-    for (size_t i = 0; i < 4; ++i) dilate(out, out, Mat());
-    for (size_t i = 0; i < 2; ++i)  erode(out, out, Mat());
+    // (2 erosions, 4 dilations and 2 erosions, fused into a single pass)
+    static const int ops[] = {MORPH_ERODE,  MORPH_ERODE,  MORPH_DILATE, MORPH_DILATE,
+                              MORPH_DILATE, MORPH_DILATE, MORPH_ERODE,  MORPH_ERODE};
+    binaryMorphology(out, out, vector<int>(ops, ops + sizeof(ops) / sizeof(ops[0])));
 
     imshow("Rough", out);
 
@@ -443,7 +456,7 @@ void TTTController::isolateBlack(Mat &output)
     Mat gray;
     std::lock_guard<std::mutex> lock(mutex_img);
     cvtColor(_curr_img, gray, CV_BGR2GRAY);
-    threshold(gray, output, 55, 255, cv::THRESH_BINARY);
+    black_thresholder.apply(gray, output);
 }
 
 void TTTController::isolateBlue(Mat &output)
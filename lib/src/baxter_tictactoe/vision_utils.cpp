@@ -0,0 +1,869 @@
+#include "baxter_tictactoe/vision_utils.h"
+
+#include <cstring>
+#include <algorithm>
+#include <limits.h>
+#include <math.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+#define BIT_RED     0x01
+#define BIT_BLUE    0x02
+
+/**************************************************************************/
+/**                        BINARY MORPHOLOGY                             **/
+/**************************************************************************/
+
+namespace
+{
+    /**
+     * Applies a 3x3 erosion (or dilation) to a range of bit-packed rows. Pixels
+     * outside the image are set for the erosion and unset for the dilation, as
+     * OpenCV does by default: neither operation is affected by the border.
+     *
+     * @param _in    the input rows (_n rows of _words words each)
+     * @param _out   the output rows
+     * @param _tmp   buffer for the horizontal pass (as big as _in)
+     * @param _n     number of rows
+     * @param _words number of words per row
+     * @param _width number of pixels per row
+     * @param _top   if the first row is the first row of the image
+     * @param _bot   if the last  row is the last  row of the image
+     * @param _erode if the operation is an erosion (a dilation otherwise)
+     */
+    void morphRows(const uint64_t *_in, uint64_t *_out, uint64_t *_tmp, int _n,
+                   int _words, int _width, bool _top, bool _bot, bool _erode)
+    {
+        const uint64_t pad  = _erode ? ~uint64_t(0) : 0;
+        const int      tail = _width & 63;
+        const uint64_t last = tail ? ~uint64_t(0) << tail : 0;   // bits beyond the width
+
+        // horizontal pass: each pixel is combined with its left and right neighbors
+        for (int r = 0; r < _n; ++r)
+        {
+            const uint64_t *x = _in  + r * _words;
+            uint64_t       *h = _tmp + r * _words;
+
+            for (int w = 0; w < _words; ++w)
+            {
+                uint64_t curr = x[w];
+                uint64_t prev = w > 0          ? x[w-1] : pad;
+                uint64_t next = w < _words - 1 ? x[w+1] : pad;
+
+                if (w == _words - 1) { curr = _erode ? (curr | last) : (curr & ~last); }
+                if (w == _words - 2) { next = _erode ? (next | last) : (next & ~last); }
+
+                uint64_t left  = (curr << 1) | (prev >> 63);
+                uint64_t right = (curr >> 1) | (next << 63);
+
+                h[w] = _erode ? (left & curr & right) : (left | curr | right);
+            }
+        }
+
+        // vertical pass: each row is combined with the one above and below. The
+        // first and last rows of a strip that is not at the border of the image
+        // are left invalid, as they lack a neighbor: the strip halo takes care of it.
+        for (int r = 0; r < _n; ++r)
+        {
+            const uint64_t *above = r > 0      ? _tmp + (r-1) * _words : NULL;
+            const uint64_t *below = r < _n - 1 ? _tmp + (r+1) * _words : NULL;
+            const uint64_t *curr  = _tmp + r * _words;
+            uint64_t       *o     = _out + r * _words;
+
+            if ((above == NULL && not _top) || (below == NULL && not _bot))
+            {
+                memcpy(o, curr, _words * sizeof(uint64_t));
+                continue;
+            }
+
+            for (int w = 0; w < _words; ++w)
+            {
+                uint64_t a = above ? above[w] : pad;
+                uint64_t b = below ? below[w] : pad;
+
+                o[w] = _erode ? (a & curr[w] & b) : (a | curr[w] | b);
+            }
+        }
+    }
+}
+
+void baxter_tictactoe::binaryMorphology(const cv::Mat &_src, cv::Mat &_dst,
+                                        const std::vector<int> &_ops, int _tile_rows)
+{
+    CV_Assert(_src.type() == CV_8UC1);
+
+    const int rows  = _src.rows;
+    const int cols  = _src.cols;
+    const int words = (cols + 63) / 64;
+    const int halo  = _ops.size();
+    _tile_rows      = std::max(_tile_rows, 1);
+
+    // the whole mask is packed first, so that _dst can be the same as _src
+    std::vector<uint64_t> packed(size_t(rows) * words, 0);
+
+    for (int r = 0; r < rows; ++r)
+    {
+        const uint8_t *s = _src.ptr<uint8_t>(r);
+        uint64_t      *p = &packed[size_t(r) * words];
+
+        for (int c = 0; c < cols; ++c)
+        {
+            p[c >> 6] |= uint64_t(s[c] != 0) << (c & 63);
+        }
+    }
+
+    _dst.create(rows, cols, CV_8UC1);
+
+    size_t strip_size = size_t(_tile_rows + 2 * halo) * words;
+    std::vector<uint64_t> strip(strip_size), next(strip_size), tmp(strip_size);
+
+    for (int r0 = 0; r0 < rows; r0 += _tile_rows)
+    {
+        int r1 = std::min(r0 + _tile_rows, rows);
+
+        // every operation invalidates one more row at each end of the strip
+        int y0 = std::max(r0 - halo, 0);
+        int y1 = std::min(r1 + halo, rows);
+        int n  = y1 - y0;
+
+        memcpy(&strip[0], &packed[size_t(y0) * words], size_t(n) * words * sizeof(uint64_t));
+
+        for (size_t k = 0; k < _ops.size(); ++k)
+        {
+            morphRows(&strip[0], &next[0], &tmp[0], n, words, cols,
+                      y0 == 0, y1 == rows, _ops[k] == cv::MORPH_ERODE);
+            strip.swap(next);
+        }
+
+        for (int r = r0; r < r1; ++r)
+        {
+            const uint64_t *p = &strip[size_t(r - y0) * words];
+            uint8_t        *d = _dst.ptr<uint8_t>(r);
+
+            for (int c = 0; c < cols; ++c)
+            {
+                d[c] = uint8_t(-((p[c >> 6] >> (c & 63)) & 1));
+            }
+        }
+    }
+}
+
+int baxter_tictactoe::countSmoothedArea(const cv::Mat &_bin, const cv::Rect &_rect,
+                                        const cv::Mat &_mask, cv::Mat &_buf)
+{
+    cv::Rect img_rect(0, 0, _bin.cols, _bin.rows);
+
+    // the smoothed region extends one pixel beyond the rectangle
+    cv::Rect ext = cv::Rect(_rect.x - 1, _rect.y - 1, _rect.width + 2, _rect.height + 2) & img_rect;
+    if (ext.area() == 0 || (_rect & img_rect) != _rect)   { return 0; }
+
+    // integral image of the masked region, with a zero first row and column
+    _buf.create(ext.height + 1, ext.width + 1, CV_32SC1);
+    _buf.row(0).setTo(cv::Scalar(0));
+
+    for (int y = 0; y < ext.height; ++y)
+    {
+        int       *prev = _buf.ptr<int>(y);
+        int       *curr = _buf.ptr<int>(y + 1);
+        int        iy   = ext.y + y;
+        int        sum  = 0;
+
+        curr[0] = 0;
+
+        const uint8_t *b = _bin.ptr<uint8_t>(iy);
+        const uint8_t *m = iy >= _rect.y && iy < _rect.y + _rect.height ?
+                           _mask.ptr<uint8_t>(iy - _rect.y) : NULL;
+
+        for (int x = 0; x < ext.width; ++x)
+        {
+            int ix = ext.x + x;
+
+            if (m != NULL && ix >= _rect.x && ix < _rect.x + _rect.width)
+            {
+                sum += (b[ix] != 0) & (m[ix - _rect.x] != 0);
+            }
+
+            curr[x + 1] = prev[x + 1] + sum;
+        }
+    }
+
+    // a pixel is counted if the 3x3 box around it (within the image) has a set pixel
+    int count = 0;
+
+    for (int y = 0; y < ext.height; ++y)
+    {
+        const int *top = _buf.ptr<int>(std::max(y - 1, 0));
+        const int *bot = _buf.ptr<int>(std::min(y + 2, ext.height));
+
+        for (int x = 0; x < ext.width; ++x)
+        {
+            int x0 = std::max(x - 1, 0);
+            int x1 = std::min(x + 2, ext.width);
+
+            count += (bot[x1] - bot[x0] - top[x1] + top[x0]) > 0;
+        }
+    }
+
+    return count;
+}
+
+/**************************************************************************/
+/**                           THRESHOLDER                                **/
+/**************************************************************************/
+
+Thresholder::Thresholder(int _mode, double _value, int _block, double _offset, double _contrast) :
+                         mode(_mode), value(_value), block(std::max(_block | 1, 3)), offset(_offset),
+                         contrast(_contrast)
+{
+
+}
+
+int Thresholder::modeFromString(const string &_name)
+{
+    if (_name ==     "otsu")    { return THRESH_MODE_OTSU;     }
+    if (_name == "adaptive")    { return THRESH_MODE_ADAPTIVE; }
+
+    return THRESH_MODE_FIXED;
+}
+
+double Thresholder::apply(const cv::Mat &_gray, cv::Mat &_binary)
+{
+    CV_Assert(_gray.type() == CV_8UC1);
+
+    if (mode == THRESH_MODE_FIXED)
+    {
+        return cv::threshold(_gray, _binary, value, 255, cv::THRESH_BINARY);
+    }
+
+    if (mode == THRESH_MODE_OTSU)
+    {
+        // the threshold is computed on the region of interest, and applied to the whole image
+        cv::Rect r = roi & cv::Rect(0, 0, _gray.cols, _gray.rows);
+        if (r.area() == 0)  { r = cv::Rect(0, 0, _gray.cols, _gray.rows); }
+
+        cv::Mat tmp;
+        double thres = cv::threshold(_gray(r), tmp, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+
+        return cv::threshold(_gray, _binary, thres, 255, cv::THRESH_BINARY);
+    }
+
+    // adaptive: a pixel is set if brighter than the mean of its window minus the offset,
+    // or than the fixed threshold if the window is too uniform to have a meaningful mean
+    cv::integral(_gray, sum, sqsum, CV_32S);
+    _binary.create(_gray.size(), CV_8UC1);
+
+    const int half = block / 2;
+
+    for (int y = 0; y < _gray.rows; ++y)
+    {
+        int y0 = std::max(y - half, 0);
+        int y1 = std::min(y + half + 1, _gray.rows);
+
+        const int     *top = sum.ptr<int>(y0);
+        const int     *bot = sum.ptr<int>(y1);
+        const double  *sq_top = sqsum.ptr<double>(y0);
+        const double  *sq_bot = sqsum.ptr<double>(y1);
+        const uint8_t *g   = _gray.ptr<uint8_t>(y);
+        uint8_t       *b   = _binary.ptr<uint8_t>(y);
+
+        for (int x = 0; x < _gray.cols; ++x)
+        {
+            int x0 = std::max(x - half, 0);
+            int x1 = std::min(x + half + 1, _gray.cols);
+
+            int    area = (x1 - x0) * (y1 - y0);
+            int    s    = bot[x1] - bot[x0] - top[x1] + top[x0];
+            double sq   = sq_bot[x1] - sq_bot[x0] - sq_top[x1] + sq_top[x0];
+
+            // variance < contrast^2, and g > s / area - offset, without divisions
+            if (sq * area - double(s) * s < contrast * contrast * area * area)
+            {
+                b[x] = g[x] > value ? 255 : 0;
+            }
+            else
+            {
+                b[x] = g[x] * area > s - offset * area ? 255 : 0;
+            }
+        }
+    }
+
+    return -1.0;
+}
+
+/**************************************************************************/
+/**                           GRID FITTING                               **/
+/**************************************************************************/
+
+namespace
+{
+    // max distance of a cell from its lattice position, as a fraction of the cell pitch
+    const double GRID_TOLERANCE = 0.3;
+
+    // range of the area of a cell, as a fraction of the squared cell pitch (the upper bound
+    // is above 1 to allow for some perspective, and it excludes the contours of the board)
+    const double GRID_MIN_FILL  = 0.2;
+    const double GRID_MAX_FILL  = 1.2;
+
+    struct Lattice
+    {
+        cv::Point2d o, u, v;    // center cell and axes (cell (i,j) is at o + i*u + j*v)
+
+        cv::Point2d at(int _i, int _j) const { return o + u * _i + v * _j; };
+        double   pitch()               const { return sqrt(0.5 * (u.dot(u) + v.dot(v))); };
+    };
+
+    struct GridMatch
+    {
+        int         matched[NUMBER_OF_CELLS];   // candidate at each position (-1 if none)
+        int                           inliers;
+        double                       residual;  // sum of the squared distances
+    };
+
+    /**
+     * Matches each lattice position to the closest candidate within tolerance,
+     * among the ones whose area is compatible with the lattice.
+     */
+    GridMatch matchLattice(const Lattice &_l, const vector<cv::Point2d> &_centroids,
+                           const vector<double> &_areas)
+    {
+        GridMatch m;
+        m.inliers  =   0;
+        m.residual = 0.0;
+
+        double pitch = _l.pitch();
+        double tol   = GRID_TOLERANCE * pitch;
+        double min_a = GRID_MIN_FILL  * pitch * pitch;
+        double max_a = GRID_MAX_FILL  * pitch * pitch;
+
+        for (int k = 0; k < NUMBER_OF_CELLS; ++k)
+        {
+            cv::Point2d p = _l.at(k % 3 - 1, k / 3 - 1);
+            double best   = tol * tol;
+            m.matched[k]  = -1;
+
+            for (size_t c = 0; c < _centroids.size(); ++c)
+            {
+                if (_areas[c] < min_a || _areas[c] > max_a)   { continue; }
+
+                cv::Point2d d = _centroids[c] - p;
+                if (d.dot(d) < best)
+                {
+                    best = d.dot(d);
+                    m.matched[k] = c;
+                }
+            }
+
+            if (m.matched[k] >= 0)
+            {
+                ++m.inliers;
+                m.residual += best;
+            }
+        }
+
+        return m;
+    }
+
+    /**
+     * Least squares fit of a lattice to the matched candidates. Each coordinate
+     * is fitted independently: x = o.x + i*u.x + j*v.x (and so on for y).
+     */
+    bool refineLattice(Lattice &_l, const GridMatch &_m, const vector<cv::Point2d> &_centroids)
+    {
+        if (_m.inliers < 3)     { return false; }
+
+        double A[3][3] = {{0}}, bx[3] = {0}, by[3] = {0};
+
+        for (int k = 0; k < NUMBER_OF_CELLS; ++k)
+        {
+            if (_m.matched[k] < 0) { continue; }
+
+            double r[3] = {1.0, double(k % 3 - 1), double(k / 3 - 1)};
+            const cv::Point2d &c = _centroids[_m.matched[k]];
+
+            for (int a = 0; a < 3; ++a)
+            {
+                for (int b = 0; b < 3; ++b)   { A[a][b] += r[a] * r[b]; }
+                bx[a] += r[a] * c.x;
+                by[a] += r[a] * c.y;
+            }
+        }
+
+        // 3x3 system solved with Cramer's rule
+        double det = A[0][0] * (A[1][1] * A[2][2] - A[1][2] * A[2][1])
+                   - A[0][1] * (A[1][0] * A[2][2] - A[1][2] * A[2][0])
+                   + A[0][2] * (A[1][0] * A[2][1] - A[1][1] * A[2][0]);
+
+        if (fabs(det) < 1e-9)   { return false; }
+
+        double x[3], y[3];
+        for (int col = 0; col < 3; ++col)
+        {
+            double Mx[3][3], My[3][3];
+            for (int a = 0; a < 3; ++a)
+            {
+                for (int b = 0; b < 3; ++b)
+                {
+                    Mx[a][b] = b == col ? bx[a] : A[a][b];
+                    My[a][b] = b == col ? by[a] : A[a][b];
+                }
+            }
+
+            x[col] = (Mx[0][0] * (Mx[1][1] * Mx[2][2] - Mx[1][2] * Mx[2][1])
+                    - Mx[0][1] * (Mx[1][0] * Mx[2][2] - Mx[1][2] * Mx[2][0])
+                    + Mx[0][2] * (Mx[1][0] * Mx[2][1] - Mx[1][1] * Mx[2][0])) / det;
+            y[col] = (My[0][0] * (My[1][1] * My[2][2] - My[1][2] * My[2][1])
+                    - My[0][1] * (My[1][0] * My[2][2] - My[1][2] * My[2][0])
+                    + My[0][2] * (My[1][0] * My[2][1] - My[1][1] * My[2][0])) / det;
+        }
+
+        _l.o = cv::Point2d(x[0], y[0]);
+        _l.u = cv::Point2d(x[1], y[1]);
+        _l.v = cv::Point2d(x[2], y[2]);
+
+        return true;
+    }
+
+    bool betterMatch(const GridMatch &_a, const GridMatch &_b)
+    {
+        return _a.inliers > _b.inliers || (_a.inliers == _b.inliers && _a.residual < _b.residual);
+    }
+}
+
+double baxter_tictactoe::fitBoardGrid(const cv::Mat &_binary, double _min_area, Board &_board,
+                                      int _iterations)
+{
+    _board.resetBoard();
+
+    // candidate cells: contours that look like convex quadrilaterals
+    Contours contours;
+    cv::Mat binary = _binary.clone();   // findContours modifies its input
+    cv::findContours(binary, contours, CV_RETR_LIST, CV_CHAIN_APPROX_SIMPLE);
+
+    Contours              quads;
+    vector<double>        areas;
+    vector<cv::Point2d>   centroids;
+
+    for (size_t i = 0; i < contours.size(); ++i)
+    {
+        double area = cv::contourArea(contours[i]);
+        if (area < _min_area)   { continue; }
+
+        Contour apx;
+        cv::approxPolyDP(contours[i], apx, 0.05 * cv::arcLength(contours[i], true), true);
+
+        if (apx.size() != 4 || not cv::isContourConvex(apx))   { continue; }
+
+        cv::Moments mom = cv::moments(apx);
+        quads.push_back(apx);
+        areas.push_back(area);
+        centroids.push_back(cv::Point2d(mom.m10 / mom.m00, mom.m01 / mom.m00));
+    }
+
+    int n = quads.size();
+    if (n < NUMBER_OF_CELLS)    { return 0.0; }
+
+    // hypotheses from pairs of candidates: all of them if they are few, random ones otherwise
+    cv::RNG rng(0x5eed);
+    bool exhaustive = n * (n - 1) <= _iterations;
+    int  n_hyp      = exhaustive ? n * (n - 1) : _iterations;
+
+    Lattice   best_l;
+    GridMatch best_m;
+    best_m.inliers  =   0;
+    best_m.residual = 0.0;
+
+    for (int h = 0; h < n_hyp && best_m.inliers < NUMBER_OF_CELLS; ++h)
+    {
+        int a = exhaustive ? h / (n - 1) : rng.uniform(0, n);
+        int b = exhaustive ? h % (n - 1) : rng.uniform(0, n - 1);
+        if (b >= a) { ++b; }
+
+        Lattice l;
+        l.u = centroids[b] - centroids[a];
+        l.v = cv::Point2d(-l.u.y, l.u.x);
+
+        // candidate a can be at any position of the grid
+        for (int k = 0; k < NUMBER_OF_CELLS; ++k)
+        {
+            l.o = centroids[a] - l.u * (k % 3 - 1) - l.v * (k / 3 - 1);
+
+            GridMatch m = matchLattice(l, centroids, areas);
+            if (m.inliers < 3)  { continue; }
+
+            // a couple of refinement steps on the inliers
+            for (int r = 0; r < 2 && refineLattice(l, m, centroids); ++r)
+            {
+                m = matchLattice(l, centroids, areas);
+            }
+
+            if (betterMatch(m, best_m))
+            {
+                best_m = m;
+                best_l = l;
+            }
+        }
+    }
+
+    if (best_m.inliers < NUMBER_OF_CELLS)   { return 0.0; }
+
+    // canonical orientation: u is the lattice axis closest to the x axis of the image
+    Lattice &l = best_l;
+    for (int r = 0; r < 4 && not (l.u.x >= fabs(l.u.y)); ++r)
+    {
+        cv::Point2d u = l.u;
+        l.u =  l.v;
+        l.v = -u;
+    }
+
+    // the camera does not mirror the board, but the least squares fit could
+    if (l.u.x * l.v.y - l.u.y * l.v.x < 0)  { l.v = -l.v; }
+
+    GridMatch m = matchLattice(l, centroids, areas);
+    if (m.inliers < NUMBER_OF_CELLS)    { return 0.0; }
+
+    double min_area = areas[m.matched[0]], max_area = min_area;
+
+    for (int k = 0; k < NUMBER_OF_CELLS; ++k)
+    {
+        _board.addCell(Cell(quads[m.matched[k]]));
+        min_area = std::min(min_area, areas[m.matched[k]]);
+        max_area = std::max(max_area, areas[m.matched[k]]);
+    }
+
+    double rms = sqrt(m.residual / NUMBER_OF_CELLS) / l.pitch();
+
+    return std::max(0.0, 1.0 - rms / GRID_TOLERANCE) * (min_area / max_area);
+}
+
+/**************************************************************************/
+/**                        COLOR CLASSIFIER                              **/
+/**************************************************************************/
+
+ColorClassifier::ColorClassifier()
+{
+    memset(lut_h, 0, sizeof(lut_h));
+    memset(lut_s, 0, sizeof(lut_s));
+    memset(lut_v, 0, sizeof(lut_v));
+}
+
+void ColorClassifier::fillLUT(uint8_t *_lut, const colorRange &_range, uint8_t _bit)
+{
+    for (int i = 0; i < 256; ++i)
+    {
+        bool in_range = false;
+
+        // A range with min > max wraps around (e.g. the red hue, from 160 to 20)
+        if (_range.min <= _range.max) { in_range = i >= _range.min && i <= _range.max; }
+        else                          { in_range = i >= _range.min || i <= _range.max; }
+
+        if (in_range) { _lut[i] |= _bit; }
+    }
+}
+
+void ColorClassifier::setColors(const hsvColorRange &_red, const hsvColorRange &_blue)
+{
+    memset(lut_h, 0, sizeof(lut_h));
+    memset(lut_s, 0, sizeof(lut_s));
+    memset(lut_v, 0, sizeof(lut_v));
+
+    fillLUT(lut_h, _red.H,   BIT_RED);
+    fillLUT(lut_s, _red.S,   BIT_RED);
+    fillLUT(lut_v, _red.V,   BIT_RED);
+    fillLUT(lut_h, _blue.H, BIT_BLUE);
+    fillLUT(lut_s, _blue.S, BIT_BLUE);
+    fillLUT(lut_v, _blue.V, BIT_BLUE);
+}
+
+bool ColorClassifier::setBoard(const Board &_board, const cv::Size &_size)
+{
+    cv::Rect new_roi = _board.getBoundingRect() & cv::Rect(0, 0, _size.width, _size.height);
+
+    if (new_roi.area() == 0)  { return false; }
+
+    if (roi.area() > 0) { old_roi = old_roi.area() > 0 ? (old_roi | roi) : roi; }
+    roi = new_roi;
+
+    // The mask is as big as the bounding rectangle of the board
+    mask = cv::Mat::zeros(roi.size(), CV_8UC1);
+
+    // CV_FILLED fills the connected components found with white
+    cv::drawContours(mask, _board.getContours(), -1, cv::Scalar(255), CV_FILLED, 8,
+                     cv::noArray(), INT_MAX, -roi.tl());
+
+    return true;
+}
+
+bool ColorClassifier::classify(const cv::Mat &_hsv, cv::Mat &_red, cv::Mat &_blue)
+{
+    if (roi.area() == 0 || _hsv.type() != CV_8UC3 ||
+        (roi & cv::Rect(0, 0, _hsv.cols, _hsv.rows)) != roi)
+    {
+        return false;
+    }
+
+    cv::Mat *out[2] = {&_red, &_blue};
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        if (out[i]->size() != _hsv.size() || out[i]->type() != CV_8UC1)
+        {
+            out[i]->create(_hsv.size(), CV_8UC1);
+            out[i]->setTo(cv::Scalar(0));
+        }
+        else if (old_roi.area() > 0)
+        {
+            // The board has moved since the last call: clear the old region
+            (*out[i])(old_roi).setTo(cv::Scalar(0));
+        }
+    }
+    old_roi = cv::Rect();
+
+    for (int r = 0; r < roi.height; ++r)
+    {
+        const uint8_t *hsv  = _hsv.ptr<uint8_t>(roi.y + r) + 3 * roi.x;
+        const uint8_t *msk  =  mask.ptr<uint8_t>(r);
+        uint8_t       *red  =  _red.ptr<uint8_t>(roi.y + r) + roi.x;
+        uint8_t       *blue = _blue.ptr<uint8_t>(roi.y + r) + roi.x;
+
+        for (int c = 0; c < roi.width; ++c)
+        {
+            uint8_t cls = lut_h[hsv[3*c]] & lut_s[hsv[3*c+1]] & lut_v[hsv[3*c+2]] & msk[c];
+
+            // Branchless conversion of the class bits into 0/255 values
+            red [c] = uint8_t(-( cls       & 1));
+            blue[c] = uint8_t(-((cls >> 1) & 1));
+        }
+    }
+
+    return true;
+}
+
+/**************************************************************************/
+/**                         BOARD DETECTOR                               **/
+/**************************************************************************/
+
+BoardDetector::BoardDetector(int _levels, double _area_threshold) :
+                             levels(_levels > 0 ? _levels : 0), area_threshold(_area_threshold),
+                             mode(DETECT_CONTOURS), inner_ratio(0.6), cell_side(0), pyramid(levels)
+{
+
+}
+
+void BoardDetector::setMode(int _mode, double _inner_ratio)
+{
+    mode        = _mode == DETECT_INTEGRAL ? DETECT_INTEGRAL : DETECT_CONTOURS;
+    inner_ratio = std::min(std::max(_inner_ratio, 0.1), 1.0);
+}
+
+void BoardDetector::setColors(const hsvColorRange &_red, const hsvColorRange &_blue)
+{
+    classifier.setColors(_red, _blue);
+}
+
+const cv::Mat& BoardDetector::downscale(const cv::Mat &_img)
+{
+    if (levels == 0)
+    {
+        img_proc = _img;
+        return img_proc;
+    }
+
+    cv::pyrDown(_img, pyramid[0]);
+
+    for (int l = 1; l < levels; ++l)
+    {
+        cv::pyrDown(pyramid[l-1], pyramid[l]);
+    }
+
+    return pyramid[levels-1];
+}
+
+bool BoardDetector::setBoard(const Board &_board, const cv::Size &_size)
+{
+    board_roi = _board.getBoundingRect() & cv::Rect(0, 0, _size.width, _size.height);
+
+    if (mode == DETECT_INTEGRAL)
+    {
+        return setRectification(_board);
+    }
+
+    if (not classifier.setBoard(_board, _size))   { return false; }
+
+    cell_rects.resize(_board.getNumCells());
+    cell_masks.resize(_board.getNumCells());
+
+    for (size_t j = 0; j < _board.getNumCells(); ++j)
+    {
+        vector<cv::Mat> contours(1, _board.getCellContour(j).getMat());
+
+        cell_rects[j] = cv::boundingRect(contours[0]) & cv::Rect(0, 0, _size.width, _size.height);
+        cell_masks[j] = cv::Mat::zeros(cell_rects[j].size(), CV_8UC1);
+
+        // CV_FILLED fills the connected components found with white
+        cv::drawContours(cell_masks[j], contours, -1, cv::Scalar(255), CV_FILLED, 8,
+                         cv::noArray(), INT_MAX, -cell_rects[j].tl());
+    }
+
+    return true;
+}
+
+bool BoardDetector::setRectification(const Board &_board)
+{
+    if (_board.getNumCells() != NUMBER_OF_CELLS || board_roi.area() == 0)   { return false; }
+
+    // the rectified cells are as big as the average cell, to keep the resolution
+    double area = 0.0;
+    for (size_t j = 0; j < _board.getNumCells(); ++j)   { area += _board.getCellArea(j); }
+    area /= _board.getNumCells();
+
+    cell_side = std::max(int(sqrt(area) + 0.5), 4);
+
+    // cells are sorted row by row, so the corners of the grid are cells 0, 2, 6 and 8
+    const size_t corners[4] = {0, 2, 6, 8};
+    cv::Point2f src[4], dst[4];
+
+    for (size_t k = 0; k < 4; ++k)
+    {
+        cv::Point c = _board.getCellCentroid(corners[k]) - board_roi.tl();
+        src[k] = cv::Point2f(c.x, c.y);
+        dst[k] = cv::Point2f((0.5f + 2 * (k % 2)) * cell_side, (0.5f + 2 * (k / 2)) * cell_side);
+    }
+
+    homography = cv::getPerspectiveTransform(src, dst);
+
+    cell_scale.resize(_board.getNumCells());
+    for (size_t j = 0; j < _board.getNumCells(); ++j)
+    {
+        cell_scale[j] = double(_board.getCellArea(j)) / (cell_side * cell_side);
+    }
+
+    // the classifier works on the whole rectified board
+    Board rectified;
+    Polygon square;
+    square.push_back(cv::Point(            0,             0));
+    square.push_back(cv::Point(3 * cell_side,             0));
+    square.push_back(cv::Point(3 * cell_side, 3 * cell_side));
+    square.push_back(cv::Point(            0, 3 * cell_side));
+    rectified.addCell(Cell(square));
+
+    return classifier.setBoard(rectified, cv::Size(3 * cell_side, 3 * cell_side));
+}
+
+bool BoardDetector::detect(const cv::Mat &_img, Board &_board)
+{
+    _board.resetCellStates();
+
+    const cv::Mat &img = downscale(_img);
+
+    if (board_roi.area() == 0 || (board_roi & cv::Rect(0, 0, img.cols, img.rows)) != board_roi)
+    {
+        return false;
+    }
+
+    if (mode == DETECT_INTEGRAL)
+    {
+        if (_board.getNumCells() != cell_scale.size())   { return false; }
+
+        // rectify the board, so that cells become axis-aligned squares
+        cv::warpPerspective(img(board_roi), img_rect, homography,
+                            cv::Size(3 * cell_side, 3 * cell_side), cv::INTER_LINEAR);
+        cv::cvtColor(img_rect, img_hsv, CV_BGR2HSV);
+
+        classifier.classify(img_hsv, img_red, img_blue);
+        countIntegral(_board);
+    }
+    else
+    {
+        // convert only the region of the board to hsv color space
+        img_hsv.create(img.size(), CV_8UC3);
+        cv::Mat img_hsv_roi = img_hsv(board_roi);
+        cv::cvtColor(img(board_roi), img_hsv_roi, CV_BGR2HSV);
+
+        // mask the image to the board and threshold it in a single pass
+        classifier.classify(img_hsv, img_red, img_blue);
+        countContours(_board);
+    }
+
+    _board.computeState();
+
+    return true;
+}
+
+void BoardDetector::countContours(Board &_board)
+{
+    for (size_t i = 0; i < 2; ++i)
+    {
+        cv::Mat &hsv_filt_mask = i==0?img_red:img_blue;
+
+        for (size_t j = 0; j < _board.getNumCells() && j < cell_rects.size(); ++j)
+        {
+            Cell &cell = _board.getCell(j);
+
+            // the area of the cell once smoothed (to reduce noise) is computed
+            // within the bounding rectangle of the cell only
+            int col_area = countSmoothedArea(hsv_filt_mask, cell_rects[j], cell_masks[j], integral);
+
+            if (col_area > getAreaThreshold())
+            {
+                if (i==0)  { cell. setRedArea(col_area); }
+                else       { cell.setBlueArea(col_area); }
+            }
+        }
+    }
+}
+
+void BoardDetector::countIntegral(Board &_board)
+{
+    cv::integral( img_red,  sum_red, CV_32S);
+    cv::integral(img_blue, sum_blue, CV_32S);
+
+    // the counted square is centered in the cell
+    int margin = int(cell_side * (1.0 - inner_ratio) / 2.0 + 0.5);
+
+    // the count covers only the counted square, so it is extrapolated to the whole cell
+    double inner_scale = double(cell_side * cell_side) /
+                         ((cell_side - 2 * margin) * (cell_side - 2 * margin));
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        const cv::Mat &sum = i==0?sum_red:sum_blue;
+
+        for (size_t j = 0; j < _board.getNumCells(); ++j)
+        {
+            int x0 = (j % 3) * cell_side + margin;
+            int y0 = (j / 3) * cell_side + margin;
+            int x1 = (j % 3 + 1) * cell_side - margin;
+            int y1 = (j / 3 + 1) * cell_side - margin;
+
+            // masks are 0/255, so the sums are divided by 255
+            int n = (sum.at<int>(y1, x1) - sum.at<int>(y0, x1) -
+                     sum.at<int>(y1, x0) + sum.at<int>(y0, x0)) / 255;
+
+            // the count is brought back to the units of the cell areas,
+            // i.e. col_area = n * cell_area / ((x1-x0)*(y1-y0))
+            int col_area = int(n * inner_scale * cell_scale[j] + 0.5);
+
+            if (col_area > getAreaThreshold())
+            {
+                Cell &cell = _board.getCell(j);
+                if (i==0)  { cell. setRedArea(col_area); }
+                else       { cell.setBlueArea(col_area); }
+            }
+        }
+    }
+}
+
+Polygon BoardDetector::toFullRes(const Polygon &_c)
+{
+    Polygon res;
+
+    for (size_t i = 0; i < _c.size(); ++i)
+    {
+        res.push_back(toFullRes(_c[i]));
+    }
+
+    return res;
+}
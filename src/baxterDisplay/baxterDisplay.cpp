@@ -40,6 +40,9 @@ private:
 
     std::string yale_logo_file;
 
+    Board      board;       // last board drawn
+    bool is_board_drawn;    // false if something else has been published since then
+
     cv::Mat drawBoard(const MsgBoard& msg)
     {
         cv::Mat img(height,width,CV_8UC3,white);
@@ -105,8 +108,15 @@ private:
 
     void newBoardCb(const MsgBoard& msg)
     {
+        // The board is republished with every frame, but only redrawn when it changes
+        uint64_t last_hash = board.getHash();
+        board.fromMsgBoard(msg);
+
+        if (is_board_drawn && board.getHash() == last_hash) { return; }
+
         cv::Mat img_board = drawBoard(msg);
         publishImage(img_board);
+        is_board_drawn = true;
 
         return;
     }
@@ -142,12 +152,13 @@ public:
             // cv::waitKey(39);
 
             publishImage(img);
+            is_board_drawn = false;
         }
 
         return;
     }
 
-    BaxterDisplay() : it_(nh_)
+    BaxterDisplay() : it_(nh_), is_board_drawn(false)
     {
         image_pub_ = it_.advertise("baxter_display", 3, true);
         board_sub  = nh_.subscribe("board_state", 3, &BaxterDisplay::newBoardCb, this);
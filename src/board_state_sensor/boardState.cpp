@@ -4,11 +4,16 @@ using namespace std;
 using namespace baxter_tictactoe;
 
 BoardState::BoardState(string _name, bool _show) : ROSThreadImage(_name),
-               doShow(_show), board_state(STATE_INIT), brain_state(-1)
+               doShow(_show), board_state(STATE_INIT), brain_state(-1), img_seq(0), last_seq(0)
 {
+    // Frames are processed as soon as they arrive, instead of polling them at a fixed rate
+    img_sub         = img_trp.subscribe("/baxter_tictactoe/image", SUBSCRIBER_BUFFER,
+                                        &BoardState::imageCb, this);
     board_state_pub = nh.advertise<MsgBoard>("/baxter_tictactoe/board_state", 1);
     brain_state_sub = nh.subscribe("/baxter_tictactoe/ttt_brain_state", SUBSCRIBER_BUFFER,
                                    &BoardState::brainStateCb, this);
+    dump_frames_sub = nh.subscribe("/baxter_tictactoe/dump_frames", SUBSCRIBER_BUFFER,
+                                   &BoardState::dumpFramesCb, this);
     img_pub         = img_trp.advertise("/baxter_tictactoe/board_state_img", 1);
 
     XmlRpc::XmlRpcValue hsv_red_symbols;
@@ -21,14 +26,61 @@ BoardState::BoardState(string _name, bool _show) : ROSThreadImage(_name),
 
     ROS_ASSERT_MSG(nh.getParam("area_threshold",area_threshold), "No area threshold!");
 
+    // Minimum quality of the grid fitted to the board for the calibration to succeed
+    nh.param<double>("calib_min_quality", calib_min_quality, 0.7);
+
+    // Each pyramid level halves the resolution the board is processed at
+    int pyramid_levels;
+    nh.param<int>("pyramid_levels", pyramid_levels, 0);
+    detector = BoardDetector(pyramid_levels, area_threshold);
+    detector.setColors(hsv_red, hsv_blue);
+
+    // Segmentation of the board: "fixed", "otsu" or "adaptive" (window size at full resolution)
+    string threshold_mode;
+    double threshold_value, threshold_offset, threshold_contrast;
+    int    threshold_block;
+    nh.param<string>("threshold_mode",     threshold_mode, "adaptive");
+    nh.param<double>("threshold_value",    threshold_value,     100.0);
+    nh.param<int>   ("threshold_block",    threshold_block,        61);
+    nh.param<double>("threshold_offset",   threshold_offset,     10.0);
+    nh.param<double>("threshold_contrast", threshold_contrast,    5.0);
+    thresholder = Thresholder(Thresholder::modeFromString(threshold_mode), threshold_value,
+                              threshold_block >> detector.getLevels(), threshold_offset,
+                              threshold_contrast);
+
+    // In integral mode, the board is rectified and only the central part of each cell is counted
+    string detection_mode;
+    double cell_inner_ratio;
+    nh.param<string>("detection_mode",   detection_mode, "contours");
+    nh.param<double>("cell_inner_ratio", cell_inner_ratio,      0.6);
+    detector.setMode(detection_mode == "integral" ? DETECT_INTEGRAL : DETECT_CONTOURS, cell_inner_ratio);
+
     col_red   = cv::Scalar(  40,  40, 150);  // BGR color code
     col_empty = cv::Scalar(  60, 160,  60);
     col_blue  = cv::Scalar( 180,  40,  40);
 
+    double      frame_buffer_secs, frame_buffer_fps;
+    std::string frame_dump_dir;
+    nh.param<double>("frame_buffer_secs", frame_buffer_secs,                       5.0);
+    nh.param<double>("frame_buffer_fps",  frame_buffer_fps,                       10.0);
+    nh.param<bool>  ("frame_buffer_crop", frame_buffer_crop,                      true);
+    nh.param<string>("frame_dump_dir",    frame_dump_dir, "/tmp/baxter_tictactoe_dumps");
+    frame_buffer.reset(new FrameBuffer(frame_buffer_secs, frame_buffer_fps, frame_dump_dir));
+
+    // Period of the latency reports (from image stamp to board state publish), 0 to disable
+    nh.param<double>("latency_report_period", latency_report_period, 30.0);
+    last_report = ros::WallTime::now();
+
     ROS_INFO("Red  tokens in\t%s", hsv_red.toString().c_str());
     ROS_INFO("Blue tokens in\t%s", hsv_blue.toString().c_str());
     ROS_INFO("Area threshold: %g", area_threshold);
+    ROS_INFO("Minimum calibration quality: %g", calib_min_quality);
+    ROS_INFO("Board segmentation: %s threshold", threshold_mode.c_str());
+    ROS_INFO("Processing at 1/%i of the camera resolution", 1 << detector.getLevels());
+    ROS_INFO("Detection mode: %s", detector.getMode() == DETECT_INTEGRAL ? "integral" : "contours");
     ROS_INFO("Show param set to %i", doShow);
+    ROS_INFO("Frame buffer of %lu frames, dumps saved in %s", frame_buffer->capacity(),
+                                                              frame_dump_dir.c_str());
 
     if (doShow)
     {
@@ -44,14 +96,13 @@ void BoardState::internalThread()
 {
     while(ros::ok() && not isClosing())
     {
-        cv::Mat img_in;
-        cv::Mat img_out;
-        if (not img_empty)
-        {
-            std::lock_guard<std::mutex> lock(mutex_img);
-            img_in=curr_img;
-            img_out = img_in.clone();
-        }
+        // wait for a new frame (the timeout keeps the state machine responsive without images)
+        cv::Mat   img_in;
+        cv::Mat   img_out;
+        ros::Time img_stamp;
+        bool fresh = waitForFrame(img_in, img_stamp, 0.1);
+
+        if (fresh) { img_out = img_in.clone(); }
 
         if (board_state == STATE_INIT)
         {
@@ -62,145 +113,68 @@ void BoardState::internalThread()
         else if (board_state == STATE_CALIB && not ros::isShuttingDown())
         {
             ROS_DEBUG_THROTTLE(1,"[%i] Calibrating board..", board_state);
-            if (not img_empty)
+            if (fresh)
             {
                 cv::Mat img_gray;
                 cv::Mat img_binary;
 
-                // convert image color model from BGR to grayscale
-                cv::cvtColor(img_in, img_gray, CV_BGR2GRAY);
-
-                // convert grayscale image to binary image, using 155 threshold value to
-                // isolate white-colored board
-                cv::threshold(img_gray, img_binary, 100, 255, cv::THRESH_BINARY);
-
-                // a contour is an array of x-y coordinates describing the boundaries of an object
-                Contours contours;
-                // Vec4i = vectors w/ 4 ints
-                vector<cv::Vec4i> hierarchy;
-
-                // find white edges of outer board by finding contours (i.e boundaries)
-                cv::findContours(img_binary, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE);
+                // the board is calibrated at the processing resolution
+                const cv::Mat &img_proc = detector.downscale(img_in);
 
-                // isolate contour w/ the largest area to separate outer board from other objects in
-                // image (assuming outer board is largest object in image)
-                int largest_idx = getIthIndex(contours, LARGEST_IDX);
-
-                // draw outer board contour (i.e boundaries) onto zero matrix (i.e black image)
-                cv::Mat outer_board = cv::Mat::zeros(img_binary.size(), CV_8UC1);
-                drawContours(outer_board, contours, largest_idx,
-                             cv::Scalar(255,255,255), CV_FILLED, 8, hierarchy);
-
-                // find black edges of inner board by finding contours
-                cv::findContours(outer_board, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE);
-
-                // isolate inner board contour by finding contour w/ second largest area (given that
-                // outer board contour has the largest area)
-                int next_largest_idx = getIthIndex(contours, NEXT_LARGEST_IDX);
-
-                // draw inner board contour onto zero matrix
-                cv::Mat inner_board = cv::Mat::zeros(outer_board.size(), CV_8UC1);
-                drawContours(inner_board, contours, next_largest_idx,
-                             cv::Scalar(255,255,255), CV_FILLED, 8, hierarchy);
-
-                cv::findContours(inner_board, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE);
+                // convert image color model from BGR to grayscale
+                cv::cvtColor(img_proc, img_gray, CV_BGR2GRAY);
 
-                largest_idx = getIthIndex(contours, LARGEST_IDX);
+                // convert grayscale image to binary image, to isolate the white cells of the board
+                double thres = thresholder.apply(img_gray, img_binary);
+                ROS_DEBUG_THROTTLE(1, "[%i] Board segmentation threshold: %g", board_state, thres);
 
-                // drawn board cells onto zero matrix by drawing all contour except the
-                // the largest-area contour (which is the inner board contour)
-                cv::Mat board_cells = cv::Mat::zeros(inner_board.size(), CV_8UC1);
+                // fit a 3x3 grid to the cell-like blobs, regardless of the rotation of the board
+                double quality = fitBoardGrid(img_binary, detector.getAreaThreshold(), board);
+                ROS_DEBUG_THROTTLE(1, "[%i] Grid fit quality: %g", board_state, quality);
 
-                // find and display cell
-                if(contours.size() == NUMBER_OF_CELLS + 1)
+                if (doShow && board.getNumCells() == NUMBER_OF_CELLS)
                 {
-                    contours.erase(contours.begin() + largest_idx);
-                    board.resetBoard();
-
-                    // aproximate cell contours to quadrilaterals
-                    Contours apx_contours;
-                    for (size_t i = 0; i < contours.size(); i++)
-                    {
-                        double epsilon = arcLength(contours[i], true);
-                        Contour apx_contour_cell;
-                        approxPolyDP(contours[i], apx_contour_cell, 0.1 * epsilon, true);
-                        apx_contours.push_back(apx_contour_cell);
-                    }
-
-                    for (size_t i = 0; i < apx_contours.size(); i++)
-                    {
-                        drawContours(board_cells, apx_contours, i, cv::Scalar(255,255,255), CV_FILLED, 8);
-                    }
-
-                    // sort cell_contours in descending order of y-coordinate (not needed as test shows
-                    // that findContours apparently finds contours in ascending order of y-coordinate already)
-                    std::sort(apx_contours.begin(), apx_contours.end(), ascendingY);
-
-                    for (size_t i = 0; i <=6; i += 3)
-                    {
-                        std::sort(apx_contours.begin() + i, apx_contours.begin() + i + 3, ascendingX);
-                    }
-
-                    for (size_t i = 0; i < apx_contours.size(); i++)
-                    {
-                        board.addCell(Cell(apx_contours[i]));
-                    }
-
-                    if(doShow) { cv::imshow("[Cells_Definition] cell boundaries", board_cells); }
-
+                    cv::Mat board_cells = cv::Mat::zeros(img_binary.size(), CV_8UC1);
+                    cv::drawContours(board_cells, board.getContours(), -1, cv::Scalar(255,255,255), CV_FILLED, 8);
+                    cv::imshow("[Cells_Definition] cell boundaries", board_cells);
                     cv::waitKey(3);
+                }
 
-                    if (isBoardSane()) { ++board_state; }
+                if (board.getNumCells() == NUMBER_OF_CELLS && quality >= calib_min_quality)
+                {
+                    cv::Rect rect = board.getBoundingRect();
+                    board_roi = cv::Rect(detector.toFullRes(rect.tl()),
+                                         detector.toFullRes(rect.br()));
+                    detector.setBoard(board, img_proc.size());
+
+                    // Otsu's threshold will be computed on the board at the next calibration
+                    thresholder.setRoi(rect);
+                    ROS_INFO("Board calibrated with fit quality %g", quality);
+                    ++board_state;
                 }
+
+                bufferFrame(img_in, img_stamp);
             }
         }
         else if (board_state == STATE_READY && not ros::isShuttingDown())
         {
             ROS_DEBUG_THROTTLE(1, "[%i] Detecting Board State.. NumCells %lu", board_state, board.getNumCells());
-            if (not img_empty)
+            if (fresh)
             {
-                board.resetCellStates();
-                cv::Mat img_copy = img_in.clone();
-
-                if (board.getNumCells() == NUMBER_OF_CELLS)
+                if (board.getNumCells() == NUMBER_OF_CELLS && detector.detect(img_in, board))
                 {
-                    // convert the original image to hsv color space
-                    cv::Mat img_hsv;
-                    cv::cvtColor(img_copy,img_hsv,CV_BGR2HSV);
-
-                    // mask the original image to the board
-                    cv::Mat img_hsv_mask = board.maskImage(img_hsv);
-
-                    for (size_t i = 0; i < 2; ++i)
+                    if (doShow)
                     {
-                        cv::Mat hsv_filt_mask = hsvThreshold(img_hsv_mask, i==0?hsv_red:hsv_blue);
-                        if (doShow)
-                        {
-                            if (i==0) { cv::imshow("[Board_State_Sensor] red  mask of the board", hsv_filt_mask); }
-                            if (i==1) { cv::imshow("[Board_State_Sensor] blue mask of the board", hsv_filt_mask); }
-                        }
-
-                        for (size_t j = 0; j < board.getNumCells(); ++j)
-                        {
-                            Cell &cell = board.getCell(j);
-                            cv::Mat crop = cell.maskImage(hsv_filt_mask);
-
-                            // Let's smooth the image to reduce noise
-                            cv::GaussianBlur(crop.clone(),crop,cv::Size(3,3),0,0);
-
-                            // the area formed by the remaining pixels is computed based on the moments
-                            int col_area = cv::moments(crop,true).m00;
-
-                            if (col_area > area_threshold)
-                            {
-                                if (i==0)  { cell. setRedArea(col_area); }
-                                else       { cell.setBlueArea(col_area); }
-                            }
-                        }
+                        cv::imshow("[Board_State_Sensor] red  mask of the board", detector.getRedMask());
+                        cv::imshow("[Board_State_Sensor] blue mask of the board", detector.getBlueMask());
                     }
 
-                    board.computeState();
-                    board_state_pub.publish(board.toMsgBoard());
+                    // the board state is stamped with the time of the frame it comes from
+                    MsgBoard msg = board.toMsgBoard();
+                    msg.header.stamp = img_stamp;
+                    board_state_pub.publish(msg);
+                    latency.add((ros::Time::now() - img_stamp).toSec());
+                    bufferFrame(img_in, img_stamp);
 
                     // ROS_INFO("New board state published");
 
@@ -210,11 +184,11 @@ void BoardState::internalThread()
                         if (board.getCellState(i) ==  COL_RED) { col =  col_red; }
                         if (board.getCellState(i) == COL_BLUE) { col = col_blue; }
 
-                        Contours contours;
-                        contours.push_back(board.getCellContour(i));
+                        Polygon contour = detector.toFullRes(board.getCellContour(i));
 
-                        cv::drawContours(img_out, contours,-1, col, CV_FILLED); // drawing just the borders
-                        cv::putText(img_out, toString(int(i+1)), board.getCellCentroid(i),
+                        cv::drawContours(img_out, std::vector<cv::Mat>(1, contour.getMat()),
+                                         -1, col, CV_FILLED); // drawing just the borders
+                        cv::putText(img_out, toString(int(i+1)), detector.toFullRes(board.getCellCentroid(i)),
                                              cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar::all(255), 2);
                     }
 
@@ -224,96 +198,96 @@ void BoardState::internalThread()
             }
         }
 
-        if (not img_empty)
+        if (fresh)
         {
-            sensor_msgs::ImagePtr msg = cv_bridge::CvImage(std_msgs::Header(), "bgr8", img_out).toImageMsg();
+            std_msgs::Header header;
+            header.stamp = img_stamp;
+            sensor_msgs::ImagePtr msg = cv_bridge::CvImage(header, "bgr8", img_out).toImageMsg();
             img_pub.publish(msg);
         }
-        r.sleep();
+
+        if (latency_report_period > 0.0 && latency.getCount() > 0 &&
+            (ros::WallTime::now() - last_report).toSec() > latency_report_period)
+        {
+            ROS_INFO("Detection latency: %s", latency.toString().c_str());
+            latency.reset();
+            last_report = ros::WallTime::now();
+        }
     }
 }
 
-void BoardState::brainStateCb(const baxter_tictactoe::TTTBrainState & msg)
+void BoardState::imageCb(const sensor_msgs::ImageConstPtr& msg)
 {
-    // ROS_INFO("[%i] brainStateCb %i", board_state, msg.state);
-    brain_state = msg.state;
+    cv_bridge::CvImagePtr cv_ptr;
 
-    if (msg.state == TTTBrainState::GAME_FINISHED)
+    try
     {
-        board_state = STATE_INIT;
+        cv_ptr = cv_bridge::toCvCopy(msg, sensor_msgs::image_encodings::BGR8);
+    }
+    catch(cv_bridge::Exception& e)
+    {
+        ROS_ERROR("cv_bridge exception: %s", e.what());
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_img);
+        curr_img  = cv_ptr->image;
+        img_stamp = msg->header.stamp;
+        img_empty = false;
+        ++img_seq;
     }
+
+    cond_img.notify_one();
 }
 
-bool BoardState::isBoardSane()
+bool BoardState::waitForFrame(cv::Mat &_img, ros::Time &_stamp, double _timeout)
 {
-    for (size_t i = 0; i < board.getNumCells(); ++i)
-    {
-        // Check if area of cell is big enough
-        int cell_area = board.getCellArea(i);
-        if ( cell_area < area_threshold)
-        {
-            ROS_WARN_THROTTLE(1, "Cell #%lu has area %i (smaller than area_threshold)", i, cell_area);
-            return false;
-        }
+    std::unique_lock<std::mutex> lock(mutex_img);
 
-        // Check if centroid of cells is not contained in another cell
-        for (size_t j = 0; j < board.getNumCells(); ++j)
-        {
-            if (j != i)
-            {
-                if (cv::pointPolygonTest(board.getCellContour(j), board.getCellCentroid(i), true) >= 0)
-                {
-                    ROS_WARN("Point #%lu is inside cell #%lu", i, j);
-                    return false;
-                }
-            }
-        }
+    // a frame is processed only once: the sequence number tells if it is new
+    if (not cond_img.wait_for(lock, std::chrono::duration<double>(_timeout),
+                              [this]{ return img_seq != last_seq; }))
+    {
+        return false;
     }
+
+    _img     = curr_img;
+    _stamp   = img_stamp;
+    last_seq = img_seq;
+
     return true;
 }
 
-int BoardState::getIthIndex(Contours contours, int ith)
+void BoardState::brainStateCb(const baxter_tictactoe::TTTBrainState & msg)
 {
-    double largest_area = 0;
-    int     largest_idx = 0;
-    double next_largest_area = 0;
-    int     next_largest_idx = 0;
+    // ROS_INFO("[%i] brainStateCb %i", board_state, msg.state);
+    brain_state = msg.state;
 
-    // iterate through contours and keeps track of contour w/ largest and 2nd-largest area
-    for (size_t i = 0; i < contours.size(); i++)
+    if (msg.state == TTTBrainState::GAME_FINISHED)
     {
-        if(contourArea(contours[i], false) > largest_area)
-        {
-            next_largest_area = largest_area;
-            next_largest_idx = largest_idx;
-            largest_area = contourArea(contours[i], false);
-            largest_idx = i;
-        }
-        else if(next_largest_area < contourArea(contours[i], false) &&
-                contourArea(contours[i], false) < largest_area)
-        {
-            next_largest_area = contourArea(contours[i], false);
-            next_largest_idx = i;
-        }
+        board_state = STATE_INIT;
     }
-
-    return ith==LARGEST_IDX?largest_idx:next_largest_idx;
 }
 
-bool BoardState::ascendingY(Contour i, Contour j)
+void BoardState::dumpFramesCb(const std_msgs::String & msg)
 {
-    double y_i = moments(i, false).m01 / moments(i, false).m00;
-    double y_j = moments(j, false).m01 / moments(j, false).m00;
-
-    return y_i < y_j;
+    ROS_INFO("Frame dump requested: %s", msg.data.c_str());
+    frame_buffer->requestDump(msg.data);
 }
 
-bool BoardState::ascendingX(Contour i, Contour j)
+void BoardState::bufferFrame(const cv::Mat &_img, const ros::Time &_stamp)
 {
-    double x_i = moments(i, false).m10 / moments(i, false).m00;
-    double x_j = moments(j, false).m10 / moments(j, false).m00;
+    cv::Rect roi = board_roi & cv::Rect(0, 0, _img.cols, _img.rows);
 
-    return x_i < x_j;
+    if (frame_buffer_crop && board_state == STATE_READY && roi.area() > 0)
+    {
+        frame_buffer->push(_img(roi), board, _stamp);
+    }
+    else
+    {
+        frame_buffer->push(_img, board, _stamp);
+    }
 }
 
 BoardState::~BoardState()
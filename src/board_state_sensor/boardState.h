@@ -9,36 +9,46 @@
 #include <sensor_msgs/image_encodings.h>
 #include <string>
 #include <iostream>
+#include <memory>
+#include <condition_variable>
+
+#include <std_msgs/String.h>
 
 #include <robot_perception/hsv_detection.h>
 
 #include <robot_utils/ros_thread_image.h>
 
 #include "baxter_tictactoe/tictactoe_utils.h"
+#include "baxter_tictactoe/vision_utils.h"
+#include "baxter_tictactoe/latency_histogram.h"
 #include "baxter_tictactoe/TTTBrainState.h"
 
+#include "frameBuffer.h"
+
 #define STATE_INIT      0
 #define STATE_CALIB     1
 #define STATE_READY     2
 
-#define LARGEST_IDX         1
-#define NEXT_LARGEST_IDX    2
-
 class BoardState : public ROSThreadImage
 {
 private:
     ros::Publisher          board_state_pub;
     ros::Subscriber         brain_state_sub;
+    ros::Subscriber         dump_frames_sub;
     image_transport::Publisher      img_pub;
 
     baxter_tictactoe::Board board;
     baxter_tictactoe::Cell   cell;
 
-    double area_threshold;
+    double    area_threshold;
+    double calib_min_quality;   // minimum quality of the grid fit for the calibration to succeed
 
     hsvColorRange  hsv_red;
     hsvColorRange hsv_blue;
 
+    baxter_tictactoe::BoardDetector detector; // detects the cell states, possibly at a lower resolution
+    baxter_tictactoe::Thresholder thresholder; // segments the board for the calibration
+
     bool doShow;
 
     int board_state; // State of the board
@@ -48,25 +58,28 @@ private:
     cv::Scalar   col_red;
     cv::Scalar  col_blue;
 
-    /**
-     * @param      vector (i.e array) of contours, type indicating whether largest or
-     *             next largest area is to be found where (LARGEST = largest area,
-     *             NEXT_LARGEST = next largest area)
-     *
-     * @return     index of the contour with the largest area or the next largest area
-     */
-    int getIthIndex(baxter_tictactoe::Contours contours, int ith);
+    std::condition_variable cond_img;   // signalled by imageCb when a new frame arrives
+    ros::Time              img_stamp;   // header stamp of the current frame
+    unsigned long            img_seq;   // sequence number of the current frame
+    unsigned long           last_seq;   // sequence number of the last frame processed
+
+    baxter_tictactoe::LatencyHistogram latency; // from image stamp to board state publish
+    double             latency_report_period;   // [s]
+    ros::WallTime                last_report;
+
+    std::unique_ptr<FrameBuffer> frame_buffer; // ring buffer of the last frames, for debugging
+    bool                   frame_buffer_crop; // if to store only the board region of the frames
+    cv::Rect                       board_roi; // bounding rectangle of the calibrated board
 
     /**
-     * TODO
-     *
-     * @param i [description]
-     * @param j [description]
+     * Waits for a frame that has not been processed yet.
      *
-     * @return [description]
+     * @param  _img     the frame
+     * @param  _stamp   the header stamp of the frame
+     * @param  _timeout maximum time to wait [s]
+     * @return          true/false if a new frame has arrived or not
      */
-    static bool ascendingY(baxter_tictactoe::Contour i, baxter_tictactoe::Contour j);
-    static bool ascendingX(baxter_tictactoe::Contour i, baxter_tictactoe::Contour j);
+    bool waitForFrame(cv::Mat &_img, ros::Time &_stamp, double _timeout);
 
     /**
      * Callback to get the state of the demo.
@@ -74,16 +87,28 @@ private:
     void brainStateCb(const baxter_tictactoe::TTTBrainState & msg);
 
     /**
-     * Checks if the detected board satisfies some empirical rule. For the time being, the only
-     * thing checked is if the centroids of the cells are not within the contour of any other cell.
+     * Callback to request a dump of the frame buffer. The message carries the
+     * reason of the dump (e.g. an anomaly flagged by the brain).
+     **/
+    void dumpFramesCb(const std_msgs::String & msg);
+
+    /**
+     * Stores the current frame into the frame buffer, cropped to the board
+     * region if requested and if the board has been calibrated.
      *
-     * @return true/false if the board is "sane"
+     * @param _img   the current frame
+     * @param _stamp the time the frame was acquired
      */
-    bool isBoardSane();
+    void bufferFrame(const cv::Mat &_img, const ros::Time &_stamp);
 
 protected:
     void internalThread();
 
+    /**
+     * Callback for the images. It stores the frame and wakes up the thread.
+     **/
+    void imageCb(const sensor_msgs::ImageConstPtr& msg);
+
 public:
     BoardState(std::string _name, bool _show = "false");
     ~BoardState();
@@ -0,0 +1,173 @@
+#include "frameBuffer.h"
+
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <sys/stat.h>
+
+#include <opencv2/highgui/highgui.hpp>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+FrameBuffer::FrameBuffer(double _secs, double _fps, string _dump_dir) :
+                         head(0), period(_fps>0?1.0/_fps:0.0),
+                         dump_dir(_dump_dir), dump_reason(""), is_closing(false)
+{
+    size_t n_slots = _secs*_fps>1?size_t(_secs*_fps):1;
+
+    ring.resize(n_slots);
+    staging.resize(n_slots);
+
+    writer_thread = std::thread(&FrameBuffer::writerThread, this);
+}
+
+bool FrameBuffer::push(const cv::Mat &_img, Board &_board, const ros::Time &_stamp)
+{
+    ros::Time now = ros::Time::now();
+
+    if (_img.empty() || now - last_push < period)  { return false; }
+
+    std::lock_guard<std::mutex> lck(mutex_ring);
+
+    Slot &slot = ring[head];
+
+    // copyTo reuses the memory of the slot if the size of the frame has not changed
+    _img.copyTo(slot.img);
+    slot.stamp = _stamp;
+
+    for (size_t i = 0; i < NUMBER_OF_CELLS; ++i)
+    {
+        slot.area_red [i] = i < _board.getNumCells()? _board.getCellAreaRed (i) : 0;
+        slot.area_blue[i] = i < _board.getNumCells()? _board.getCellAreaBlue(i) : 0;
+    }
+
+    slot.valid = true;
+
+    head      = (head + 1) % ring.size();
+    last_push = now;
+
+    return true;
+}
+
+void FrameBuffer::requestDump(const string &_reason)
+{
+    std::lock_guard<std::mutex> lck(mutex_ring);
+
+    if (not dump_reason.empty())
+    {
+        ROS_WARN("Frame dump already in progress. Dump request [%s] ignored.", _reason.c_str());
+        return;
+    }
+
+    // The content of the ring is moved to the staging area by swapping the
+    // slots, which only exchanges the headers of the images. The sensor thread
+    // keeps writing onto the (now invalid) slots previously owned by the writer.
+    for (size_t i = 0; i < ring.size(); ++i)
+    {
+        std::swap(staging[i], ring[(head + i) % ring.size()]);
+        ring[(head + i) % ring.size()].valid = false;
+    }
+
+    // The reason becomes part of a path: anything that is not [A-Za-z0-9_-] is
+    // replaced, so that e.g. '/' or ".." can not escape from dump_dir
+    dump_reason = _reason.empty()?"request":_reason.substr(0, 64);
+
+    for (size_t i = 0; i < dump_reason.size(); ++i)
+    {
+        char ch = dump_reason[i];
+        if (not (isalnum(ch) || ch == '_' || ch == '-')) { dump_reason[i] = '_'; }
+    }
+
+    cond_dump.notify_one();
+}
+
+void FrameBuffer::writerThread()
+{
+    while (true)
+    {
+        string reason;
+        {
+            std::unique_lock<std::mutex> lck(mutex_ring);
+            cond_dump.wait(lck, [this]{ return is_closing || not dump_reason.empty(); });
+
+            // A pending dump is flushed before closing
+            if (dump_reason.empty()) { break; }
+            if (is_closing)
+            {
+                ROS_INFO("Flushing the pending frame dump [%s] before closing.", dump_reason.c_str());
+            }
+            reason = dump_reason;
+        }
+
+        writeStaging(reason);
+
+        std::lock_guard<std::mutex> lck(mutex_ring);
+        dump_reason = "";
+    }
+}
+
+bool FrameBuffer::writeStaging(const string &_reason)
+{
+    ros::WallTime now = ros::WallTime::now();
+
+    char folder_name[64];
+    snprintf(folder_name, sizeof(folder_name), "/%u_%09u_", now.sec, now.nsec);
+    string folder = dump_dir + folder_name + _reason;
+
+    // Creates all the folders in the path, if needed
+    for (size_t pos = folder.find('/', 1); pos != string::npos; pos = folder.find('/', pos + 1))
+    {
+        mkdir(folder.substr(0, pos).c_str(), 0755);
+    }
+
+    if (mkdir(folder.c_str(), 0755) != 0)
+    {
+        ROS_ERROR("Unable to create folder %s for the frame dump.", folder.c_str());
+        return false;
+    }
+
+    ofstream areas((folder + "/areas.csv").c_str());
+    areas << "frame,stamp";
+    for (size_t i = 0; i < NUMBER_OF_CELLS; ++i) { areas <<  ",red_" << i+1; }
+    for (size_t i = 0; i < NUMBER_OF_CELLS; ++i) { areas << ",blue_" << i+1; }
+    areas << "\n";
+
+    size_t n_frames = 0;
+
+    for (size_t i = 0; i < staging.size(); ++i)
+    {
+        Slot &slot = staging[i];
+        if (not slot.valid) { continue; }
+
+        char frame_name[32];
+        snprintf(frame_name, sizeof(frame_name), "/frame_%04lu.png", n_frames);
+        cv::imwrite(folder + frame_name, slot.img);
+
+        areas << n_frames << "," << slot.stamp.sec << "." << setfill('0') << setw(9)
+              << slot.stamp.nsec << setfill(' ');
+        for (size_t j = 0; j < NUMBER_OF_CELLS; ++j) { areas << "," << slot.area_red [j]; }
+        for (size_t j = 0; j < NUMBER_OF_CELLS; ++j) { areas << "," << slot.area_blue[j]; }
+        areas << "\n";
+
+        slot.valid = false;
+        ++n_frames;
+    }
+
+    ROS_INFO("Dumped %lu frames to %s", n_frames, folder.c_str());
+    return true;
+}
+
+FrameBuffer::~FrameBuffer()
+{
+    {
+        std::lock_guard<std::mutex> lck(mutex_ring);
+        is_closing = true;
+    }
+    cond_dump.notify_one();
+
+    if (writer_thread.joinable())
+    {
+        writer_thread.join();
+    }
+}
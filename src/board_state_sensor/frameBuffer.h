@@ -0,0 +1,102 @@
+#ifndef __FRAME_BUFFER_H__
+#define __FRAME_BUFFER_H__
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <ros/ros.h>
+#include <opencv2/core/core.hpp>
+
+#include "baxter_tictactoe/tictactoe_utils.h"
+
+/**
+ * Fixed-memory ring buffer of the last frames seen by the board state sensor,
+ * together with the cell areas computed on them. Its content can be dumped to
+ * disk for post-mortem debugging. Dumps are carried out by an internal writer
+ * thread, so that the sensor thread never waits for disk I/O.
+ */
+class FrameBuffer
+{
+private:
+    struct Slot
+    {
+        cv::Mat                img;  // frame (or board crop)
+        ros::Time            stamp;  // time the frame was acquired (from the header of the image)
+        std::vector<int>  area_red;  // red  area of each cell
+        std::vector<int> area_blue;  // blue area of each cell
+        bool                 valid;  // if the slot contains a frame
+
+        Slot() : area_red(NUMBER_OF_CELLS, 0), area_blue(NUMBER_OF_CELLS, 0), valid(false) {};
+    };
+
+    std::vector<Slot>    ring;  // ring buffer written by the sensor thread
+    std::vector<Slot> staging;  // slots owned by the writer thread during a dump
+    size_t               head;  // index of the next slot to be written
+
+    ros::Duration period;    // minimum time between two stored frames
+    ros::Time  last_push;    // time the last frame was stored
+
+    std::string   dump_dir;  // directory where dumps are saved
+    std::string dump_reason; // reason of the pending dump (empty if none)
+    bool        is_closing;  // flag to close the writer thread
+
+    std::mutex                mutex_ring;
+    std::condition_variable    cond_dump;
+    std::thread            writer_thread;
+
+    /**
+     * Writer thread. It waits for dump requests and saves the staged frames to disk.
+     */
+    void writerThread();
+
+    /**
+     * Saves the staged slots to a new folder in dump_dir.
+     *
+     * @param _reason the reason of the dump, used to name the folder
+     * @return        true/false if success/failure
+     */
+    bool writeStaging(const std::string &_reason);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _secs     number of seconds to keep in the buffer
+     * @param _fps      number of frames per second to store
+     * @param _dump_dir directory where dumps are saved
+     */
+    FrameBuffer(double _secs, double _fps, std::string _dump_dir);
+
+    /**
+     * Destructor. A dump that is still pending is written before the writer thread is closed.
+     */
+    ~FrameBuffer();
+
+    /**
+     * Stores a frame and the cell areas of the board into the ring buffer. The
+     * frame is dropped if it comes too early with respect to the requested fps.
+     * Once the buffer has been warmed up, no memory is allocated as long as
+     * the size of the frame does not change.
+     *
+     * @param _img   the frame
+     * @param _board the board whose cell areas have been computed on the frame
+     * @param _stamp the time the frame was acquired
+     * @return       true/false if the frame has been stored or dropped
+     */
+    bool push(const cv::Mat &_img, baxter_tictactoe::Board &_board, const ros::Time &_stamp);
+
+    /**
+     * Requests an asynchronous dump of the buffer to disk. It returns immediately.
+     * The reason comes from a topic, so only letters, digits, '_' and '-' are kept
+     * in the name of the folder (the others are replaced by '_').
+     *
+     * @param _reason the reason of the dump (e.g. "request" or "anomaly")
+     */
+    void requestDump(const std::string &_reason);
+
+    /* Self-explaining "getters" */
+    size_t capacity() { return ring.size(); };
+};
+
+#endif //__FRAME_BUFFER_H__
@@ -0,0 +1,86 @@
+#include "sessionRecorder.h"
+
+#include <opencv2/highgui/highgui.hpp>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+SessionRecorder::SessionRecorder(string _filename, string _image_format) :
+                                 nh("baxter_tictactoe"), img_trp(nh),
+                                 image_format(_image_format), last_brain_state(-1)
+{
+    if (not writer.open(_filename))
+    {
+        ROS_ERROR("Unable to open session log %s", _filename.c_str());
+        return;
+    }
+
+    img_sub    = img_trp.subscribe("/baxter_tictactoe/image", SUBSCRIBER_BUFFER,
+                                   &SessionRecorder::imageCb, this);
+    board_sub  = nh.subscribe("/baxter_tictactoe/board_state",     SUBSCRIBER_BUFFER,
+                              &SessionRecorder::boardCb,  this);
+    brain_sub  = nh.subscribe("/baxter_tictactoe/ttt_brain_state", SUBSCRIBER_BUFFER,
+                              &SessionRecorder::brainCb,  this);
+    action_sub = nh.subscribe("/baxter_tictactoe/robot_action",    SUBSCRIBER_BUFFER,
+                              &SessionRecorder::actionCb, this);
+    speech_sub = nh.subscribe("/robotsound",                       SUBSCRIBER_BUFFER,
+                              &SessionRecorder::speechCb, this);
+
+    ROS_INFO("Recording session to %s (frames encoded as %s)", _filename.c_str(),
+                                                                 image_format.c_str());
+}
+
+void SessionRecorder::imageCb(const sensor_msgs::ImageConstPtr& _msg)
+{
+    cv_bridge::CvImageConstPtr cv_ptr;
+
+    try
+    {
+        cv_ptr = cv_bridge::toCvShare(_msg, sensor_msgs::image_encodings::BGR8);
+    }
+    catch(cv_bridge::Exception& e)
+    {
+        ROS_ERROR("[SessionRecorder] cv_bridge exception: %s", e.what());
+        return;
+    }
+
+    std::vector<uint8_t> encoded;
+    cv::imencode(image_format, cv_ptr->image, encoded);
+
+    writer.write(REC_IMAGE, ros::Time::now().toNSec(), encoded.data(), encoded.size());
+}
+
+void SessionRecorder::boardCb(const MsgBoard& _msg)
+{
+    writeMsg(REC_BOARD, _msg);
+}
+
+void SessionRecorder::brainCb(const TTTBrainState& _msg)
+{
+    // The brain state is published at 10Hz: only the changes are recorded
+    if (_msg.state == last_brain_state)   { return; }
+    last_brain_state = _msg.state;
+
+    writeMsg(REC_BRAIN_STATE, _msg);
+}
+
+void SessionRecorder::actionCb(const std_msgs::String& _msg)
+{
+    writer.write(REC_ACTION, ros::Time::now().toNSec(), _msg.data.data(), _msg.data.size());
+}
+
+void SessionRecorder::speechCb(const sound_play::SoundRequest& _msg)
+{
+    if (_msg.sound != sound_play::SoundRequest::SAY) { return; }
+
+    writer.write(REC_SPEECH, ros::Time::now().toNSec(), _msg.arg.data(), _msg.arg.size());
+}
+
+SessionRecorder::~SessionRecorder()
+{
+    if (writer.isOpen())
+    {
+        ROS_INFO("Session recorded with %lu records.", writer.getNumRecords());
+        writer.close();
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef __SESSION_RECORDER_H__
+#define __SESSION_RECORDER_H__
+
+#include <ros/ros.h>
+#include <image_transport/image_transport.h>
+#include <cv_bridge/cv_bridge.h>
+#include <std_msgs/String.h>
+#include <sound_play/SoundRequest.h>
+
+#include "baxter_tictactoe/MsgBoard.h"
+#include "baxter_tictactoe/TTTBrainState.h"
+#include "baxter_tictactoe/session_log.h"
+
+/**
+ * Records a session of the demo into a session log: camera frames, board
+ * states, brain states, robot actions and sentences said by the robot.
+ * Callbacks are served by a single thread (ros::spin), so that writes to
+ * the log do not need to be synchronized.
+ */
+class SessionRecorder
+{
+private:
+    ros::NodeHandle                   nh;
+    image_transport::ImageTransport   img_trp;
+    image_transport::Subscriber       img_sub;
+
+    ros::Subscriber    board_sub;
+    ros::Subscriber    brain_sub;
+    ros::Subscriber   action_sub;
+    ros::Subscriber   speech_sub;
+
+    baxter_tictactoe::SessionWriter writer;
+
+    std::string      image_format;  // format used to encode the frames (e.g. ".png" or ".jpg")
+    std::vector<uint8_t>   buffer;  // buffer reused to serialize messages
+    int          last_brain_state;  // last brain state recorded
+
+    /**
+     * Serializes a ROS message and writes it to the log.
+     *
+     * @param _type type of the record
+     * @param _msg  the message
+     */
+    template<class M>
+    void writeMsg(uint32_t _type, const M &_msg)
+    {
+        uint32_t size = ros::serialization::serializationLength(_msg);
+        buffer.resize(size);
+
+        ros::serialization::OStream stream(buffer.data(), size);
+        ros::serialization::serialize(stream, _msg);
+
+        writer.write(_type, ros::Time::now().toNSec(), buffer.data(), size);
+    };
+
+    /* CALLBACKS */
+    void imageCb (const sensor_msgs::ImageConstPtr&           _msg);
+    void boardCb (const baxter_tictactoe::MsgBoard&           _msg);
+    void brainCb (const baxter_tictactoe::TTTBrainState&      _msg);
+    void actionCb(const std_msgs::String&                     _msg);
+    void speechCb(const sound_play::SoundRequest&             _msg);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _filename     name of the session log
+     * @param _image_format format used to encode the frames (".png" is lossless)
+     */
+    SessionRecorder(std::string _filename, std::string _image_format = ".png");
+
+    ~SessionRecorder();
+
+    /* Self-explaining "getters" */
+    bool isOk() { return writer.isOpen(); };
+};
+
+#endif //__SESSION_RECORDER_H__
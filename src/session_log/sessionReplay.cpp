@@ -0,0 +1,98 @@
+#include "sessionReplay.h"
+
+#include <algorithm>
+
+#include <opencv2/highgui/highgui.hpp>
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+SessionReplay::SessionReplay(string _filename, bool _pub_images, bool _pub_boards, bool _pub_brain) :
+                             nh("baxter_tictactoe"), img_trp(nh), pub_images(_pub_images),
+                             pub_boards(_pub_boards), pub_brain(_pub_brain)
+{
+    if (not reader.open(_filename))
+    {
+        ROS_ERROR("Unable to open session log %s", _filename.c_str());
+        return;
+    }
+
+    img_pub   = img_trp.advertise("/baxter_tictactoe/image", 1);
+    board_pub = nh.advertise<MsgBoard>("/baxter_tictactoe/board_state", 1);
+    brain_pub = nh.advertise<TTTBrainState>("/baxter_tictactoe/ttt_brain_state", 1);
+
+    ROS_INFO("Session %s: %lu records, %g seconds", _filename.c_str(), reader.getNumRecords(),
+                             (reader.getEndStamp() - reader.getStartStamp()) * 1e-9);
+}
+
+size_t SessionReplay::play(double _rate, double _start)
+{
+    if (not isOk()) { return 0; }
+
+    uint64_t start_stamp = reader.getStartStamp() + uint64_t(std::max(_start, 0.0) * 1e9);
+    size_t   first       = reader.seek(start_stamp);
+
+    ros::WallTime start_time = ros::WallTime::now();
+    size_t n_replayed = 0;
+
+    for (size_t i = first; i < reader.getNumRecords() && ros::ok(); ++i)
+    {
+        Record rec;
+        if (not reader.get(i, rec))
+        {
+            ROS_WARN("Skipping record %lu: it points outside of the log", i);
+            continue;
+        }
+
+        if (_rate > 0)
+        {
+            // Waits until the time of the record, scaled by the rate
+            ros::WallTime t = start_time + ros::WallDuration((rec.stamp_ns - start_stamp) * 1e-9 / _rate);
+            ros::WallDuration wait = t - ros::WallTime::now();
+            if (wait > ros::WallDuration(0.0)) { wait.sleep(); }
+        }
+
+        replayRecord(rec);
+        ++n_replayed;
+    }
+
+    ROS_INFO("Replayed %lu records in %g seconds", n_replayed,
+                                 (ros::WallTime::now() - start_time).toSec());
+    return n_replayed;
+}
+
+void SessionReplay::replayRecord(const Record &_rec)
+{
+    if      (_rec.type == REC_IMAGE && pub_images)
+    {
+        cv::Mat img = cv::imdecode(cv::Mat(1, _rec.size, CV_8UC1, const_cast<uint8_t*>(_rec.data)),
+                                   CV_LOAD_IMAGE_COLOR);
+
+        std_msgs::Header h;
+        h.stamp = ros::Time::now();
+        img_pub.publish(cv_bridge::CvImage(h, "bgr8", img).toImageMsg());
+    }
+    else if (_rec.type == REC_BOARD && pub_boards)
+    {
+        MsgBoard msg;
+        if (not readMsg(_rec, msg)) { return; }
+        msg.header.stamp = ros::Time::now();
+        board_pub.publish(msg);
+    }
+    else if (_rec.type == REC_BRAIN_STATE && pub_brain)
+    {
+        TTTBrainState msg;
+        if (not readMsg(_rec, msg)) { return; }
+        brain_pub.publish(msg);
+    }
+    else if (_rec.type == REC_ACTION)
+    {
+        ROS_INFO("[%.3f] Recorded action: %.*s", _rec.stamp_ns * 1e-9, int(_rec.size),
+                                        reinterpret_cast<const char*>(_rec.data));
+    }
+    else if (_rec.type == REC_SPEECH)
+    {
+        ROS_INFO("[%.3f] Recorded speech: %.*s", _rec.stamp_ns * 1e-9, int(_rec.size),
+                                        reinterpret_cast<const char*>(_rec.data));
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef __SESSION_REPLAY_H__
+#define __SESSION_REPLAY_H__
+
+#include <ros/ros.h>
+#include <image_transport/image_transport.h>
+#include <cv_bridge/cv_bridge.h>
+
+#include "baxter_tictactoe/MsgBoard.h"
+#include "baxter_tictactoe/TTTBrainState.h"
+#include "baxter_tictactoe/session_log.h"
+
+/**
+ * Replays a session log, in order to re-drive the board state sensor (with
+ * the recorded frames) and/or the brain (with the recorded board states)
+ * offline. Robot actions and sentences are printed to compare the behavior
+ * of the brain with the recorded one.
+ */
+class SessionReplay
+{
+private:
+    ros::NodeHandle                   nh;
+    image_transport::ImageTransport   img_trp;
+    image_transport::Publisher        img_pub;
+
+    ros::Publisher board_pub;
+    ros::Publisher brain_pub;
+
+    baxter_tictactoe::SessionReader reader;
+
+    bool   pub_images;  // if to publish the recorded frames (to drive the sensor)
+    bool   pub_boards;  // if to publish the recorded boards (to drive the brain)
+    bool   pub_brain;   // if to publish the recorded brain states (to drive the sensor)
+
+    /**
+     * Deserializes a ROS message from a record.
+     *
+     * @param _rec the record
+     * @param _msg the message
+     * @return     true/false if success/failure (e.g. a corrupted record)
+     */
+    template<class M>
+    bool readMsg(const baxter_tictactoe::Record &_rec, M &_msg)
+    {
+        try
+        {
+            ros::serialization::IStream stream(const_cast<uint8_t*>(_rec.data), _rec.size);
+            ros::serialization::deserialize(stream, _msg);
+        }
+        catch (const ros::Exception &e)
+        {
+            ROS_WARN("[%.3f] Skipping a corrupted record: %s", _rec.stamp_ns * 1e-9, e.what());
+            return false;
+        }
+
+        return true;
+    };
+
+    /**
+     * Publishes (or prints) a record.
+     *
+     * @param _rec the record
+     */
+    void replayRecord(const baxter_tictactoe::Record &_rec);
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param _filename   name of the session log
+     * @param _pub_images if to publish the recorded frames
+     * @param _pub_boards if to publish the recorded boards
+     * @param _pub_brain  if to publish the recorded brain states
+     */
+    SessionReplay(std::string _filename, bool _pub_images = true,
+                  bool _pub_boards = false, bool _pub_brain = false);
+
+    /**
+     * Replays the session.
+     *
+     * @param _rate  speed of the replay w.r.t. the recorded one (<= 0 means as fast as possible)
+     * @param _start time from the beginning of the session where to start the replay [s]
+     * @return       the number of records replayed
+     */
+    size_t play(double _rate = 1.0, double _start = 0.0);
+
+    /* Self-explaining "getters" */
+    bool isOk() { return reader.isOpen(); };
+};
+
+#endif //__SESSION_REPLAY_H__
@@ -0,0 +1,27 @@
+#include "sessionRecorder.h"
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "session_recorder");
+
+    // Usage: session_recorder <file> [--format .png|.jpg]
+    if (argc < 2)
+    {
+        ROS_ERROR("Usage: session_recorder <file> [--format .png|.jpg]");
+        return 1;
+    }
+
+    std::string format = ".png";
+    if (argc > 3 && std::string(argv[2])=="--format")
+    {
+        format = argv[3];
+    }
+
+    SessionRecorder recorder(argv[1], format);
+
+    if (not recorder.isOk()) { return 1; }
+
+    ros::spin();
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include "sessionReplay.h"
+
+#include <stdlib.h>
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "session_replay");
+
+    // Usage: session_replay <file> [--rate r] [--start s] [--images bool] [--boards bool] [--brain bool]
+    // A rate of 0 replays the session as fast as possible.
+    if (argc < 2)
+    {
+        ROS_ERROR("Usage: session_replay <file> [--rate r] [--start s] "
+                  "[--images true|false] [--boards true|false] [--brain true|false]");
+        return 1;
+    }
+
+    double  rate = 1.0;
+    double start = 0.0;
+    bool  images = true;
+    bool  boards = false;
+    bool   brain = false;
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        std::string arg(argv[i]), val(argv[i+1]);
+
+        if      (arg == "--rate")   {   rate = atof(val.c_str()); }
+        else if (arg == "--start")  {  start = atof(val.c_str()); }
+        else if (arg == "--images") { images = val == "true";     }
+        else if (arg == "--boards") { boards = val == "true";     }
+        else if (arg == "--brain")  {  brain = val == "true";     }
+    }
+
+    SessionReplay replay(argv[1], images, boards, brain);
+
+    if (not replay.isOk()) { return 1; }
+
+    // Gives some time to the subscribers to connect
+    ros::Duration(1.0).sleep();
+
+    replay.play(rate, start);
+
+    return 0;
+}
@@ -1,6 +1,6 @@
 #include "tictactoeBrain.h"
 
-#include <stdlib.h> // srand, rand
+#include <math.h>   // round
 
 using namespace std;
 using namespace baxter_tictactoe;
@@ -8,22 +8,27 @@ using namespace baxter_tictactoe;
 tictactoeBrain::tictactoeBrain(std::string _name, std::string _strategy, bool _legacy_code) :
                                nh(_name), spinner(4), r(100), is_closing(false),
                                legacy_code(_legacy_code), print_level(0), num_games(NUM_GAMES),
-                               curr_game(0), wins(3,0), curr_board(9),
-                               internal_board(9), is_board_detected(false),
+                               curr_game(0), num_matches(0), curr_match(0), match_abandoned(false),
+                               match_pause(5.0), idle_time(120.0), wins(3,0), curr_board(9),
+                               internal_board(9), is_board_detected(false), curr_board_seq(0),
+                               n_glitches(0), n_illegal(0), game_glitches(0), game_illegal(0),
+                               game_moves(0), queued_time(0.0), strategy(NULL), decision_time(1.0), runner(ros::Time::now().nsec),
                                left_ttt_ctrl(_name, "left", _legacy_code),
-                               right_ttt_ctrl(_name, "right", _legacy_code),
+                               right_ttt_ctrl(_name, "right", _legacy_code), opponent_skill(0.5),
+                               planner_skill(0.5), last_opp_cell(-1), adaptive_difficulty(true),
                                n_robot_tokens(0), n_human_tokens(0)
 {
     printf("\n");
     ROS_INFO_COND(print_level>=1, "Legacy code %s enabled.", _legacy_code?"is":"is not");
     setBrainState(TTTBrainState::INIT);
 
-    srand(ros::Time::now().nsec);
-    setStrategy(_strategy);
+    rng.seed(ros::Time::now().nsec);
 
     boardState_sub = nh.subscribe("/baxter_tictactoe/board_state", SUBSCRIBER_BUFFER,
                                     &tictactoeBrain::boardStateCb, this);
     tttBrain_pub   = nh.advertise<TTTBrainState>("/baxter_tictactoe/ttt_brain_state", 1);
+    anomaly_pub    = nh.advertise<std_msgs::String>("/baxter_tictactoe/dump_frames", 1);
+    action_pub     = nh.advertise<std_msgs::String>("/baxter_tictactoe/robot_action", 10);
 
     brainstate_timer = nh.createTimer(ros::Duration(0.1), &tictactoeBrain::publishTTTBrainState, this, false);
 
@@ -32,6 +37,117 @@ tictactoeBrain::tictactoeBrain(std::string _name, std::string _strategy, bool _l
 
     nh.param<int>("num_games", num_games, NUM_GAMES);
 
+    // Matches are played back to back, and an opponent that leaves in the middle of one ends it
+    nh.param<int>   ("num_matches", num_matches,     0);
+    nh.param<double>("match_pause", match_pause,   5.0);
+    nh.param<double>("idle_time",     idle_time, 120.0);
+    ROS_INFO_COND(print_level>=1, "Number of matches: %i; Pause between matches: %g s; Idle time: %g s",
+                                   num_matches, match_pause, idle_time);
+    nh.param<double>("anomaly_time", anomaly_time, 10.0);
+
+    // Error rates of the move acceptance, and hit and false alarm rates of the sensor readings
+    nh.param<double>("move_false_accept", move_false_accept, 0.001);
+    nh.param<double>("move_false_reject", move_false_reject,  0.01);
+    nh.param<double>("sensor_hit_rate",   sensor_hit_rate,     0.9);
+    nh.param<double>("sensor_false_rate", sensor_false_rate,   0.1);
+    nh.param<double>("move_min_time",     move_min_time,       1.0);
+
+    // Readings needed to complain about an illegal move, and to tell a removed token from an occlusion
+    nh.param<int>("illegal_move_frames", illegal_move_frames,  3);
+    nh.param<int>("occlusion_frames",       occlusion_frames, 10);
+
+    // The planner of the strategies assumes this skill of the opponent until it is estimated
+    nh.param<double>("opponent_skill",   opponent_skill,  0.5);
+    planner_skill = opponent_skill;
+    cheat_planner.setSkill(planner_skill);
+
+    // The skill of the opponent is then estimated from its moves, starting from opponent_skill
+    // (worth two moves). The estimate tunes the difficulty of the non cheating games.
+    double model_decay;
+    nh.param<double>("opponent_model_decay", model_decay, 1.0);
+    nh.param<bool>("adaptive_difficulty", adaptive_difficulty, true);
+    opp_model = OpponentModel(2.0 * opponent_skill, 2.0 * (1.0 - opponent_skill), model_decay);
+
+    // The strategies of the plug-ins are registered together with the built-in ones, and
+    // all of them are created upfront, so that any of them can be chosen by name
+    vector<string> plugins;
+    nh.getParam("strategy_plugins", plugins);
+
+    for (size_t i = 0; i < plugins.size(); ++i)
+    {
+        if (registry.loadPlugin(plugins[i]))
+        {
+            ROS_INFO_COND(print_level>=1, "Loaded strategy plug-in %s", plugins[i].c_str());
+        }
+    }
+
+    vector<string> names = registry.getNames();
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        std::unique_ptr<Strategy> st = registry.create(names[i]);
+
+        if (st && st->configure(readStrategyConfig(names[i])))
+        {
+            strategies[names[i]] = std::move(st);
+        }
+        else
+        {
+            ROS_ERROR("Strategy %s cannot be configured.", names[i].c_str());
+        }
+    }
+
+    // The strategy of the non cheating games is the adaptive one, unless the difficulty is fixed
+    // (then it is _strategy, if not set on the parameter server)
+    nh.param<double>("decision_time",      decision_time, 1.0);
+    nh.param<string>("strategy",           game_strategy, adaptive_difficulty ? "adaptive" : _strategy);
+    nh.param<string>("cheating_strategy", cheat_strategy, "cheating");
+    ROS_INFO_COND(print_level>=1, "Strategies: %s (%s in cheating games)",
+                                   game_strategy.c_str(), cheat_strategy.c_str());
+    setStrategy(game_strategy);
+
+    // The strongest moves are looked up in a book generated offline by ttt_book (empty to disable)
+    string book_file;
+    nh.param<string>("book_file", book_file, "");
+
+    if (not book_file.empty())
+    {
+        if (book.open(book_file) && book.getN() == 3 && book.getK() == 3)
+        {
+            ROS_INFO_COND(print_level>=1, "Using move book %s (%lu positions)",
+                                          book_file.c_str(), book.getNumEntries());
+        }
+        else
+        {
+            ROS_WARN("%s is not a tic tac toe move book", book_file.c_str());
+            book.close();
+        }
+    }
+
+    // Statistics are appended to the tables in this directory, across sessions (empty to disable)
+    string stats_dir;
+    nh.param<string>("stats_dir", stats_dir, "");
+
+    if (not stats_dir.empty())
+    {
+        vector<string> games_cols = {"match", "game", "outcome", "cheating", "cheated",
+                                     "moves", "duration", "glitches", "illegal"};
+        vector<string> moves_cols = {"match", "game", "player", "cell", "think_time",
+                                     "action_time", "glitches", "illegal"};
+
+        if (games_stats.open(stats_dir, "games", games_cols) &&
+            moves_stats.open(stats_dir, "moves", moves_cols))
+        {
+            ROS_INFO_COND(print_level>=1, "Recording statistics in %s (%lu games so far)",
+                                          stats_dir.c_str(), games_stats.getNumRows());
+        }
+        else
+        {
+            ROS_WARN("Statistics cannot be recorded in %s", stats_dir.c_str());
+            games_stats.close();
+            moves_stats.close();
+        }
+    }
+
     if (nh.hasParam("cheating_games"))
     {
         nh.getParam("cheating_games", cheating_games);
@@ -68,7 +184,7 @@ void tictactoeBrain::InternalThreadEntry()
     {
         if      (getBrainState() == TTTBrainState::INIT)
         {
-            left_ttt_ctrl.startAction(ACTION_SCAN);
+            robotAction(ACTION_SCAN);
             setBrainState(TTTBrainState::CALIB);
         }
         else if (getBrainState() == TTTBrainState::CALIB)
@@ -77,13 +193,22 @@ void tictactoeBrain::InternalThreadEntry()
         }
         else if (getBrainState() == TTTBrainState::READY)
         {
-            if (is_board_detected)        { setBrainState(TTTBrainState::MATCH_STARTED); }
+            // After a match, the next one starts when the board has been cleaned: there is no other
+            // way to tell that a new opponent has come, and the last board is never empty
+            if (is_board_detected && (curr_match == 0 ||
+                ((ros::Time::now() - match_end_time).toSec() > match_pause && getCurrBoard().isEmpty())))
+            {
+                setBrainState(TTTBrainState::MATCH_STARTED);
+            }
         }
         else if (getBrainState() == TTTBrainState::MATCH_STARTED)
         {
+            ++curr_match;
+            ROS_INFO("MATCH #%i", curr_match);
             saySentence("Welcome! Let's play Tic Tac Toe.", 3.5);
             saySentence("Do not grasp your token before I say that it is your turn", 4);
             curr_game = 1;
+            match_abandoned = false;
             setBrainState(TTTBrainState::GAME_STARTED);
         }
         else if (getBrainState() == TTTBrainState::GAME_STARTED)
@@ -103,16 +228,37 @@ void tictactoeBrain::InternalThreadEntry()
         {
             ROS_INFO("GAME #%i", curr_game);
 
-            playOneGame();
+            match_abandoned = not playOneGame();
 
-            if (curr_game > num_games) { setBrainState(baxter_tictactoe::TTTBrainState::MATCH_FINISHED); }
-            else                       { setBrainState(baxter_tictactoe::TTTBrainState::GAME_STARTED);   }
+            if (curr_game > num_games || match_abandoned)
+            {
+                setBrainState(baxter_tictactoe::TTTBrainState::MATCH_FINISHED);
+            }
+            else
+            {
+                setBrainState(baxter_tictactoe::TTTBrainState::GAME_STARTED);
+            }
         }
         else if (getBrainState() == TTTBrainState::MATCH_FINISHED)
         {
-            saySentence("Game over. It was my pleasure to win over you. Thanks for being so human.", 10);
-            ROS_INFO("Baxter Wins: %i\tHuman Wins: %i\tTies: %i", wins[0], wins[1], wins[2]);
-            break;
+            ROS_INFO("Baxter Wins: %i\tHuman Wins: %i\tTies: %i%s", wins[0], wins[1], wins[2],
+                                             match_abandoned?"\t(abandoned)":"");
+
+            // The next match is prepared while the farewell is being said
+            string farewell = match_abandoned ? "It seems you have left. See you next time." :
+                              "Game over. It was my pleasure to win over you. Thanks for being so human.";
+            ros::Time farewell_end = ros::Time::now() + ros::Duration(match_abandoned?3.0:10.0);
+
+            saySentence(farewell, 0.0);
+            prewarmNextMatch();
+
+            if (ros::Time::now() < farewell_end) { (farewell_end - ros::Time::now()).sleep(); }
+
+            match_end_time = ros::Time::now();
+
+            if (num_matches > 0 && curr_match >= num_matches) { break; }
+
+            setBrainState(TTTBrainState::READY);
         }
 
         r.sleep();
@@ -131,12 +277,13 @@ void tictactoeBrain::setIsClosing(bool _arg)
     is_closing = _arg;
 }
 
-void tictactoeBrain::playOneGame()
+bool tictactoeBrain::playOneGame()
 {
     bool robot_turn = true;
     int winner  = WIN_NONE;
 
     bool has_to_cheat=false;
+    has_cheated = false;            // the cheats are counted per game
 
     for (size_t j = 0; j < cheating_games.size(); ++j)
     {
@@ -146,13 +293,17 @@ void tictactoeBrain::playOneGame()
         }
     }
 
-    if (has_to_cheat)   { setStrategy("cheating"); }
-    else                { setStrategy(   "smart"); }
+    setStrategy(has_to_cheat ? cheat_strategy : game_strategy);
 
     saySentence("I start the game.",2);
 
     n_robot_tokens=0;
     n_human_tokens=0;
+    last_opp_cell =-1;
+
+    ros::Time game_start = ros::Time::now();
+    game_glitches = game_illegal = game_moves = 0;
+    n_glitches    = n_illegal    = 0;
 
     while (winner == WIN_NONE && not internal_board.isFull() && not ros::isShuttingDown())
     {
@@ -160,17 +311,34 @@ void tictactoeBrain::playOneGame()
         {
             if (n_robot_tokens != 0) { saySentence("It is my turn", 0.3); }
 
+            ros::Time decision_start = ros::Time::now();
             int cell_toMove = getNextMove();    // This should be from 1 to 9
+            double think_time = (ros::Time::now() - decision_start).toSec();
             ROS_INFO_COND(print_level>=2, "Moving to cell %i", cell_toMove);
 
-            left_ttt_ctrl.startAction(ACTION_PICKUP);
-            left_ttt_ctrl.startAction(ACTION_PUTDOWN, cell_toMove);
+            ros::Time action_start = ros::Time::now();
+            robotAction(ACTION_PICKUP);
+            robotAction(ACTION_PUTDOWN, cell_toMove);
             internal_board.setCellState(cell_toMove-1, getRobotColor());
             n_robot_tokens = internal_board.getNumTokens(getRobotColor());
+            n_human_tokens = internal_board.getNumTokens(getOpponentColor()); // less if cheated
+
+            recordMove(WIN_ROBOT, cell_toMove, think_time, (ros::Time::now() - action_start).toSec());
         }
         else // Participant's turn
         {
-            waitForOpponentTurn();
+            ros::Time think_start = ros::Time::now();
+
+            if (not waitForOpponentTurn())
+            {
+                ROS_WARN("The opponent has left. Game #%i is abandoned.", curr_game);
+                recordGame(WIN_NONE, has_to_cheat, (ros::Time::now() - game_start).toSec());
+                internal_board.resetCellStates();
+                return false;
+            }
+
+            recordMove(WIN_OPP, last_opp_cell == -1 ? -1 : last_opp_cell + 1,
+                       (ros::Time::now() - think_start).toSec(), 0.0);
         }
 
         robot_turn = not robot_turn;
@@ -202,6 +370,8 @@ void tictactoeBrain::playOneGame()
     // Let's increment the winners' count
     wins[winner-1] = wins[winner-1] + 1;
 
+    recordGame(winner, has_to_cheat, (ros::Time::now() - game_start).toSec());
+
     if (has_to_cheat && not has_cheated)
     {
         ROS_WARN("Cheating game ended without cheating. Game counter does not increase.");
@@ -211,17 +381,96 @@ void tictactoeBrain::playOneGame()
     ++curr_game;
     internal_board.resetCellStates();
 
-    return;
+    return true;
 }
 
-Board tictactoeBrain::getCurrBoard()
+void tictactoeBrain::recordMove(int _player, int _cell, double _think_time, double _action_time)
 {
-    Board res;
+    ++game_moves;
+    game_glitches += n_glitches;
+    game_illegal  += n_illegal;
 
-    std::lock_guard<std::mutex> lck(mutex_curr_board);
-    res = curr_board;
+    if (moves_stats.isOpen())
+    {
+        vector<double> row = {double(curr_match), double(curr_game), double(_player), double(_cell),
+                              _think_time, _action_time, double(n_glitches), double(n_illegal)};
+
+        if (not moves_stats.append(ros::Time::now().toNSec(), row))
+        {
+            ROS_WARN("The statistics of the move could not be recorded");
+        }
+    }
 
-    return res;
+    n_glitches = 0;
+    n_illegal  = 0;
+}
+
+void tictactoeBrain::recordGame(int _winner, bool _cheating, double _duration)
+{
+    if (not games_stats.isOpen()) { return; }
+
+    vector<double> row = {double(curr_match), double(curr_game), double(_winner),
+                          double(_cheating), double(_cheating && has_cheated), double(game_moves),
+                          _duration, double(game_glitches + n_glitches), double(game_illegal + n_illegal)};
+
+    if (not games_stats.append(ros::Time::now().toNSec(), row))
+    {
+        ROS_WARN("The statistics of the game could not be recorded");
+    }
+}
+
+void tictactoeBrain::resetMatch()
+{
+    wins.assign(3, 0);
+    curr_game      = 0;
+    n_robot_tokens = 0;
+    n_human_tokens = 0;
+    has_cheated    = false;
+    last_opp_cell  = -1;
+    internal_board.resetCellStates();
+
+    // A new match is likely a new opponent
+    opp_model.reset();
+    planner_skill = opponent_skill;
+}
+
+void tictactoeBrain::updateOpponentModel(const BitBoard &_before)
+{
+    opp_model.update(_before, last_opp_cell);
+
+    // The planner recomputes its values when the skill changes, so only coarse changes are passed
+    // (at the next move: a strategy that overran may still be using the planner)
+    planner_skill = round(opp_model.getSkill() * 10.0) / 10.0;
+
+    ROS_INFO_COND(print_level>=2, "Opponent model: skill %.2f (win rate %.2f, block rate %.2f, "
+                                  "%g chances in %lu moves)", opp_model.getSkill(), opp_model.getWinRate(),
+                                  opp_model.getBlockRate(), opp_model.getNumChances(), opp_model.getNumMoves());
+}
+
+void tictactoeBrain::prewarmNextMatch()
+{
+    // The arm is brought home (and out of the way of the next opponent). This blocks,
+    // but it does not delay the next match since the farewell is being said meanwhile.
+    if (not robotAction(ACTION_HOME))
+    {
+        ROS_WARN("The arm could not go home after match #%i", curr_match);
+    }
+
+    resetMatch();
+
+    // The pile of tokens is not observed by any sensor, so there is nothing to verify
+    // there; the board instead is, and the next match waits for it to be cleaned.
+    if (not getCurrBoard().isEmpty())
+    {
+        ROS_INFO_COND(print_level>=1, "Waiting for the board to be cleaned to start match #%i",
+                                       curr_match + 1);
+    }
+}
+
+Board tictactoeBrain::getCurrBoard()
+{
+    std::lock_guard<std::mutex> lck(mutex_curr_board);
+    return curr_board;
 }
 
 void tictactoeBrain::publishTTTBrainState(const ros::TimerEvent&)
@@ -260,124 +509,95 @@ void tictactoeBrain::boardStateCb(const baxter_tictactoe::MsgBoard &_msg)
     std::lock_guard<std::mutex> lck(mutex_curr_board);
     curr_board.fromMsgBoard(_msg);
     is_board_detected = true;
+    ++curr_board_seq;
 }
 
-int tictactoeBrain::randomStrategyMove()
+StrategyConfig tictactoeBrain::readStrategyConfig(const std::string &_name)
 {
-    int rnd;
-    Board aux = internal_board;
-    do {
-        rnd = rand() % NUMBER_OF_CELLS + 1; //random number between 1 and NUMBER_OF_CELLS
-        ROS_DEBUG("Cell %d is in state %s ==? %s", rnd, aux.getCellState(rnd-1).c_str(),
-                  MsgCell::EMPTY.c_str());
-    }
-    while(aux.getCellState(rnd-1)!=COL_EMPTY);
+    // Cheats are chosen by expected score (1 win, 0.5 tie, 0 loss) and then by noticeability
+    double cheat_min_value, cheat_tolerance;
+    nh.param<double>("cheat_min_value", cheat_min_value,  0.9);
+    nh.param<double>("cheat_tolerance", cheat_tolerance, 0.05);
 
-    ROS_WARN("Random move to cell # %i", rnd);
-    return rnd;
-}
+    StrategyConfig config;
+    config["cheat_min_value"] = std::to_string(cheat_min_value);
+    config["cheat_tolerance"] = std::to_string(cheat_tolerance);
 
-int tictactoeBrain::cheatingStrategyMove()
-{
-    int next_cell_id=-1;
-    if (  victoryMove(next_cell_id))    { return next_cell_id; }
-    if ( cheatingMove(next_cell_id))    { return next_cell_id; }
-    if (defensiveMove(next_cell_id))    { return next_cell_id; }
-    return randomStrategyMove();
-}
+    XmlRpc::XmlRpcValue params;
+    if (not nh.getParam("strategy_config/" + _name, params)) { return config; }
 
-int tictactoeBrain::smartStrategyMove()
-{
-    int next_cell_id=-1;
-    if (  victoryMove(next_cell_id))    { return next_cell_id; }
-    if (defensiveMove(next_cell_id))    { return next_cell_id; }
-    return randomStrategyMove();
-}
-
-bool tictactoeBrain::cheatingMove(int &_id)
-{
-    _id = -1;
-    Board aux = internal_board;
-    string cell_state = COL_EMPTY;
+    if (params.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+    {
+        ROS_WARN("strategy_config/%s is not a dictionary", _name.c_str());
+        return config;
+    }
 
-    for (size_t i = 0; i < aux.getNumCells(); ++i)
+    for (XmlRpc::XmlRpcValue::iterator it = params.begin(); it != params.end(); ++it)
     {
-        if (aux.getCellState(i)==getOpponentColor())
+        XmlRpc::XmlRpcValue &v = it->second;
+
+        switch (v.getType())
         {
-            cell_state=aux.getCellState(i);
-            aux.setCellState(i, getRobotColor());
-            if (aux.threeInARow(getRobotColor()))
-            {
-                ROS_WARN("Cheating move to cell # %lu", i+1);
-                has_cheated=true;
-                _id = i+1;
-                // If the robot cheats, the number of tokens expected from the humans decreases.
-                --n_human_tokens;
-                return true;
-            }
-            aux.setCellState(i, cell_state);
+            case XmlRpc::XmlRpcValue::TypeString:
+                config[it->first] = static_cast<string>(v);                 break;
+            case XmlRpc::XmlRpcValue::TypeDouble:
+                config[it->first] = std::to_string(static_cast<double>(v)); break;
+            case XmlRpc::XmlRpcValue::TypeInt:
+                config[it->first] = std::to_string(static_cast<int>(v));    break;
+            case XmlRpc::XmlRpcValue::TypeBoolean:
+                config[it->first] = static_cast<bool>(v) ? "1" : "0";       break;
+            default:
+                ROS_WARN("strategy_config/%s/%s is not a number or a string",
+                         _name.c_str(), it->first.c_str());
         }
     }
 
-    // ROS_WARN("Cheating move not successful!");
-    return false;
+    return config;
 }
 
-bool tictactoeBrain::defensiveMove(int &_id)
+int tictactoeBrain::getNextMove()
 {
-    _id = -1;
-    Board aux = internal_board;
-    string cell_state = COL_EMPTY;
-
-    for (size_t i = 0; i < aux.getNumCells(); ++i)
+    if (strategy == NULL)
     {
-        if (aux.getCellState(i)==COL_EMPTY)
-        {
-            cell_state = aux.getCellState(i);
-            aux.setCellState(i, getOpponentColor());
-            if (aux.threeInARow(getOpponentColor()))
-            {
-                ROS_WARN("Defensive move to cell # %lu", i+1);
-                _id = i+1;
-                return true;
-            }
-            aux.setCellState(i, cell_state);
-        }
+        ROS_ERROR("No strategy to choose the next move!");
+        return -1;
     }
 
-    // ROS_INFO("DefensiveMove not successful!");
-    return false;
-}
-
-bool tictactoeBrain::victoryMove(int &_id)
-{
-    _id = -1;
-    Board aux = internal_board;
-    string cell_state = COL_EMPTY;
+    StrategyContext ctx;
+    ctx.board       = &internal_board;
+    ctx.robot_col   = getRobotColor();
+    ctx.opp_col     = getOpponentColor();
+    ctx.last_opp    = last_opp_cell;
+    ctx.opp_skill   = opp_model.getSkill();
+    ctx.time_budget = decision_time;
+    ctx.planner     = &cheat_planner;
+    ctx.book        = &book;
+    ctx.rng         = &rng;
+
+    // The planner is not changed under a strategy that is still running (the runner then
+    // plays a fallback move, without the planner), and is updated at a later move instead
+    if (not runner.isBusy()) { cheat_planner.setSkill(planner_skill); }
+
+    // A strategy that overruns is not waited for: its best move so far, or a fallback one, is played
+    unsigned long overruns = runner.getNumOverruns();
+    StrategyMove m = runner.run(*strategy, ctx);
+
+    if (runner.getNumOverruns() > overruns)
+    {
+        ROS_WARN("The %s strategy has not decided in %g s (%lu overruns so far)",
+                 strategy->getName().c_str(), decision_time, runner.getNumOverruns());
+    }
 
-    for (size_t i = 0; i < aux.getNumCells(); ++i)
+    if (m.cell == -1)
     {
-        if (aux.getCellState(i)==COL_EMPTY)
-        {
-            cell_state = aux.getCellState(i);
-            aux.setCellState(i, getRobotColor());
-            if (aux.threeInARow(getRobotColor()))
-            {
-                ROS_WARN("Victory move to cell # %lu", i+1);
-                _id = i+1;
-                return true;
-            }
-            aux.setCellState(i, cell_state);
-        }
+        ROS_ERROR("No legal moves left for the %s strategy!", strategy->getName().c_str());
+        return -1;
     }
 
-    // ROS_INFO("VictoryMove not successful!");
-    return false;
-}
+    if (m.cheat) { has_cheated = true; }
 
-int tictactoeBrain::getNextMove()
-{
-    return (this->*choose_next_move)();
+    ROS_WARN("%s move to cell # %i", m.reason.c_str(), m.cell+1);
+    return m.cell+1;
 }
 
 unsigned short int tictactoeBrain::getWinner()
@@ -388,7 +608,7 @@ unsigned short int tictactoeBrain::getWinner()
     return WIN_NONE;
 }
 
-void tictactoeBrain::waitForOpponentTurn()
+bool tictactoeBrain::waitForOpponentTurn()
 {
     ROS_INFO_COND(print_level>=1, "Waiting for the participant's move. "
                                   "I am expecting %lu token%s from myself "
@@ -396,19 +616,87 @@ void tictactoeBrain::waitForOpponentTurn()
                                    n_robot_tokens, n_robot_tokens==1?"":"s",
                                    n_human_tokens+1, n_human_tokens+1==1?"":"s");
 
-    int cnt = 0;
+    // The move is accepted by a sequential test over the fresh sensor readings
+    MoveAcceptor acceptor(move_false_accept, move_false_reject, sensor_hit_rate, sensor_false_rate,
+                          move_min_time);
+    unsigned long board_seq = 0;
+    getNewBoard(internal_board, board_seq, false);
+
+    // Every reading is also classified, to react to illegal moves instead of waiting forever
+    TransitionAnalyzer analyzer(illegal_move_frames, occlusion_frames);
+    analyzer.setReference(internal_board, getOpponentColor());
+    Transition event;
+
     bool say_it_is_your_turn = true;
 
+    // The board seen by the sensor should either be equal to the internal one, or
+    // have one more opponent's token. If it is neither for a long time, something
+    // is wrong (e.g. a misdetection, or a token in the wrong cell).
+    ros::Time consistent_time = ros::Time::now();
+    bool     anomaly_flagged  = false;
+
+    // If nothing happens on the board for long enough, the opponent has left
+    ros::Time activity_time = ros::Time::now();
+    Board     last_board(internal_board);
+    bool      reminded = false;
+
+    // Declared out of the loop so that every new reading reuses its cells
+    Board new_board;
+
     // We wait until the number of opponent's tokens equals the robots'
     while(ros::ok())
     {
-        Board new_board = getCurrBoard();
+        sayQueued();
 
-        if (internal_board.isOneTokenAdded(new_board, getOpponentColor()))
+        // the same reading is never counted twice
+        if (not getNewBoard(new_board, board_seq))
         {
-            ++cnt;
+            r.sleep();
+            continue;
         }
-        else
+
+        if (new_board != last_board)
+        {
+            activity_time = ros::Time::now();
+            last_board    = new_board;
+            reminded      = false;
+        }
+        else if (idle_time > 0.0)
+        {
+            double idle = (ros::Time::now() - activity_time).toSec();
+
+            if      (idle > idle_time)                       { return false; }
+            else if (idle > idle_time / 2 && not reminded)
+            {
+                sayAsync("Are you still there? It is your turn.", 2);
+                reminded = true;
+            }
+        }
+
+        if (analyzer.update(new_board, event)) { reactToTransition(event); }
+
+        bool move_seen = internal_board.isOneTokenAdded(new_board, getOpponentColor());
+
+        int test = acceptor.update(move_seen, new_board, ros::Time::now().toSec());
+
+        // a rejected move is a reading that showed a move for a short time
+        if (test == SPRT_REJECT) { ++n_glitches; }
+
+        if (test == SPRT_ACCEPT)
+        {
+            ROS_INFO_COND(print_level>=2, "Move accepted after %lu readings",
+                                          acceptor.getNumReadings());
+
+            Transition move = classifyTransition(internal_board, acceptor.getCandidate(), getOpponentColor());
+            last_opp_cell   = move.added.empty() ? -1 : int(move.added[0]);
+            updateOpponentModel(makeBitBoard(internal_board, getRobotColor(), getOpponentColor()));
+
+            internal_board = acceptor.getCandidate();
+            n_human_tokens = internal_board.getNumTokens(getOpponentColor());
+            return true;
+        }
+
+        if (not move_seen)
         {
             if (say_it_is_your_turn == true)
             {
@@ -416,48 +704,130 @@ void tictactoeBrain::waitForOpponentTurn()
                 say_it_is_your_turn = false;
             }
 
-            cnt = 0;
+            if (new_board == internal_board)
+            {
+                consistent_time = ros::Time::now();
+            }
+            else if (not anomaly_flagged &&
+                     (ros::Time::now() - consistent_time).toSec() > anomaly_time)
+            {
+                flagAnomaly("inconsistent_board");
+                anomaly_flagged = true;
+            }
         }
 
-        if (cnt == 100)
-        {
-            internal_board = new_board;
-            n_human_tokens = internal_board.getNumTokens(getOpponentColor());
-            return;
-        } // 100 means 1 second
-
         r.sleep();
     }
+
+    return false;
+}
+
+void tictactoeBrain::reactToTransition(const Transition &_event)
+{
+    ROS_INFO_COND(print_level>=2, "Board transition [%i] after %lu readings: "
+                                  "%lu added, %lu removed, %lu changed", _event.type, _event.frames,
+                                  _event.added.size(), _event.removed.size(), _event.changed.size());
+
+    if      (_event.type == TRANS_OCCLUSION)                          { ++n_glitches; }
+    else if (_event.type != TRANS_NONE && _event.type != TRANS_ADD)   { ++n_illegal;  }
+
+    // The board keeps being read while the robot complains
+    switch (_event.type)
+    {
+        case TRANS_ADD_WRONG:
+            sayAsync("That token is mine. Please play with your own tokens.", 3);
+            break;
+        case TRANS_MULTI_ADD:
+            sayAsync("Only one token per turn, please. Take back the extra ones.", 3.5);
+            break;
+        case TRANS_REMOVE:
+            sayAsync("Please put back the tokens you removed from the board.", 3);
+            break;
+        case TRANS_SWAP:
+            sayAsync("Please do not move the tokens that are already on the board.", 3.5);
+            break;
+        case TRANS_NONE:
+            // Only emitted once an illegal move has been undone
+            sayAsync("Thank you. It is still your turn.", 2);
+            break;
+        default:
+            // Legal moves are accepted separately, and occlusions are expected while playing
+            break;
+    }
+}
+
+bool tictactoeBrain::getNewBoard(Board &_board, unsigned long &_seq, bool _copy)
+{
+    std::lock_guard<std::mutex> lck(mutex_curr_board);
+
+    if (curr_board_seq == _seq) { return false; }
+
+    if (_copy) { _board = curr_board; }
+    _seq = curr_board_seq;
+
+    return true;
+}
+
+bool tictactoeBrain::robotAction(const std::string &_action, int _obj)
+{
+    std_msgs::String msg;
+    msg.data = _obj == -1 ? _action : _action + " " + toString(_obj);
+    action_pub.publish(msg);
+
+    return left_ttt_ctrl.startAction(_action, _obj);
+}
+
+void tictactoeBrain::flagAnomaly(const std::string &_reason)
+{
+    ROS_WARN("Anomaly detected: %s. Internal board: %s", _reason.c_str(),
+                                                  internal_board.toString().c_str());
+    std_msgs::String msg;
+    msg.data = _reason;
+    anomaly_pub.publish(msg);
+
+    ++n_glitches;
 }
 
 void tictactoeBrain::saySentence(std::string _sentence, double _t)
 {
+    // A sentence said with sayAsync is not talked over
+    queued_sentence.clear();
+    if (speech_end > ros::Time::now()) { (speech_end - ros::Time::now()).sleep(); }
+
     ROS_INFO_COND(print_level>=2, "saySentence: %s", _sentence.c_str());
     voice_synthesizer.say(_sentence, voice_type);
     ros::Duration(_t).sleep();
 }
 
+void tictactoeBrain::sayAsync(const std::string &_sentence, double _t)
+{
+    queued_sentence = _sentence;
+    queued_time     = _t;
+    sayQueued();
+}
+
+void tictactoeBrain::sayQueued()
+{
+    if (queued_sentence.empty() || ros::Time::now() < speech_end) { return; }
+
+    ROS_INFO_COND(print_level>=2, "sayAsync: %s", queued_sentence.c_str());
+    voice_synthesizer.say(queued_sentence, voice_type);
+    speech_end = ros::Time::now() + ros::Duration(queued_time);
+    queued_sentence.clear();
+}
+
 void tictactoeBrain::setStrategy(std::string _strategy)
 {
-    if (_strategy=="random")
-    {
-        choose_next_move=&tictactoeBrain::randomStrategyMove;
-        ROS_INFO("[strategy] Randomly place tokens");
-    }
-    else if (_strategy=="smart")
-    {
-        choose_next_move=&tictactoeBrain::smartStrategyMove;
-        ROS_INFO("[strategy] Try to win without cheating");
-    }
-    else if (_strategy=="cheating")
-    {
-        choose_next_move=&tictactoeBrain::cheatingStrategyMove;
-        ROS_INFO("[strategy] Try to win by cheating");
-    }
-    else
+    std::map<std::string, std::unique_ptr<Strategy>>::iterator it = strategies.find(_strategy);
+
+    if (it == strategies.end())
     {
         ROS_ERROR("%s is not an available strategy.", _strategy.c_str());
+        return;
     }
+
+    strategy = it->second.get();
+    ROS_INFO("[strategy] %s", strategy->getDescription().c_str());
 }
 
 tictactoeBrain::~tictactoeBrain()
@@ -469,5 +839,23 @@ tictactoeBrain::~tictactoeBrain()
         brain_thread.join();
     }
 
+    runner.wait();
+
+    ROS_INFO_COND(print_level>=1 && runner.getNumMoves() > 0, "Decision times: %s; %lu overruns "
+                                  "(%lu anytime moves), %lu fallback moves", runner.getLatency().toString().c_str(),
+                                  runner.getNumOverruns(), runner.getNumAnytime(), runner.getNumFallbacks());
+
+    for (std::map<std::string, std::unique_ptr<Strategy>>::const_iterator it = strategies.begin();
+                                                                           it != strategies.end(); ++it)
+    {
+        const StrategyStats &st = it->second->getStats();
+        if (st.moves == 0) { continue; }
+
+        ROS_INFO_COND(print_level>=1, "[strategy] %s: %lu moves (%lu cheats, %lu failures), "
+                                      "%.3f ms on average, %.3f ms at most", it->first.c_str(),
+                                      st.moves, st.cheats, st.failures,
+                                      1e3 * st.total_time / st.moves, 1e3 * st.max_time);
+    }
+
     brainstate_timer.stop();
 }
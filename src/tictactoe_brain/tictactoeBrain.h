@@ -1,12 +1,22 @@
 #include <ros/ros.h>
 #include <sound_play/sound_play.h>
+#include <std_msgs/String.h>
 
 #include <baxter_tictactoe/MsgBoard.h>
 #include <baxter_tictactoe/TTTBrainState.h>
 
 #include "baxter_tictactoe/ttt_controller.h"
 #include "baxter_tictactoe/tictactoe_utils.h"
-
+#include "baxter_tictactoe/board_analysis.h"
+#include "baxter_tictactoe/stats_store.h"
+#include "baxter_tictactoe/cheating_planner.h"
+#include "baxter_tictactoe/opponent_model.h"
+#include "baxter_tictactoe/game_solver.h"
+#include "baxter_tictactoe/move_book.h"
+#include "baxter_tictactoe/strategy.h"
+
+#include <map>
+#include <random>
 #include <thread>
 #include <mutex>
 
@@ -37,6 +47,13 @@ private:
     int    num_games;
     int    curr_game;
 
+    int         num_matches; // number of matches to play before stopping (0 for no limit)
+    int          curr_match; // number of matches started so far
+    bool    match_abandoned; // if the current match has been abandoned by the opponent
+    double      match_pause; // minimum time [s] between the end of a match and the start of the next one
+    ros::Time match_end_time; // time the last match ended at
+    double        idle_time; // time [s] without activity on the board after which the opponent has left (0 to disable)
+
     std::vector<int> cheating_games; // vector that stores which of the games will be a cheating one.
     std::vector<int>           wins; // vector of three elements to count the wins
                                      // (wins[0]->robot, wins[1]->opponent, wins[2]->ties)
@@ -48,6 +65,16 @@ private:
     ros::Subscriber   boardState_sub; // subscriber to receive the state of the board
     std::mutex      mutex_curr_board;
     bool           is_board_detected;
+    unsigned long     curr_board_seq; // number of boards received from the sensor
+
+    double     move_false_accept; // probability of accepting an opponent's move that has not happened
+    double     move_false_reject; // probability of rejecting an opponent's move that has happened
+    double       sensor_hit_rate; // probability that a reading shows a move that has happened
+    double     sensor_false_rate; // probability that a reading shows a move that has not happened
+    double         move_min_time; // minimum time [s] a move has to be seen for before being accepted
+
+    int      illegal_move_frames; // readings needed to complain about an illegal move
+    int         occlusion_frames; // readings needed to tell a removed token from an occlusion
 
     /* STATE OF THE TTT DEMO */
     baxter_tictactoe::TTTBrainState    s; // state of the system
@@ -56,21 +83,54 @@ private:
     ros::Publisher  tttBrain_pub; // publisher to publish state of the system
     std::mutex       mutex_brain; // mutex to protect the state of the system
 
+    ros::Publisher   anomaly_pub; // publisher to request a frame dump to the board state sensor
+    ros::Publisher    action_pub; // publisher of the actions requested to the robot (for recording)
+    double          anomaly_time; // time [s] after which an inconsistent board is an anomaly
+
+    /* STATISTICS */
+    StatsWriter   games_stats; // per-game statistics, persistent across sessions
+    StatsWriter   moves_stats; // per-move statistics, persistent across sessions
+    int            n_glitches; // sensor glitches since the last move
+    int             n_illegal; // illegal moves since the last move
+    int         game_glitches; // sensor glitches in the current game
+    int          game_illegal; // illegal moves in the current game
+    int            game_moves; // moves in the current game
+
     /* MISC */
     std::string    robot_color;  // Color of the tokens the robot    is playing with.
     std::string opponent_color;  // Color of the tokens the opponent is playing with.
 
     sound_play::SoundClient voice_synthesizer;
     std::string                    voice_type; // Type of voice.
-
-    // Pointer to the function that chooses the next move
-    int (tictactoeBrain::*choose_next_move)();
+    ros::Time                      speech_end; // time the sentence being said ends
+    std::string               queued_sentence; // sentence to say when the current one ends (see sayAsync)
+    double                        queued_time; // duration [s] of the queued sentence
+
+    /* STRATEGIES */
+    StrategyRegistry                                   registry; // built-in strategies, and those of the plug-ins
+    std::map<std::string, std::unique_ptr<Strategy>> strategies; // the registered strategies, configured
+    Strategy                                          *strategy; // strategy that chooses the next move
+    std::string                                   game_strategy; // strategy of the non cheating games
+    std::string                                  cheat_strategy; // strategy of the cheating games
+    double                                        decision_time; // time [s] a strategy has to choose a move
+    std::mt19937                                            rng; // random number generator of the strategies
+    StrategyRunner                                       runner; // runs the strategies within decision_time
 
     TTTController  left_ttt_ctrl;
     TTTController right_ttt_ctrl;
 
     bool has_cheated;
 
+    CheatingPlanner cheat_planner; // planner of the cheats, on bitboards
+    double         opponent_skill; // probability that the opponent plays an optimal move
+    double          planner_skill; // skill for the planner, passed to it when no strategy is running
+    int             last_opp_cell; // cell of the last move of the opponent (from 0 to 8, -1 if none)
+
+    OpponentModel       opp_model; // online estimate of the skill of the opponent
+    bool      adaptive_difficulty; // if the difficulty of the non cheating games adapts to the opponent
+
+    MoveBook                 book; // opening book and endgame tablebase, mapped read-only (if any)
+
     size_t n_robot_tokens;
     size_t n_human_tokens;
 
@@ -87,53 +147,31 @@ private:
     void boardStateCb(const baxter_tictactoe::MsgBoard &_msg);
 
     /**
-     * It determines randomly the next empty cell to place a token.
-     *
-     * @return                the cell where to place the next token
-     **/
-    int randomStrategyMove();
-
-    /**
-     * It determines the next cell to win by cheating (by placing a token on top of an opponent's token).
-     * If the robot cannot win by explicitly cheating, it will try to win without breaking the rules.
-     * Otherwise, it will try block opponent's victory. If this is not needed, it will randomly choose a cell.
-     *
-     * @return                the cell where to place the next token
-     **/
-    int cheatingStrategyMove();
-
-    /**
-     * It determines the next cell to win without cheating. If the robot cannot win, it will
-     * try to block the opponent's victory. If this is not needed, it will randomly choose a cell.
-     *
-     * @return                the cell where to place the next token
-     **/
-    int smartStrategyMove();
-
-    /*
-     * It determines if the robot can win in this turn cheating, i.e. placing a token in a cell
-     * occupied with an opponent's token.
+     * Requests an action to the left arm controller, and publishes it
+     * so that it can be recorded together with the rest of the session.
      *
-     * @param       id of the cell to move to if the action was successful (-1 if not)
-     * @return      true/false if success/failure
+     * @param _action the action (e.g. ACTION_PICKUP)
+     * @param _obj    the object (or cell) of the action, if any
+     * @return        true/false if success/failure
      */
-    bool cheatingMove(int &_id);
+    bool robotAction(const std::string &_action, int _obj = -1);
 
     /**
-     * It determines if the opponent can win in the next move.
+     * Flags an anomaly in the game. The board state sensor is asked to dump
+     * its buffer of the last frames to disk for post-mortem debugging.
      *
-     * @param       id of the cell to move to if the action was successful (-1 if not)
-     * @return      true/false if success/failure
-     **/
-    bool defensiveMove(int &_id);
+     * @param _reason a short description of the anomaly
+     */
+    void flagAnomaly(const std::string &_reason);
 
     /**
-     * It determines if the robot can win in the next move.
+     * Reads the configuration of a strategy from the parameter server (strategy_config/<name>),
+     * on top of the parameters shared by all the strategies (e.g. cheat_min_value).
      *
-     * @param       id of the cell to move to if the action was successful (-1 if not)
-     * @return      true/false if success/failure
-     **/
-    bool victoryMove(int &_id);
+     * @param  _name name of the strategy
+     * @return       the configuration
+     */
+    StrategyConfig readStrategyConfig(const std::string &_name);
 
 protected:
 
@@ -152,10 +190,9 @@ public:
     bool startThread();
 
     /**
-     * Returns the cell where the next token is gonna be placed.
-     * @param cheating It indicates if cheating happens
+     * Returns the cell where the next token is gonna be placed, as chosen by the current strategy.
      * @return The return value is between 1 (first row, first column)
-     * and NUMBER_OF_CELLS (last row, last column).
+     * and NUMBER_OF_CELLS (last row, last column), or -1 if there is no move.
      **/
     int getNextMove();
 
@@ -170,8 +207,11 @@ public:
      * This is detected considering the number of the opponent's
      * tokens on the board. The function waits until the number
      * of opponent's tokens in the board increases.
+     *
+     * @return true/false if the opponent has moved, or has left (i.e. nothing
+     *         happened on the board for idle_time seconds)
      **/
-    void waitForOpponentTurn();
+    bool waitForOpponentTurn();
 
     /**
      * This function synthesizes sentence and waits t seconds.
@@ -180,10 +220,67 @@ public:
      **/
     void saySentence(std::string _sentence, double _t);
 
+    /**
+     * Says a sentence without blocking, so that the caller can keep reading the board.
+     * If another sentence is being said, it is queued (replacing any sentence queued
+     * before), and it is said by sayQueued() as soon as the current one ends.
+     *
+     * @param _sentence the sentence to synthesize
+     * @param        _t its duration [s]
+     */
+    void sayAsync(const std::string &_sentence, double _t);
+
+    /**
+     * Says the queued sentence, if any, once the current one has ended. It does not block.
+     */
+    void sayQueued();
+
     /**
      * Plays one game
+     *
+     * @return true/false if the game has been played or abandoned by the opponent
+     */
+    bool playOneGame();
+
+    /**
+     * Records the statistics of a move (if the statistics store is enabled),
+     * together with the glitches and illegal moves that happened before it.
+     *
+     * @param _player      WIN_ROBOT or WIN_OPP
+     * @param _cell        cell of the move (from 1 to 9, -1 if unknown)
+     * @param _think_time  time [s] the player took to decide the move
+     * @param _action_time time [s] the arm took to perform the move (0 for the opponent)
+     */
+    void recordMove(int _player, int _cell, double _think_time, double _action_time);
+
+    /**
+     * Records the statistics of a game (if the statistics store is enabled).
+     *
+     * @param _winner    WIN_ROBOT, WIN_OPP, WIN_TIE, or WIN_NONE if abandoned
+     * @param _cheating  if it was a cheating game
+     * @param _duration  duration [s] of the game
+     */
+    void recordGame(int _winner, bool _cheating, double _duration);
+
+    /**
+     * Updates the opponent model with the last move of the opponent, and passes
+     * the new estimate of its skill to the cheating planner.
+     *
+     * @param _before the board before the move
+     */
+    void updateOpponentModel(const baxter_tictactoe::BitBoard &_before);
+
+    /**
+     * Resets the wins, the game counter and the internal board,
+     * so that a new match can start without restarting the node.
      */
-    void playOneGame();
+    void resetMatch();
+
+    /**
+     * Prepares the next match while the farewell of the current one is said:
+     * the arm goes back home, the match is reset, and the board is checked.
+     */
+    void prewarmNextMatch();
 
     /* GETTERS */
     std::string getRobotColor()        { return    robot_color; };
@@ -203,6 +300,25 @@ public:
      */
     baxter_tictactoe::Board  getCurrBoard();
 
+    /**
+     * Thread-safe method to retrieve the latest board published by boardstate,
+     * only if it has not been retrieved already.
+     *
+     * @param  _board the latest board (untouched if not new)
+     * @param  _seq   sequence number of the last board retrieved by the caller (updated if new)
+     * @param  _copy  if to copy the board, or only to update the sequence number
+     * @return        true/false if the board is new or not
+     */
+    bool getNewBoard(baxter_tictactoe::Board &_board, unsigned long &_seq, bool _copy = true);
+
+    /**
+     * Reacts to a transition of the board while waiting for the opponent,
+     * voicing a specific complaint if the transition is an illegal move.
+     *
+     * @param _event the transition, as emitted by the TransitionAnalyzer
+     */
+    void reactToTransition(const baxter_tictactoe::Transition &_event);
+
     /* SETTERS */
     void setStrategy(std::string _strategy);
     void setBrainState(int _state);
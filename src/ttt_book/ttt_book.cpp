@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+#include "baxter_tictactoe/game_solver.h"
+#include "baxter_tictactoe/move_book.h"
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+int main(int argc, char** argv)
+{
+    // Usage: ttt_book <file> [--n 3] [--k 3] [--plies d] [--endgame e] [--threads t] [--table b]
+    // Solves all the positions reachable within d plies from the empty board (the opening
+    // book), and adds every position with at most e empty cells whose exact score has been
+    // found along the way (the endgame tablebase). The default is a complete 3x3 book.
+    // The solver runs on t threads, and keeps up to 2^b positions in its table.
+    if (argc < 2)
+    {
+        printf("Usage: ttt_book <file> [--n 3] [--k 3] [--plies d] [--endgame e] "
+               "[--threads t] [--table b]\n");
+        return 1;
+    }
+
+    string filename(argv[1]);
+    int n = 3, k = 3, plies = 9, endgame = 0, threads = 1, table_bits = 22;
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        string arg(argv[i]);
+
+        if      (arg ==       "--n") { n          = atoi(argv[i+1]); }
+        else if (arg ==       "--k") { k          = atoi(argv[i+1]); }
+        else if (arg ==   "--plies") { plies      = atoi(argv[i+1]); }
+        else if (arg == "--endgame") { endgame    = atoi(argv[i+1]); }
+        else if (arg == "--threads") { threads    = atoi(argv[i+1]); }
+        else if (arg ==   "--table") { table_bits = atoi(argv[i+1]); }
+    }
+
+    NKGame game(n, k);
+    Solver solver(game, threads, table_bits);
+    MoveBookWriter book;
+    int num_cells = game.getNumCells();
+
+    time_t   start = time(NULL);
+    uint64_t nodes = 0;
+
+    // The positions are expanded ply by ply, each one only once
+    vector<NKPosition> curr(1, NKPosition());
+
+    for (int p = 0; p <= plies && not curr.empty(); ++p)
+    {
+        vector<NKPosition>     next;
+        unordered_set<uint64_t> seen;
+
+        for (size_t i = 0; i < curr.size(); ++i)
+        {
+            SolverResult r = solver.solve(curr[i]);
+            nodes += r.nodes;
+
+            if (r.move == -1) { continue; }     // the game is over
+
+            book.add(curr[i].key(num_cells), BookEntry(r.move, r.score));
+
+            uint32_t empty = game.getFullMask() & ~(curr[i].own | curr[i].other);
+            for (uint32_t m = empty; m != 0; m &= m - 1)
+            {
+                NKPosition child = curr[i].play(__builtin_ctz(m));
+                if (seen.insert(child.key(num_cells)).second) { next.push_back(child); }
+            }
+        }
+
+        printf("Ply %2i: %8lu positions, %12lu nodes so far\n", p, curr.size(), nodes);
+        curr.swap(next);
+    }
+
+    size_t num_opening = book.getNumEntries();
+
+    if (endgame > 0)
+    {
+        const TranspositionTable &tt = solver.getTable();
+
+        for (size_t i = 0; i < tt.getNumSlots(); ++i)
+        {
+            uint64_t key;
+            TTEntry  e;
+            if (not tt.getSlot(i, key, e)) { continue; }
+
+            uint32_t own   = uint32_t(key) & game.getFullMask();
+            uint32_t other = uint32_t(key >> num_cells);
+            int n_empty    = num_cells - NKPosition(own, other).numTokens();
+
+            if (e.bound == BOUND_EXACT && e.move != -1 && n_empty <= endgame)
+            {
+                book.add(key, BookEntry(e.move, e.score));
+            }
+        }
+    }
+
+    if (not book.write(filename, game.getN(), game.getK()))
+    {
+        printf("Could not write %s\n", filename.c_str());
+        return 1;
+    }
+
+    printf("%ix%i, %i in a row: %lu opening and %lu endgame positions in %s (%.0f s)\n",
+           game.getN(), game.getN(), game.getK(), num_opening, book.getNumEntries() - num_opening,
+           filename.c_str(), difftime(time(NULL), start));
+
+    return 0;
+}
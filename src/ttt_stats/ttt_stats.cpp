@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <string>
+
+#include "baxter_tictactoe/stats_store.h"
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+// Same codes as the brain
+#define WIN_NONE    0
+#define WIN_ROBOT   1
+#define WIN_OPP     2
+#define WIN_TIE     3
+
+void printSummary(const char *_name, const StatsSummary &_s, const char *_unit)
+{
+    printf("  %-24s mean %8.2f %s  max %8.2f %s  (%lu samples)\n",
+           _name, _s.mean(), _unit, _s.max, _unit, _s.count);
+}
+
+int main(int argc, char** argv)
+{
+    // Usage: ttt_stats <dir> [--days d]
+    // Prints aggregates of the statistics recorded by the brain (in its stats_dir),
+    // over the last d days (or over everything if not given).
+    if (argc < 2)
+    {
+        printf("Usage: ttt_stats <dir> [--days d]\n");
+        return 1;
+    }
+
+    string dir(argv[1]);
+    double days = 0.0;
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        string arg(argv[i]);
+
+        if (arg == "--days") { days = atof(argv[i+1]); }
+    }
+
+    uint64_t from_ns = 0;
+    if (days > 0.0)
+    {
+        uint64_t now_ns = uint64_t(time(NULL)) * 1000000000ULL;
+        from_ns = now_ns - uint64_t(days * 86400.0) * 1000000000ULL;
+    }
+
+    StatsReader games, moves;
+
+    if (not games.open(dir, "games") || not moves.open(dir, "moves"))
+    {
+        printf("No statistics found in %s\n", dir.c_str());
+        return 1;
+    }
+
+    StatsSummary played = games.summarize("duration", from_ns);
+
+    printf("Games: %lu\n", played.count);
+    printf("  robot wins %lu, human wins %lu, ties %lu, abandoned %lu\n",
+           games.count("outcome", WIN_ROBOT, from_ns), games.count("outcome", WIN_OPP,  from_ns),
+           games.count("outcome", WIN_TIE,   from_ns), games.count("outcome", WIN_NONE, from_ns));
+    printf("  cheating games %lu, with cheating %lu\n",
+           games.count("cheating", 1.0, from_ns), games.count("cheated", 1.0, from_ns));
+
+    printSummary("duration",         played,                                         "s");
+    printSummary("glitches per game", games.summarize("glitches", from_ns),          " ");
+    printSummary("illegal per game",  games.summarize("illegal",  from_ns),          " ");
+
+    printf("Moves: %lu\n", moves.summarize("think_time", from_ns).count);
+    printSummary("human think time",    moves.summarize("think_time",  "player", WIN_OPP,   from_ns), "s");
+    printSummary("robot decision time", moves.summarize("think_time",  "player", WIN_ROBOT, from_ns), "s");
+    printSummary("arm action time",     moves.summarize("action_time", "player", WIN_ROBOT, from_ns), "s");
+
+    return 0;
+}
@@ -0,0 +1,398 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "baxter_tictactoe/strategy.h"
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+#define MAX_PLIES   30      // games longer than this (i.e. with many cheats) are ties
+#define Z_95        1.96    // z of the 95% confidence intervals
+
+/**
+ * A game between the two strategies of a pairing. Sides are the ones of the
+ * pairing (0 for the first strategy, 1 for the second one), not the order of play.
+ */
+struct GameResult
+{
+    int              winner;    // side of the winner (-1 for a tie)
+    int             illegal;    // side that played an illegal move (-1 if none)
+    int           cheats[2];    // cheats of every side
+    vector<double>   cpu[2];    // CPU time [s] of every decision of every side
+
+    GameResult() : winner(-1), illegal(-1) { cheats[0] = cheats[1] = 0; };
+};
+
+/**
+ * Results of a strategy (or of a side of a pairing).
+ */
+struct Record
+{
+    unsigned long    wins;
+    unsigned long    ties;
+    unsigned long  losses;
+    unsigned long  cheats;
+    unsigned long illegal;
+    vector<double>    cpu;  // CPU time [s] of every decision
+
+    Record() : wins(0), ties(0), losses(0), cheats(0), illegal(0) {};
+
+    unsigned long games() const { return wins + ties + losses; };
+    double        score() const { return games() > 0 ? (wins + 0.5 * ties) / games() : 0.0; };
+};
+
+/**
+ * Wilson score interval of a proportion (ties count as half a win).
+ */
+void wilson(double _p, unsigned long _n, double &_low, double &_high)
+{
+    if (_n == 0) { _low = 0.0; _high = 1.0; return; }
+
+    double z2     = Z_95 * Z_95;
+    double den    = 1.0 + z2 / _n;
+    double center = (_p + z2 / (2.0 * _n)) / den;
+    double half   = Z_95 * sqrt(_p * (1.0 - _p) / _n + z2 / (4.0 * _n * _n)) / den;
+
+    _low  = std::max(center - half, 0.0);
+    _high = std::min(center + half, 1.0);
+}
+
+/**
+ * Elo difference that corresponds to a score (clamped away from 0 and 1).
+ */
+double elo(double _p, unsigned long _n)
+{
+    double eps = 0.5 / std::max(_n, 1UL);
+    _p = std::min(std::max(_p, eps), 1.0 - eps);
+
+    return -400.0 * log10(1.0 / _p - 1.0);
+}
+
+/**
+ * Percentile of a set of samples (sorted in place).
+ */
+double percentile(vector<double> &_v, double _p)
+{
+    if (_v.empty()) { return 0.0; }
+
+    std::sort(_v.begin(), _v.end());
+    size_t i = std::min(size_t(_p / 100.0 * _v.size()), _v.size() - 1);
+
+    return _v[i];
+}
+
+/**
+ * CPU time used by the calling thread [s].
+ */
+double threadCpuTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Quotes a string for the report.
+ */
+string jsonString(const string &_s)
+{
+    string res = "\"";
+
+    for (size_t i = 0; i < _s.size(); ++i)
+    {
+        if (_s[i] == '"' || _s[i] == '\\') { res += '\\'; }
+        if (_s[i] >= 0 && _s[i] < 0x20)    { res += ' ';  continue; }
+        res += _s[i];
+    }
+
+    return res + "\"";
+}
+
+/**
+ * Plays a game.
+ *
+ * @param _s     the strategies of the two sides
+ * @param _first side that plays first
+ * @param _seed  seed of the game (the random generators of the sides derive from it)
+ * @param _ctx   the context shared by the sides (planner, book, skill of the opponent)
+ * @return       the result of the game
+ */
+GameResult playGame(Strategy *_s[2], int _first, unsigned int _seed, const StrategyContext &_ctx)
+{
+    GameResult res;
+
+    const string col[2] = {COL_BLUE, COL_RED};
+    Board        board(9);
+    int          last[2] = {-1, -1};
+    std::mt19937 rng[2];
+
+    for (int side = 0; side < 2; ++side)
+    {
+        std::seed_seq seq = {_seed, unsigned(side)};
+        rng[side].seed(seq);
+    }
+
+    for (int ply = 0; ply < MAX_PLIES; ++ply)
+    {
+        int side = (_first + ply) % 2;
+
+        StrategyContext ctx = _ctx;
+        ctx.board     = &board;
+        ctx.robot_col = col[side];
+        ctx.opp_col   = col[1 - side];
+        ctx.last_opp  = last[1 - side];
+        ctx.rng       = &rng[side];
+
+        double       start = threadCpuTime();
+        StrategyMove m     = _s[side]->move(ctx);
+        res.cpu[side].push_back(threadCpuTime() - start);
+
+        if (not isPlayable(ctx, m))
+        {
+            res.illegal = side;
+            res.winner  = 1 - side;
+            break;
+        }
+
+        board.setCellState(m.cell, col[side]);
+        last[side] = m.cell;
+        if (m.cheat) { ++res.cheats[side]; }
+
+        if (board.threeInARow(col[side])) { res.winner = side; break; }
+        if (board.isFull())               {                     break; }
+    }
+
+    return res;
+}
+
+int main(int argc, char** argv)
+{
+    // Usage: ttt_tournament <report> [--games g] [--threads t] [--seed s] [--skill p] [--budget b]
+    //                                [--book file] [--plugin lib] [--strategy name]
+    // Plays a round robin tournament between the strategies (all the registered ones, or those
+    // given with --strategy), g games per pairing: every seed of the fixed set s, s+1, ... is
+    // played twice, with either strategy first. The strategies see an opponent of skill p, and
+    // decisions longer than b ms of CPU time are counted. The games are spread over t threads,
+    // each with its own planner (shared by its games, as it is across the games of a session).
+    // The results (win rates and Elo with 95% confidence intervals, CPU time per decision)
+    // are printed, and written as JSON to the report.
+    if (argc < 2)
+    {
+        printf("Usage: ttt_tournament <report> [--games g] [--threads t] [--seed s] [--skill p] "
+               "[--budget b] [--book file] [--plugin lib] [--strategy name]\n");
+        return 1;
+    }
+
+    string filename(argv[1]), book_file;
+    int    games   = 200;
+    int    threads = std::max(int(std::thread::hardware_concurrency()), 1);
+    int    seed    = 1;
+    double skill   = 0.5, budget_ms = 0.0;
+
+    StrategyRegistry registry;
+    vector<string>   names;
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        string arg(argv[i]);
+
+        if      (arg ==    "--games") { games     = std::max(atoi(argv[i+1]), 1); }
+        else if (arg ==  "--threads") { threads   = std::max(atoi(argv[i+1]), 1); }
+        else if (arg ==     "--seed") { seed      = atoi(argv[i+1]);              }
+        else if (arg ==    "--skill") { skill     = atof(argv[i+1]);              }
+        else if (arg ==   "--budget") { budget_ms = atof(argv[i+1]);              }
+        else if (arg ==     "--book") { book_file = argv[i+1];                    }
+        else if (arg == "--strategy") { names.push_back(argv[i+1]);               }
+        else if (arg ==   "--plugin")
+        {
+            if (not registry.loadPlugin(argv[i+1])) { return 1; }
+        }
+    }
+
+    if (names.empty()) { names = registry.getNames(); }
+
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        if (not registry.has(names[i]))
+        {
+            printf("%s is not an available strategy\n", names[i].c_str());
+            return 1;
+        }
+    }
+
+    if (names.size() < 2)
+    {
+        printf("At least two strategies are needed\n");
+        return 1;
+    }
+
+    MoveBook book;
+    if (not book_file.empty() && not (book.open(book_file) && book.getN() == 3 && book.getK() == 3))
+    {
+        printf("%s is not a tic tac toe move book\n", book_file.c_str());
+        return 1;
+    }
+
+    // Every game is a pairing and a game index: the seed is s + index / 2, and the index parity
+    // tells which strategy plays first. Results are stored by game, so threads never share them.
+    vector<pair<int, int> > pairings;
+    for (size_t a = 0; a < names.size(); ++a)
+    {
+        for (size_t b = a + 1; b < names.size(); ++b) { pairings.push_back(make_pair(a, b)); }
+    }
+
+    size_t             num_games = pairings.size() * games;
+    vector<GameResult> results(num_games);
+    std::atomic<size_t> next_game(0);
+
+    time_t start = time(NULL);
+
+    std::function<void()> worker = [&]()
+    {
+        CheatingPlanner planner(skill);
+        vector<std::unique_ptr<Strategy> > strategies;
+
+        for (size_t i = 0; i < names.size(); ++i) { strategies.push_back(registry.create(names[i])); }
+
+        StrategyContext ctx;
+        ctx.opp_skill   = skill;
+        ctx.time_budget = 0.0;
+        ctx.planner     = &planner;
+        ctx.book        = book.isOpen() ? &book : NULL;
+
+        for (size_t g = next_game++; g < num_games; g = next_game++)
+        {
+            const pair<int, int> &p = pairings[g / games];
+            int                   i = g % games;
+
+            Strategy *s[2] = {strategies[p.first].get(), strategies[p.second].get()};
+            results[g] = playGame(s, i % 2, seed + i / 2, ctx);
+        }
+    };
+
+    vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) { workers.push_back(std::thread(worker)); }
+    for (size_t t = 0; t < workers.size(); ++t) { workers[t].join(); }
+
+    // Aggregates, by strategy and by pairing (from the point of view of its first strategy)
+    vector<Record> records(names.size()), pair_records(pairings.size());
+
+    for (size_t g = 0; g < num_games; ++g)
+    {
+        const GameResult &r = results[g];
+        int          pairing = g / games;
+        int         id[2]    = {pairings[pairing].first, pairings[pairing].second};
+
+        for (int side = 0; side < 2; ++side)
+        {
+            Record &rec = records[id[side]];
+
+            if      (r.winner == -1)   { ++rec.ties;   }
+            else if (r.winner == side) { ++rec.wins;   }
+            else                       { ++rec.losses; }
+
+            if (r.illegal == side) { ++rec.illegal; }
+            rec.cheats += r.cheats[side];
+            rec.cpu.insert(rec.cpu.end(), r.cpu[side].begin(), r.cpu[side].end());
+        }
+
+        Record &pr = pair_records[pairing];
+        if      (r.winner == -1) { ++pr.ties;   }
+        else if (r.winner ==  0) { ++pr.wins;   }
+        else                     { ++pr.losses; }
+    }
+
+    FILE *f = fopen(filename.c_str(), "w");
+    if (f == NULL)
+    {
+        printf("Could not write %s\n", filename.c_str());
+        return 1;
+    }
+
+    fprintf(f, "{\n  \"games_per_pairing\": %i,\n  \"seed\": %i,\n  \"threads\": %i,\n"
+               "  \"opponent_skill\": %g,\n  \"budget_ms\": %g,\n  \"book\": %s,\n  \"strategies\": [\n",
+               games, seed, threads, skill, budget_ms, jsonString(book_file).c_str());
+
+    printf("%-16s %6s %6s %6s %6s  %-17s %-19s %11s %11s %11s %8s\n", "strategy", "games", "wins",
+           "ties", "losses", "score (95% CI)", "Elo (95% CI)", "cpu mean", "cpu p99", "cpu max", "over");
+
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        Record &rec = records[i];
+        double  low, high;
+        wilson(rec.score(), rec.games(), low, high);
+
+        double mean = 0.0;
+        for (size_t j = 0; j < rec.cpu.size(); ++j) { mean += rec.cpu[j]; }
+        mean = rec.cpu.empty() ? 0.0 : mean / rec.cpu.size();
+
+        double p50  = percentile(rec.cpu, 50.0);
+        double p99  = percentile(rec.cpu, 99.0);
+        double max  = rec.cpu.empty() ? 0.0 : rec.cpu.back();
+
+        unsigned long over = 0;
+        if (budget_ms > 0.0)
+        {
+            over = rec.cpu.end() - std::upper_bound(rec.cpu.begin(), rec.cpu.end(), budget_ms * 1e-3);
+        }
+
+        printf("%-16s %6lu %6lu %6lu %6lu  %.3f (%.2f-%.2f) %+5.0f (%+5.0f,%+5.0f) %8.1f us %8.1f us %8.1f us %8lu\n",
+               names[i].c_str(), rec.games(), rec.wins, rec.ties, rec.losses, rec.score(), low, high,
+               elo(rec.score(), rec.games()), elo(low, rec.games()), elo(high, rec.games()),
+               mean * 1e6, p99 * 1e6, max * 1e6, over);
+
+        fprintf(f, "    {\"name\": %s, \"games\": %lu, \"wins\": %lu, \"ties\": %lu, \"losses\": %lu, "
+                   "\"score\": %.4f, \"score_low\": %.4f, \"score_high\": %.4f, "
+                   "\"elo\": %.1f, \"elo_low\": %.1f, \"elo_high\": %.1f, \"cheats\": %lu, \"illegal\": %lu, "
+                   "\"decisions\": %lu, \"cpu_mean_us\": %.2f, \"cpu_p50_us\": %.2f, \"cpu_p99_us\": %.2f, "
+                   "\"cpu_max_us\": %.2f, \"over_budget\": %lu}%s\n",
+                   jsonString(names[i]).c_str(), rec.games(), rec.wins, rec.ties, rec.losses,
+                   rec.score(), low, high, elo(rec.score(), rec.games()), elo(low, rec.games()),
+                   elo(high, rec.games()), rec.cheats, rec.illegal, rec.cpu.size(),
+                   mean * 1e6, p50 * 1e6, p99 * 1e6, max * 1e6, over,
+                   i + 1 < names.size() ? "," : "");
+    }
+
+    fprintf(f, "  ],\n  \"pairings\": [\n");
+    printf("\n");
+
+    for (size_t p = 0; p < pairings.size(); ++p)
+    {
+        const Record &pr = pair_records[p];
+        double low, high;
+        wilson(pr.score(), pr.games(), low, high);
+
+        const string &a = names[pairings[p].first];
+        const string &b = names[pairings[p].second];
+
+        printf("%-16s vs %-16s %5lu-%lu-%lu  score %.3f (%.2f-%.2f)\n", a.c_str(), b.c_str(),
+               pr.wins, pr.ties, pr.losses, pr.score(), low, high);
+
+        fprintf(f, "    {\"first\": %s, \"second\": %s, \"first_wins\": %lu, \"ties\": %lu, "
+                   "\"second_wins\": %lu, \"score\": %.4f, \"score_low\": %.4f, \"score_high\": %.4f}%s\n",
+                   jsonString(a).c_str(), jsonString(b).c_str(), pr.wins, pr.ties, pr.losses,
+                   pr.score(), low, high, p + 1 < pairings.size() ? "," : "");
+    }
+
+    fprintf(f, "  ]\n}\n");
+
+    if (fclose(f) != 0)
+    {
+        printf("Could not write %s\n", filename.c_str());
+        return 1;
+    }
+
+    printf("\n%lu games on %i threads in %s (%.0f s)\n", num_games, threads, filename.c_str(),
+           difftime(time(NULL), start));
+
+    return 0;
+}
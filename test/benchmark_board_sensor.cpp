@@ -0,0 +1,162 @@
+/**
+ * Benchmark of the board state detection at different processing resolutions,
+ * for both detection modes.
+ * Synthetic frames of a board with random tokens (and sensor noise) are generated
+ * at the camera resolution, and the detection is run at every pyramid level:
+ * for each level, it reports the per-frame time and the fraction of cells whose
+ * state has been detected correctly.
+ *
+ * Usage: benchmark_board_sensor [number of frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "baxter_tictactoe/vision_utils.h"
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+#define FRAME_WIDTH     1280
+#define FRAME_HEIGHT     720
+#define CELL_SIDE        120
+#define CELL_GAP          12
+#define BOARD_X          450
+#define BOARD_Y          170
+#define TOKEN_RADIUS      40
+#define NOISE_SIGMA       10
+#define AREA_THRESHOLD  1500    // at full resolution
+#define MAX_LEVELS         3
+
+/**
+ * Creates a 3x3 board whose cells are squares, scaled down by a number of pyramid levels.
+ */
+Board syntheticBoard(int _levels)
+{
+    Board b;
+    int s = 1 << _levels;
+
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            int x = BOARD_X + c * (CELL_SIDE + CELL_GAP);
+            int y = BOARD_Y + r * (CELL_SIDE + CELL_GAP);
+
+            Contour contour;
+            contour.push_back(cv::Point( x              / s,  y              / s));
+            contour.push_back(cv::Point((x + CELL_SIDE) / s,  y              / s));
+            contour.push_back(cv::Point((x + CELL_SIDE) / s, (y + CELL_SIDE) / s));
+            contour.push_back(cv::Point( x              / s, (y + CELL_SIDE) / s));
+            b.addCell(Cell(contour));
+        }
+    }
+
+    return b;
+}
+
+/**
+ * Renders a frame of the board with random tokens on it.
+ *
+ * @param _img    the frame (BGR)
+ * @param _states the states of the cells
+ * @param _rng    the random number generator
+ */
+void syntheticFrame(cv::Mat &_img, vector<string> &_states, cv::RNG &_rng)
+{
+    _img.create(FRAME_HEIGHT, FRAME_WIDTH, CV_8UC3);
+    _img.setTo(cv::Scalar(90, 90, 90));
+
+    // dark board, whose white cells are separated by the grid lines
+    cv::rectangle(_img, cv::Rect(BOARD_X - 30, BOARD_Y - 30, 3 * CELL_SIDE + 2 * CELL_GAP + 60,
+                                 3 * CELL_SIDE + 2 * CELL_GAP + 60), cv::Scalar(20, 20, 20), CV_FILLED);
+
+    _states.assign(NUMBER_OF_CELLS, COL_EMPTY);
+
+    for (int i = 0; i < NUMBER_OF_CELLS; ++i)
+    {
+        int x = BOARD_X + (i % 3) * (CELL_SIDE + CELL_GAP);
+        int y = BOARD_Y + (i / 3) * (CELL_SIDE + CELL_GAP);
+        cv::rectangle(_img, cv::Rect(x, y, CELL_SIDE, CELL_SIDE), cv::Scalar(210, 210, 210), CV_FILLED);
+
+        int token = _rng.uniform(0, 3);
+        if (token == 0) { continue; }
+
+        // tokens are not placed exactly at the center of the cells
+        cv::Point center(x + CELL_SIDE / 2 + _rng.uniform(-12, 13),
+                         y + CELL_SIDE / 2 + _rng.uniform(-12, 13));
+
+        if (token == 1)
+        {
+            cv::circle(_img, center, TOKEN_RADIUS, cv::Scalar( 50,  50, 170), CV_FILLED);
+            _states[i] = COL_RED;
+        }
+        else
+        {
+            cv::circle(_img, center, TOKEN_RADIUS, cv::Scalar(170,  60,  40), CV_FILLED);
+            _states[i] = COL_BLUE;
+        }
+    }
+
+    cv::Mat noise(_img.size(), CV_16SC3);
+    cv::randn(noise, 0, NOISE_SIGMA);
+    cv::Mat img16;
+    _img.convertTo(img16, CV_16SC3);
+    cv::add(img16, noise, img16);
+    img16.convertTo(_img, CV_8UC3);
+}
+
+int main(int argc, char **argv)
+{
+    int n_frames = argc > 1 ? atoi(argv[1]) : 200;
+
+    hsvColorRange red (colorRange(160,  20), colorRange(40, 196), colorRange(50, 196));
+    hsvColorRange blue(colorRange( 90, 130), colorRange(70, 256), colorRange(70, 256));
+
+    // the frames are generated once, so that only the detection is timed
+    cv::RNG rng(42);
+    vector<cv::Mat>          frames(n_frames);
+    vector<vector<string> >  states(n_frames);
+
+    for (int f = 0; f < n_frames; ++f)
+    {
+        syntheticFrame(frames[f], states[f], rng);
+    }
+
+    printf("%d frames of %dx%d pixels\n", n_frames, FRAME_WIDTH, FRAME_HEIGHT);
+    printf("mode      levels  resolution     time [ms]  accuracy [%%]\n");
+
+    for (int m = DETECT_CONTOURS; m <= DETECT_INTEGRAL; ++m)
+    for (int l = 0; l <= MAX_LEVELS; ++l)
+    {
+        BoardDetector detector(l, AREA_THRESHOLD);
+        detector.setColors(red, blue);
+        detector.setMode(m);
+
+        Board board = syntheticBoard(l);
+        detector.setBoard(board, cv::Size(FRAME_WIDTH >> l, FRAME_HEIGHT >> l));
+
+        int correct = 0;
+        int64 ticks = 0;
+
+        for (int f = 0; f < n_frames; ++f)
+        {
+            int64 start = cv::getTickCount();
+            detector.detect(frames[f], board);
+            ticks += cv::getTickCount() - start;
+
+            for (int i = 0; i < NUMBER_OF_CELLS; ++i)
+            {
+                if (board.getCellState(i) == states[f][i]) { ++correct; }
+            }
+        }
+
+        printf("%-8s  %6d  %4dx%-4d  %12.3f  %13.2f\n", m == DETECT_INTEGRAL ? "integral" : "contours", l, FRAME_WIDTH >> l, FRAME_HEIGHT >> l,
+               1000.0 * ticks / cv::getTickFrequency() / n_frames,
+               100.0 * correct / (n_frames * NUMBER_OF_CELLS));
+    }
+
+    return 0;
+}
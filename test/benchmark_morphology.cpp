@@ -0,0 +1,149 @@
+/**
+ * Benchmark of the fused binary morphology and of the integral-image cell count,
+ * against the OpenCV call chains they replace:
+ *   - TTTController::isolateToken: 2 erosions, 4 dilations and 2 erosions
+ *     (cv::erode / cv::dilate, one full-frame pass each)
+ *   - BoardState: for each of the 9 cells and 2 colors, cell masking,
+ *     3x3 cv::GaussianBlur and binary moments over the full frame
+ * Both implementations are run on the same noisy masks, and their outputs are compared.
+ *
+ * Usage: benchmark_morphology [number of frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "baxter_tictactoe/vision_utils.h"
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+#define FRAME_WIDTH     1280
+#define FRAME_HEIGHT     720
+#define CELL_SIDE        120
+#define CELL_GAP          12
+#define BOARD_X          450
+#define BOARD_Y          170
+
+/**
+ * Renders a binary mask with a few blobs and salt-and-pepper noise.
+ */
+void syntheticMask(cv::Mat &_mask, cv::RNG &_rng)
+{
+    _mask = cv::Mat::zeros(FRAME_HEIGHT, FRAME_WIDTH, CV_8UC1);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        cv::Point center(_rng.uniform(0, FRAME_WIDTH), _rng.uniform(0, FRAME_HEIGHT));
+        cv::circle(_mask, center, _rng.uniform(10, 60), cv::Scalar(255), CV_FILLED);
+    }
+
+    for (int i = 0; i < FRAME_WIDTH * FRAME_HEIGHT / 50; ++i)
+    {
+        _mask.at<uint8_t>(_rng.uniform(0, FRAME_HEIGHT), _rng.uniform(0, FRAME_WIDTH)) ^= 255;
+    }
+}
+
+double toMs(int64 _ticks, int _n)
+{
+    return 1000.0 * _ticks / cv::getTickFrequency() / _n;
+}
+
+int main(int argc, char **argv)
+{
+    int n_frames = argc > 1 ? atoi(argv[1]) : 50;
+
+    cv::RNG rng(42);
+    vector<cv::Mat> masks(n_frames);
+
+    for (int f = 0; f < n_frames; ++f)
+    {
+        syntheticMask(masks[f], rng);
+    }
+
+    printf("%d masks of %dx%d pixels\n", n_frames, FRAME_WIDTH, FRAME_HEIGHT);
+
+    // fused morphology vs. cv::erode / cv::dilate
+    int ops[] = {cv::MORPH_ERODE,  cv::MORPH_ERODE,  cv::MORPH_DILATE, cv::MORPH_DILATE,
+                 cv::MORPH_DILATE, cv::MORPH_DILATE, cv::MORPH_ERODE,  cv::MORPH_ERODE};
+    vector<int> seq(ops, ops + sizeof(ops) / sizeof(ops[0]));
+
+    int64 t_cv = 0, t_fused = 0;
+    int mismatches = 0;
+    cv::Mat out_cv, out_fused;
+
+    for (int f = 0; f < n_frames; ++f)
+    {
+        int64 start = cv::getTickCount();
+        masks[f].copyTo(out_cv);
+        for (size_t i = 0; i < 2; ++i)  cv::erode(out_cv, out_cv, cv::Mat());
+        for (size_t i = 0; i < 4; ++i) cv::dilate(out_cv, out_cv, cv::Mat());
+        for (size_t i = 0; i < 2; ++i)  cv::erode(out_cv, out_cv, cv::Mat());
+        t_cv += cv::getTickCount() - start;
+
+        start = cv::getTickCount();
+        binaryMorphology(masks[f], out_fused, seq);
+        t_fused += cv::getTickCount() - start;
+
+        mismatches += cv::countNonZero(out_cv != out_fused);
+    }
+
+    printf("morphology  opencv chain %8.3f ms  fused %8.3f ms  mismatching pixels %d\n",
+           toMs(t_cv, n_frames), toMs(t_fused, n_frames), mismatches);
+
+    // integral-image count vs. masking, blurring and moments
+    Board board;
+    vector<cv::Rect> rects;
+    vector<cv::Mat>  cell_masks;
+
+    for (int i = 0; i < NUMBER_OF_CELLS; ++i)
+    {
+        int x = BOARD_X + (i % 3) * (CELL_SIDE + CELL_GAP);
+        int y = BOARD_Y + (i / 3) * (CELL_SIDE + CELL_GAP);
+
+        Contour contour;
+        contour.push_back(cv::Point(x,             y            ));
+        contour.push_back(cv::Point(x + CELL_SIDE, y            ));
+        contour.push_back(cv::Point(x + CELL_SIDE, y + CELL_SIDE));
+        contour.push_back(cv::Point(x,             y + CELL_SIDE));
+        board.addCell(Cell(contour));
+
+        rects.push_back(cv::boundingRect(contour));
+        cell_masks.push_back(cv::Mat::zeros(rects.back().size(), CV_8UC1));
+        cv::drawContours(cell_masks.back(), Contours(1, contour), -1, cv::Scalar(255), CV_FILLED, 8,
+                         cv::noArray(), INT_MAX, -rects.back().tl());
+    }
+
+    t_cv = 0; t_fused = 0; mismatches = 0;
+    cv::Mat buf;
+
+    for (int f = 0; f < n_frames; ++f)
+    {
+        // two colors per frame, as the sensor does
+        for (int c = 0; c < 2; ++c)
+        {
+            for (int i = 0; i < NUMBER_OF_CELLS; ++i)
+            {
+                int64 start = cv::getTickCount();
+                cv::Mat crop = board.getCell(i).maskImage(masks[f]);
+                cv::GaussianBlur(crop.clone(), crop, cv::Size(3,3), 0, 0);
+                int area_cv = cv::moments(crop, true).m00;
+                t_cv += cv::getTickCount() - start;
+
+                start = cv::getTickCount();
+                int area_int = countSmoothedArea(masks[f], rects[i], cell_masks[i], buf);
+                t_fused += cv::getTickCount() - start;
+
+                mismatches += area_cv != area_int;
+            }
+        }
+    }
+
+    printf("cell areas  opencv chain %8.3f ms  integral %8.3f ms  mismatching cells %d\n",
+           toMs(t_cv, n_frames), toMs(t_fused, n_frames), mismatches);
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * Benchmark of the parallel solver on the larger board variants.
+ * For every number of threads (1, 2, 4, 8, ... up to the given maximum), a solver
+ * with an empty table solves a set of positions of the game: all the positions
+ * after the given number of plies from the empty board. It reports the time, the
+ * number of positions visited per second, and the speedup over a single thread.
+ *
+ * Usage: benchmark_solver [n] [k] [plies] [max threads]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <thread>
+#include <vector>
+
+#include "baxter_tictactoe/game_solver.h"
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+/**
+ * Wall clock time [s]
+ */
+double now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+int main(int argc, char** argv)
+{
+    int n           = argc > 1 ? atoi(argv[1]) : 4;
+    int k           = argc > 2 ? atoi(argv[2]) : 4;
+    int plies       = argc > 3 ? atoi(argv[3]) : 1;
+    int max_threads = argc > 4 ? atoi(argv[4]) : 8;
+
+    NKGame game(n, k);
+
+    // All the positions after the given number of plies (with repetitions, as in real games)
+    vector<NKPosition> positions(1, NKPosition());
+
+    for (int p = 0; p < plies; ++p)
+    {
+        vector<NKPosition> next;
+
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            uint32_t empty = game.getFullMask() & ~(positions[i].own | positions[i].other);
+            for (uint32_t m = empty; m != 0; m &= m - 1)
+            {
+                next.push_back(positions[i].play(__builtin_ctz(m)));
+            }
+        }
+
+        positions.swap(next);
+    }
+
+    printf("%ix%i, %i in a row: %lu positions after %i plies (%u hardware threads)\n",
+           game.getN(), game.getN(), game.getK(), positions.size(), plies,
+           std::thread::hardware_concurrency());
+    printf("threads     time [s]       nodes   Mnodes/s   speedup\n");
+
+    double time_1 = 0.0;
+
+    for (int t = 1; t <= max_threads; t *= 2)
+    {
+        Solver solver(game, t, 24);
+
+        uint64_t nodes = 0;
+        int      score = 0;
+        double   start = now();
+
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            SolverResult r = solver.solve(positions[i]);
+            nodes += r.nodes;
+            score += r.score;
+        }
+
+        double time = now() - start;
+        if (t == 1) { time_1 = time; }
+
+        printf("%7i %12.3f %11lu %10.2f %9.2f   (sum of scores %i)\n",
+               t, time, nodes, nodes / time * 1e-6, time_1 / time, score);
+    }
+
+    return 0;
+}
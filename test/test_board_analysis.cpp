@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+
+#include "baxter_tictactoe/board_analysis.h"
+
+using namespace baxter_tictactoe;
+
+TEST(BoardAnalysis, testMoveAcceptor)
+{
+    Board empty(9);
+    Board moved(9);
+    Board other(9);
+    moved.setCellState(4, COL_RED);
+    other.setCellState(0, COL_RED);
+
+    MoveAcceptor acc(0.001, 0.01, 0.9, 0.1);
+    EXPECT_GT(acc.getUpperThreshold(), 0.0);
+    EXPECT_LT(acc.getLowerThreshold(), 0.0);
+
+    // Readings that support nothing are ignored
+    EXPECT_EQ(acc.update(false, empty), SPRT_CONTINUE);
+    EXPECT_FALSE(acc.hasCandidate());
+
+    // A clean stream is accepted in a few readings (log(999 * 0.99) / log(9) ~ 3.1)
+    int n = 0;
+    int res = SPRT_CONTINUE;
+    while (res == SPRT_CONTINUE && n < 100) { res = acc.update(true, moved); ++n; }
+
+    EXPECT_EQ(res, SPRT_ACCEPT);
+    EXPECT_EQ(n, 4);
+    EXPECT_TRUE(acc.getCandidate() == moved);
+
+    // A glitch delays the acceptance by a couple of readings, but does not restart it
+    acc.reset();
+    EXPECT_EQ(acc.update(true,  moved), SPRT_CONTINUE);
+    EXPECT_EQ(acc.update(true,  moved), SPRT_CONTINUE);
+    EXPECT_EQ(acc.update(false, empty), SPRT_CONTINUE);
+    EXPECT_EQ(acc.update(true,  moved), SPRT_CONTINUE);
+    EXPECT_EQ(acc.update(true,  moved), SPRT_CONTINUE);
+    EXPECT_EQ(acc.update(true,  moved), SPRT_ACCEPT);
+    EXPECT_EQ(acc.getNumReadings(), 6UL);
+
+    // A flickering reading is rejected
+    acc.reset();
+    EXPECT_EQ(acc.update(true,  moved), SPRT_CONTINUE);
+    EXPECT_EQ(acc.update(false, empty), SPRT_CONTINUE);
+    EXPECT_EQ(acc.update(false, empty), SPRT_CONTINUE);
+    EXPECT_EQ(acc.update(false, empty), SPRT_CONTINUE);
+    EXPECT_EQ(acc.update(false, empty), SPRT_REJECT);
+    EXPECT_FALSE(acc.hasCandidate());
+
+    // A different supported board restarts the test on it
+    acc.reset();
+    EXPECT_EQ(acc.update(true, moved), SPRT_CONTINUE);
+    EXPECT_EQ(acc.update(true, moved), SPRT_CONTINUE);
+    EXPECT_EQ(acc.update(true, other), SPRT_CONTINUE);
+    EXPECT_EQ(acc.getNumReadings(), 1UL);
+    EXPECT_TRUE(acc.getCandidate() == other);
+
+    // With a minimum time, a clean stream at 30 fps is accepted after one second
+    MoveAcceptor slow(0.001, 0.01, 0.9, 0.1, 1.0);
+    n   = 0;
+    res = SPRT_CONTINUE;
+    while (res == SPRT_CONTINUE && n < 100) { res = slow.update(true, moved, 10.0 + n / 30.0); ++n; }
+
+    EXPECT_EQ(res, SPRT_ACCEPT);
+    EXPECT_EQ(n, 31);
+
+    // but a candidate that goes away is still rejected in a few readings
+    slow.reset();
+    for (int i = 0; i < 20; ++i) { EXPECT_EQ(slow.update(true, moved, i / 30.0), SPRT_CONTINUE); }
+
+    n   = 0;
+    res = SPRT_CONTINUE;
+    while (res == SPRT_CONTINUE && n < 100) { res = slow.update(false, empty, (20 + n) / 30.0); ++n; }
+
+    EXPECT_EQ(res, SPRT_REJECT);
+    EXPECT_LE(n, 6);
+}
+
+TEST(BoardAnalysis, testClassifyTransition)
+{
+    Board ref(9);
+    ref.setCellState(0, COL_RED);
+    ref.setCellState(4, COL_BLUE);
+
+    Board b(ref);
+    EXPECT_EQ(classifyTransition(ref, b, COL_RED).type, TRANS_NONE);
+
+    b.setCellState(8, COL_RED);
+    Transition t = classifyTransition(ref, b, COL_RED);
+    EXPECT_EQ(t.type, TRANS_ADD);
+    ASSERT_EQ(t.added.size(), 1UL);
+    EXPECT_EQ(t.added[0], 8UL);
+
+    EXPECT_EQ(classifyTransition(ref, b, COL_BLUE).type, TRANS_ADD_WRONG);
+
+    b.setCellState(2, COL_RED);
+    EXPECT_EQ(classifyTransition(ref, b, COL_RED).type, TRANS_MULTI_ADD);
+
+    // A token moved to another cell
+    b = ref;
+    b.setCellState(4, COL_EMPTY);
+    b.setCellState(5, COL_BLUE);
+    EXPECT_EQ(classifyTransition(ref, b, COL_RED).type, TRANS_SWAP);
+
+    // A token replaced by one of the other color
+    b = ref;
+    b.setCellState(4, COL_RED);
+    t = classifyTransition(ref, b, COL_RED);
+    EXPECT_EQ(t.type, TRANS_SWAP);
+    ASSERT_EQ(t.changed.size(), 1UL);
+    EXPECT_EQ(t.changed[0], 4UL);
+
+    b = ref;
+    b.setCellState(0, COL_EMPTY);
+    EXPECT_EQ(classifyTransition(ref, b, COL_RED).type, TRANS_REMOVE);
+}
+
+TEST(BoardAnalysis, testTransitionAnalyzer)
+{
+    Board ref(9);
+    ref.setCellState(4, COL_BLUE);
+
+    TransitionAnalyzer an(2, 5);
+    an.setReference(ref, COL_RED);
+
+    Transition ev;
+
+    // Two tokens placed at once: emitted on the second reading, and only once
+    Board multi(ref);
+    multi.setCellState(0, COL_RED);
+    multi.setCellState(1, COL_RED);
+    EXPECT_FALSE(an.update(multi, ev));
+    EXPECT_TRUE (an.update(multi, ev));
+    EXPECT_EQ(ev.type, TRANS_MULTI_ADD);
+    EXPECT_EQ(ev.frames, 2UL);
+    EXPECT_FALSE(an.update(multi, ev));
+
+    // Back to the reference board
+    EXPECT_FALSE(an.update(ref, ev));
+    EXPECT_TRUE (an.update(ref, ev));
+    EXPECT_EQ(ev.type, TRANS_NONE);
+    EXPECT_FALSE(an.update(ref, ev));
+
+    // A token hidden for a short time is an occlusion
+    Board hidden(ref);
+    hidden.setCellState(4, COL_EMPTY);
+    EXPECT_FALSE(an.update(hidden, ev));
+    EXPECT_TRUE (an.update(hidden, ev));
+    EXPECT_EQ(ev.type, TRANS_OCCLUSION);
+
+    // If it lasts, it has been removed
+    EXPECT_FALSE(an.update(hidden, ev));
+    EXPECT_FALSE(an.update(hidden, ev));
+    EXPECT_TRUE (an.update(hidden, ev));
+    EXPECT_EQ(ev.type, TRANS_REMOVE);
+    ASSERT_EQ(ev.removed.size(), 1UL);
+    EXPECT_EQ(ev.removed[0], 4UL);
+
+    // A flickering reading never confirms anything
+    an.setReference(ref, COL_RED);
+    Board wrong(ref);
+    wrong.setCellState(0, COL_BLUE);
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_FALSE(an.update(i%2==0?wrong:multi, ev));
+    }
+}
+
+TEST(BoardAnalysis, testTransitionAnalyzerOcclusion)
+{
+    Board ref(9);
+    ref.setCellState(4, COL_BLUE);
+
+    TransitionAnalyzer an(2, 5);
+    an.setReference(ref, COL_RED);
+
+    Transition ev;
+
+    // A hand passes over the board: the occlusion is emitted, but not the board clearing up
+    Board hidden(ref);
+    hidden.setCellState(4, COL_EMPTY);
+    EXPECT_FALSE(an.update(hidden, ev));
+    EXPECT_TRUE (an.update(hidden, ev));
+    EXPECT_EQ(ev.type, TRANS_OCCLUSION);
+
+    for (int i = 0; i < 5; ++i) { EXPECT_FALSE(an.update(ref, ev)); }
+    EXPECT_EQ(an.getLastEmitted(), TRANS_NONE);
+
+    // Neither after a legal move that is taken back
+    Board added(ref);
+    added.setCellState(0, COL_RED);
+    EXPECT_FALSE(an.update(added, ev));
+    EXPECT_TRUE (an.update(added, ev));
+    EXPECT_EQ(ev.type, TRANS_ADD);
+    for (int i = 0; i < 5; ++i) { EXPECT_FALSE(an.update(ref, ev)); }
+
+    // While it is after an illegal move
+    Board wrong(ref);
+    wrong.setCellState(0, COL_BLUE);
+    EXPECT_FALSE(an.update(wrong, ev));
+    EXPECT_TRUE (an.update(wrong, ev));
+    EXPECT_EQ(ev.type, TRANS_ADD_WRONG);
+    EXPECT_FALSE(an.update(ref, ev));
+    EXPECT_TRUE (an.update(ref, ev));
+    EXPECT_EQ(ev.type, TRANS_NONE);
+
+    EXPECT_TRUE (isIllegalTransition(TRANS_SWAP));
+    EXPECT_FALSE(isIllegalTransition(TRANS_OCCLUSION));
+    EXPECT_FALSE(isIllegalTransition(TRANS_ADD));
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
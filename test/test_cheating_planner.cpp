@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include "baxter_tictactoe/cheating_planner.h"
+
+using namespace baxter_tictactoe;
+
+// Builds a bitboard from a string of 9 cells: 'r' robot, 'o' opponent, anything else empty
+BitBoard fromString(const std::string &_s)
+{
+    BitBoard b;
+    for (int i = 0; i < 9; ++i)
+    {
+        if (_s[i] == 'r') { b.robot |= cellMask(i); }
+        if (_s[i] == 'o') { b.opp   |= cellMask(i); }
+    }
+    return b;
+}
+
+TEST(CheatingPlanner, testBitBoard)
+{
+    EXPECT_TRUE (hasLine(0x007));
+    EXPECT_TRUE (hasLine(0x111 | 0x002));
+    EXPECT_FALSE(hasLine(0x0AA));
+
+    BitBoard b = fromString("rr.o.o...");
+    EXPECT_EQ(winningCells(b.robot, b.opp), cellMask(2));
+    EXPECT_EQ(winningCells(b.opp, b.robot), cellMask(4));
+    EXPECT_EQ(countCells(b.empty()), 5);
+    EXPECT_FALSE(b.isFull());
+
+    Board board(9);
+    board.setCellState(0, COL_BLUE);
+    board.setCellState(4, COL_RED);
+    BitBoard bb = makeBitBoard(board, COL_BLUE, COL_RED);
+    EXPECT_EQ(bb.robot, cellMask(0));
+    EXPECT_EQ(bb.opp,   cellMask(4));
+}
+
+TEST(CheatingPlanner, testBestMove)
+{
+    CheatingPlanner planner(1.0);
+
+    // The robot wins right away if it can
+    CheatPlan p = planner.bestMove(fromString("rr.oo...."));
+    EXPECT_EQ(p.cell, 2);
+    EXPECT_DOUBLE_EQ(p.value, 1.0);
+
+    // Against an optimal opponent, the empty board is a tie
+    EXPECT_NEAR(planner.evaluate(BitBoard(), true), 0.5, 1e-6);
+
+    // Against a random one, the robot is expected to do better
+    planner.setSkill(0.0);
+    EXPECT_GT(planner.evaluate(BitBoard(), true), 0.7);
+}
+
+TEST(CheatingPlanner, testBestCheat)
+{
+    CheatingPlanner planner(1.0);
+
+    // Overwriting 5 completes the middle row, and overwriting 7 the middle column
+    BitBoard b = fromString("or.rro.oo");
+    CheatPlan p = planner.bestCheat(b, 8);
+    EXPECT_TRUE(p.cell == 5 || p.cell == 7);
+    EXPECT_DOUBLE_EQ(p.value, 1.0);
+
+    // Both win right away, so the one further from the last move of the opponent is chosen
+    p = planner.bestCheat(b, 7);
+    EXPECT_EQ(p.cell, 5);
+    EXPECT_DOUBLE_EQ(p.noticeability, 0.5);
+    p = planner.bestCheat(b, 5);
+    EXPECT_EQ(p.cell, 7);
+
+    // Cheats that do not win right away are evaluated with the follow-up play
+    planner.setSkill(0.5);
+    b = fromString("o...r...o");
+    p = planner.bestCheat(b, 8);
+    EXPECT_EQ(p.cell, 0);
+    EXPECT_GT(p.value, 0.5);
+    EXPECT_DOUBLE_EQ(p.noticeability, 0.0);
+
+    // No tokens to overwrite
+    p = planner.bestCheat(fromString("....r...."));
+    EXPECT_EQ(p.cell, -1);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
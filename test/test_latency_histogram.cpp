@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+
+#include "baxter_tictactoe/latency_histogram.h"
+
+using namespace baxter_tictactoe;
+
+TEST(LatencyHistogram, testPercentiles)
+{
+    LatencyHistogram h;
+
+    EXPECT_EQ(h.getCount(),        0UL);
+    EXPECT_EQ(h.percentile(50),    0.0);
+
+    // 1 ms to 100 ms, one sample per ms
+    for (int i = 1; i <= 100; ++i)
+    {
+        h.add(i * 1e-3);
+    }
+
+    EXPECT_EQ(h.getCount(), 100UL);
+    EXPECT_NEAR(h.getMean(), 50.5e-3, 1e-9);
+    EXPECT_EQ(h.getMax(), 100e-3);
+
+    // bins are about 19% wide
+    EXPECT_NEAR(h.percentile(50), 50e-3, 50e-3 * 0.2);
+    EXPECT_NEAR(h.percentile(90), 90e-3, 90e-3 * 0.2);
+    EXPECT_LE  (h.percentile(50), h.percentile(90));
+    EXPECT_EQ  (h.percentile(100), 100e-3);
+
+    // Out of range samples end up in the first and last bins
+    h.add(-1.0);
+    h.add(100.0);
+    EXPECT_EQ(h.getCount(), 102UL);
+    EXPECT_EQ(h.getMax(),   100.0);
+    EXPECT_LE(h.percentile(0), 1e-4);
+
+    h.reset();
+    EXPECT_EQ(h.getCount(), 0UL);
+    EXPECT_EQ(h.getMax(),   0.0);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
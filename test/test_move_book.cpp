@@ -0,0 +1,223 @@
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "baxter_tictactoe/game_solver.h"
+#include "baxter_tictactoe/move_book.h"
+
+using namespace baxter_tictactoe;
+
+/**
+ * Builds a position from a string of cells, row by row: 'x' for the player
+ * to move, 'o' for the other one, and anything else for empty cells.
+ */
+NKPosition fromString(const std::string &_s)
+{
+    NKPosition p;
+
+    for (size_t i = 0; i < _s.size(); ++i)
+    {
+        if (_s[i] == 'x') { p.own   |= 1u << i; }
+        if (_s[i] == 'o') { p.other |= 1u << i; }
+    }
+
+    return p;
+}
+
+TEST(MoveBook, testNKGame)
+{
+    NKGame ttt(3, 3);
+    EXPECT_EQ(ttt.getNumCells(), 9);
+    EXPECT_TRUE (ttt.hasLine(0x054));
+    EXPECT_FALSE(ttt.hasLine(0x0AA));
+    EXPECT_TRUE (ttt.isWinningMove(0x003, 2));
+    EXPECT_FALSE(ttt.isWinningMove(0x003, 5));
+
+    // The center is on most lines, the corners come next
+    EXPECT_EQ(ttt.getMoveOrder()[0], 4);
+    EXPECT_EQ(ttt.getMoveOrder()[1], 0);
+
+    NKGame g(5, 4);
+    EXPECT_EQ(g.getFullMask(), (1u << 25) - 1);
+    EXPECT_TRUE (g.hasLine(0x0000F));          // the first four cells of the first row
+    EXPECT_FALSE(g.hasLine(0x00017));
+    EXPECT_TRUE (g.hasLine(1u << 4 | 1u << 8 | 1u << 12 | 1u << 16));    // anti-diagonal
+
+    NKGame big(9, 12);
+    EXPECT_EQ(big.getN(), MAX_GAME_SIDE);
+    EXPECT_EQ(big.getK(), MAX_GAME_SIDE);
+}
+
+TEST(MoveBook, testSolver)
+{
+    Solver s(NKGame(3, 3));
+
+    // Tic tac toe is a tie
+    SolverResult r = s.solve(NKPosition());
+    EXPECT_EQ(r.score, 0);
+    EXPECT_NE(r.move, -1);
+
+    // A win in one (four empty cells left after it)
+    r = s.solve(fromString("xx.oo...."));
+    EXPECT_EQ(r.move,  2);
+    EXPECT_EQ(r.score, 5);
+
+    // Two threats of the other player cannot be both blocked
+    r = s.solve(fromString("oo.x...oo"));
+    EXPECT_EQ(r.score, -3);
+
+    // Answering a corner in the center holds, in the opposite corner loses
+    r = s.solve(fromString("x...o...."));
+    EXPECT_EQ(r.score, 0);
+    r = s.solve(fromString("x.......o"));
+    EXPECT_GT(r.score, 0);
+
+    // The game is over
+    r = s.solve(fromString("ooo.xx.x."));
+    EXPECT_EQ(r.move, -1);
+    EXPECT_EQ(r.score, -4);
+
+    // On a 4x4 board, three in a row is an easy win for the first player
+    Solver s4(NKGame(4, 3));
+    r = s4.solve(NKPosition());
+    EXPECT_GT(r.score, 0);
+}
+
+TEST(MoveBook, testTranspositionTable)
+{
+    TranspositionTable tt(4);
+    EXPECT_EQ(tt.getNumSlots(), 16U);
+
+    TTEntry e;
+    EXPECT_FALSE(tt.probe(0, e));
+
+    tt.store(0, TTEntry(-3, 8, BOUND_UPPER));
+    tt.store(12345, TTEntry(5, 2, BOUND_EXACT));
+    ASSERT_TRUE(tt.probe(0, e));
+    EXPECT_EQ(e.score, -3);
+    EXPECT_EQ(e.move,   8);
+    EXPECT_EQ(e.bound, BOUND_UPPER);
+    ASSERT_TRUE(tt.probe(12345, e));
+    EXPECT_EQ(e.score, 5);
+    EXPECT_FALSE(tt.probe(54321, e));
+
+    size_t n = 0;
+    for (size_t i = 0; i < tt.getNumSlots(); ++i)
+    {
+        uint64_t key;
+        if (tt.getSlot(i, key, e))
+        {
+            // The stored keys are mixed, but the original ones are recovered
+            EXPECT_TRUE(key == 0 || key == 12345);
+            ++n;
+        }
+    }
+    EXPECT_EQ(n, 2U);
+
+    tt.clear();
+    EXPECT_FALSE(tt.probe(12345, e));
+}
+
+TEST(MoveBook, testParallelSolver)
+{
+    // A single thread is deterministic
+    Solver a(NKGame(4, 4)), b(NKGame(4, 4));
+    SolverResult ra = a.solve(NKPosition());
+    SolverResult rb = b.solve(NKPosition());
+    EXPECT_EQ(ra.score, rb.score);
+    EXPECT_EQ(ra.move,  rb.move);
+    EXPECT_EQ(ra.nodes, rb.nodes);
+
+    // More threads find the same scores
+    Solver p(NKGame(4, 4), 4);
+    EXPECT_EQ(p.getThreads(), 4);
+    EXPECT_EQ(p.solve(NKPosition()).score, ra.score);
+
+    Solver s(NKGame(3, 3)), q(NKGame(3, 3), 3);
+    const char *positions[] = {".........", "x...o....", "x.......o", "xo.......", "xx.oo...."};
+
+    for (size_t i = 0; i < sizeof(positions) / sizeof(positions[0]); ++i)
+    {
+        q.clear();
+        EXPECT_EQ(q.solve(fromString(positions[i])).score, s.solve(fromString(positions[i])).score);
+    }
+}
+
+TEST(MoveBook, testBook)
+{
+    NKGame game(3, 3);
+    Solver s(game);
+    MoveBookWriter writer;
+
+    // All the positions of a tic tac toe game
+    std::vector<NKPosition> positions;
+    positions.push_back(NKPosition());
+
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        SolverResult r = s.solve(positions[i]);
+        if (r.move == -1) { continue; }
+
+        writer.add(positions[i].key(9), BookEntry(r.move, r.score));
+        if (positions[i].numTokens() < 4)
+        {
+            for (int c = 0; c < 9; ++c)
+            {
+                if (((positions[i].own | positions[i].other) & (1u << c)) == 0)
+                {
+                    positions.push_back(positions[i].play(c));
+                }
+            }
+        }
+    }
+    writer.add(0, BookEntry(7, 7));     // a duplicate, ignored
+
+    std::string filename = "/tmp/test_move_book.bin";
+    ASSERT_TRUE(writer.write(filename, 3, 3));
+
+    MoveBook book;
+    ASSERT_TRUE(book.open(filename));
+    EXPECT_EQ(book.getN(), 3);
+    EXPECT_EQ(book.getK(), 3);
+    EXPECT_EQ(book.getNumEntries(), writer.getNumEntries());
+    EXPECT_GT(book.getNumEntries(), 64U);
+
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        SolverResult r = s.solve(positions[i]);
+        BookEntry e;
+
+        EXPECT_EQ(book.lookup(positions[i].key(9), e), r.move != -1);
+        if (r.move != -1)
+        {
+            EXPECT_EQ(e.score, r.score);
+            EXPECT_EQ(e.move,  r.move);
+        }
+    }
+
+    BookEntry e;
+    EXPECT_FALSE(book.lookup(fromString("xxxxx....").key(9), e));
+    EXPECT_FALSE(book.lookup(UINT64_MAX, e));
+
+    book.close();
+    EXPECT_FALSE(book.isOpen());
+    EXPECT_FALSE(book.lookup(0, e));
+
+    // A truncated file is not a book
+    FILE *f = fopen(filename.c_str(), "r+b");
+    ASSERT_TRUE(f != NULL);
+    ASSERT_EQ(ftruncate(fileno(f), 100), 0);
+    fclose(f);
+    EXPECT_FALSE(book.open(filename));
+    EXPECT_FALSE(book.open("/tmp/no_such_book.bin"));
+
+    remove(filename.c_str());
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include "baxter_tictactoe/opponent_model.h"
+
+using namespace baxter_tictactoe;
+
+TEST(OpponentModel, testSkill)
+{
+    OpponentModel model(1.0, 1.0);
+    EXPECT_DOUBLE_EQ(model.getSkill(), 0.5);
+
+    // No chance to win or to block: nothing is learned
+    model.update(BitBoard(cellMask(4), 0), 0);
+    EXPECT_DOUBLE_EQ(model.getSkill(), 0.5);
+    EXPECT_EQ(model.getNumMoves(), 1UL);
+
+    // The robot threatens cell 2, and the opponent blocks it
+    BitBoard threat(cellMask(0) | cellMask(1), cellMask(4));
+    model.update(threat, 2);
+    EXPECT_DOUBLE_EQ(model.getSkill(),     2.0 / 3.0);
+    EXPECT_DOUBLE_EQ(model.getBlockRate(), 2.0 / 3.0);
+
+    // The opponent could win at 5, but it blocks instead: a missed chance
+    model.update(BitBoard(cellMask(0) | cellMask(1), cellMask(3) | cellMask(4)), 2);
+    EXPECT_DOUBLE_EQ(model.getWinRate(), 1.0 / 3.0);
+    EXPECT_DOUBLE_EQ(model.getSkill(),   2.0 / 4.0);
+    EXPECT_DOUBLE_EQ(model.getNumChances(), 2.0);
+
+    model.reset();
+    EXPECT_DOUBLE_EQ(model.getSkill(), 0.5);
+}
+
+TEST(OpponentModel, testDecay)
+{
+    OpponentModel model(1.0, 1.0, 0.5);
+    BitBoard threat(cellMask(0) | cellMask(1), cellMask(4));
+
+    // After missing many chances, a few blocks are enough to raise the estimate
+    for (int i = 0; i < 20; ++i) { model.update(threat, 8); }
+    double low = model.getSkill();
+    EXPECT_LT(low, 0.4);
+
+    for (int i = 0; i < 4; ++i)  { model.update(threat, 2); }
+    EXPECT_GT(model.getSkill(), 0.7);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
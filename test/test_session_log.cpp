@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "baxter_tictactoe/session_log.h"
+
+using namespace baxter_tictactoe;
+
+#define TEST_LOG_FILE   "/tmp/test_session_log.tttlog"
+
+TEST(SessionLog, testWriteRead)
+{
+    SessionWriter w;
+    EXPECT_TRUE(w.open(TEST_LOG_FILE));
+
+    // Records of different sizes, to check for the alignment
+    for (size_t i = 0; i < 100; ++i)
+    {
+        std::string payload(i, 'a' + i%26);
+        EXPECT_TRUE(w.write(i%2?REC_ACTION:REC_SPEECH, 1000 * i, payload.data(), payload.size()));
+    }
+    EXPECT_EQ(w.getNumRecords(), 100);
+    EXPECT_TRUE(w.close());
+
+    SessionReader r;
+    EXPECT_TRUE(r.open(TEST_LOG_FILE));
+    EXPECT_EQ(r.getNumRecords(), 100);
+    EXPECT_EQ(r.getStartStamp(),     0);
+    EXPECT_EQ(r.getEndStamp(),   99000);
+
+    for (size_t i = 0; i < r.getNumRecords(); ++i)
+    {
+        Record rec;
+        EXPECT_TRUE(r.get(i, rec));
+        EXPECT_EQ(rec.type, uint32_t(i%2?REC_ACTION:REC_SPEECH));
+        EXPECT_EQ(rec.stamp_ns, 1000 * i);
+        EXPECT_EQ(rec.size, i);
+        EXPECT_EQ(std::string(reinterpret_cast<const char*>(rec.data), rec.size),
+                  std::string(i, 'a' + i%26));
+    }
+
+    Record rec;
+    EXPECT_FALSE(r.get(100, rec));
+}
+
+TEST(SessionLog, testSeek)
+{
+    SessionWriter w;
+    EXPECT_TRUE(w.open(TEST_LOG_FILE));
+
+    int data = 42;
+    for (size_t i = 0; i < 10; ++i)
+    {
+        EXPECT_TRUE(w.write(REC_BOARD, 10 * (i + 1), &data, sizeof(data)));
+    }
+    // Records out of order are stored with the last stamp
+    EXPECT_TRUE(w.write(REC_BOARD, 5, &data, sizeof(data)));
+    EXPECT_TRUE(w.close());
+
+    SessionReader r;
+    EXPECT_TRUE(r.open(TEST_LOG_FILE));
+    EXPECT_EQ(r.getNumRecords(), 11);
+
+    EXPECT_EQ(r.seek(  0),  0);
+    EXPECT_EQ(r.seek( 10),  0);
+    EXPECT_EQ(r.seek( 11),  1);
+    EXPECT_EQ(r.seek( 55),  5);
+    EXPECT_EQ(r.seek(100),  9);
+    EXPECT_EQ(r.seek(101), 11);
+}
+
+TEST(SessionLog, testRecoverUnclosedLog)
+{
+    {
+        SessionWriter w;
+        EXPECT_TRUE(w.open(TEST_LOG_FILE));
+
+        for (size_t i = 0; i < 5; ++i)
+        {
+            EXPECT_TRUE(w.write(REC_IMAGE, i, "frame", 5));
+        }
+
+        // Simulates a crash by removing the index and its offset from the file
+        EXPECT_TRUE(w.close());
+        FILE *f = fopen(TEST_LOG_FILE, "r+b");
+        ASSERT_TRUE(f != NULL);
+        uint64_t zero = 0;
+        fseek(f, 16, SEEK_SET);  // offset of the index in the header
+        fwrite(&zero, sizeof(zero), 1, f);
+        fclose(f);
+        // header (32 bytes) + 5 * (record header (16 bytes) + padded payload (8 bytes))
+        EXPECT_EQ(truncate(TEST_LOG_FILE, 32 + 5 * 24), 0);
+    }
+
+    SessionReader r;
+    EXPECT_TRUE(r.open(TEST_LOG_FILE));
+    EXPECT_EQ(r.getNumRecords(), 5);
+
+    Record rec;
+    EXPECT_TRUE(r.get(4, rec));
+    EXPECT_EQ(rec.stamp_ns, 4);
+    EXPECT_EQ(rec.type, uint32_t(REC_IMAGE));
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(rec.data), rec.size), "frame");
+
+    remove(TEST_LOG_FILE);
+}
+
+TEST(SessionLog, testCorruptedLog)
+{
+    SessionWriter w;
+    EXPECT_TRUE(w.open(TEST_LOG_FILE));
+    for (size_t i = 0; i < 3; ++i)
+    {
+        EXPECT_TRUE(w.write(REC_SPEECH, i, "hello", 5));
+    }
+    EXPECT_TRUE(w.close());
+
+    // header (32 bytes) + 3 * (record header (16 bytes) + padded payload (8 bytes))
+    const long index_offset = 32 + 3 * 24;
+
+    // An entry of the index that points past the end of the file is refused
+    FILE *f = fopen(TEST_LOG_FILE, "r+b");
+    ASSERT_TRUE(f != NULL);
+    uint64_t far = uint64_t(1) << 40;
+    fseek(f, index_offset + 8, SEEK_SET);   // offset of the first record, in the index
+    fwrite(&far, sizeof(far), 1, f);
+    fclose(f);
+
+    SessionReader r;
+    Record rec;
+    EXPECT_TRUE(r.open(TEST_LOG_FILE));
+    EXPECT_EQ(r.getNumRecords(), 3);
+    EXPECT_FALSE(r.get(0, rec));
+    EXPECT_TRUE (r.get(1, rec));
+    r.close();
+
+    // A number of records that does not fit in the file makes the index to be rebuilt
+    f = fopen(TEST_LOG_FILE, "r+b");
+    ASSERT_TRUE(f != NULL);
+    uint64_t many = uint64_t(1) << 62;
+    fseek(f, 24, SEEK_SET);                 // number of records, in the header
+    fwrite(&many, sizeof(many), 1, f);
+    fclose(f);
+
+    EXPECT_TRUE(r.open(TEST_LOG_FILE));
+    EXPECT_EQ(r.getNumRecords(), 3);
+    EXPECT_TRUE(r.get(0, rec));
+    EXPECT_EQ(rec.stamp_ns, 0);
+
+    remove(TEST_LOG_FILE);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "baxter_tictactoe/stats_store.h"
+
+using namespace std;
+using namespace baxter_tictactoe;
+
+#define TEST_STATS_DIR  "/tmp/test_stats_store"
+
+namespace
+{
+    vector<string> testColumns()
+    {
+        vector<string> cols;
+        cols.push_back("outcome");
+        cols.push_back("think_time");
+        return cols;
+    }
+
+    void removeTable(const string &_table)
+    {
+        unlink((string(TEST_STATS_DIR) + "/" + _table + ".schema").c_str());
+        unlink((string(TEST_STATS_DIR) + "/" + _table + ".stamp.col").c_str());
+        unlink((string(TEST_STATS_DIR) + "/" + _table + ".outcome.col").c_str());
+        unlink((string(TEST_STATS_DIR) + "/" + _table + ".think_time.col").c_str());
+    }
+}
+
+TEST(StatsStore, testAppendQuery)
+{
+    removeTable("moves");
+
+    // Rows are appended across two sessions
+    for (int s = 0; s < 2; ++s)
+    {
+        StatsWriter w;
+        ASSERT_TRUE(w.open(TEST_STATS_DIR, "moves", testColumns()));
+        EXPECT_EQ(w.getNumRows(), uint64_t(50 * s));
+
+        for (int i = 50 * s; i < 50 * (s + 1); ++i)
+        {
+            vector<double> row;
+            row.push_back(i % 3);
+            row.push_back(i * 0.5);
+            EXPECT_TRUE(w.append(1000 * i, row));
+        }
+
+        // Rows with the wrong number of values are refused
+        EXPECT_FALSE(w.append(1000 * 100, vector<double>(1, 0.0)));
+    }
+
+    StatsReader r;
+    ASSERT_TRUE(r.open(TEST_STATS_DIR, "moves"));
+    EXPECT_EQ(r.getNumRows(),    100UL);
+    EXPECT_EQ(r.getNumColumns(),   2UL);
+    EXPECT_EQ(r.getColumnName(1), "think_time");
+
+    StatsSummary all = r.summarize("think_time");
+    EXPECT_EQ(all.count, 100UL);
+    EXPECT_DOUBLE_EQ(all.min,  0.0);
+    EXPECT_DOUBLE_EQ(all.max, 49.5);
+    EXPECT_DOUBLE_EQ(all.mean(), 24.75);
+
+    // Time ranges are [from, to)
+    StatsSummary some = r.summarize("think_time", 10000, 20000);
+    EXPECT_EQ(some.count, 10UL);
+    EXPECT_DOUBLE_EQ(some.min, 5.0);
+    EXPECT_DOUBLE_EQ(some.max, 9.5);
+
+    EXPECT_EQ(r.count("outcome", 0.0),             34UL);
+    EXPECT_EQ(r.count("outcome", 2.0, 0, 30000),   10UL);
+    EXPECT_EQ(r.seek(50500),                       51UL);
+    EXPECT_EQ(r.seek(1000000),                    100UL);
+
+    // Rows filtered by the value of another column (outcome 1 for i = 1, 4, ..., 28)
+    StatsSummary ones = r.summarize("think_time", "outcome", 1.0, 0, 30000);
+    EXPECT_EQ(ones.count, 10UL);
+    EXPECT_DOUBLE_EQ(ones.min,  0.5);
+    EXPECT_DOUBLE_EQ(ones.max, 14.0);
+
+    EXPECT_TRUE(r.getValues("missing") == NULL);
+    EXPECT_EQ(r.summarize("missing").count, 0UL);
+}
+
+TEST(StatsStore, testSchemaAndRecovery)
+{
+    removeTable("games");
+
+    StatsWriter w;
+    ASSERT_TRUE(w.open(TEST_STATS_DIR, "games", testColumns()));
+    EXPECT_TRUE(w.append(10, vector<double>(2, 1.0)));
+    EXPECT_TRUE(w.append( 5, vector<double>(2, 2.0)));
+    w.close();
+
+    // The columns of an existing table cannot change
+    vector<string> other = testColumns();
+    other.push_back("glitches");
+    EXPECT_FALSE(w.open(TEST_STATS_DIR, "games", other));
+
+    // A row that was only partially written is discarded
+    FILE *f = fopen(TEST_STATS_DIR "/games.outcome.col", "ab");
+    ASSERT_TRUE(f != NULL);
+    double v = 3.0;
+    fwrite(&v, sizeof(v), 1, f);
+    fclose(f);
+
+    StatsReader r;
+    ASSERT_TRUE(r.open(TEST_STATS_DIR, "games"));
+    EXPECT_EQ(r.getNumRows(), 2UL);
+
+    // Rows out of order are stored with the last stamp
+    EXPECT_EQ(r.getStamps()[1], 10UL);
+    r.close();
+
+    ASSERT_TRUE(w.open(TEST_STATS_DIR, "games", testColumns()));
+    EXPECT_EQ(w.getNumRows(), 2UL);
+    EXPECT_TRUE(w.append(20, vector<double>(2, 4.0)));
+    w.close();
+
+    ASSERT_TRUE(r.open(TEST_STATS_DIR, "games"));
+    EXPECT_EQ(r.getNumRows(), 3UL);
+    EXPECT_DOUBLE_EQ(r.getValues("outcome")[2], 4.0);
+
+    EXPECT_FALSE(r.open(TEST_STATS_DIR, "missing"));
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "baxter_tictactoe/strategy.h"
+
+using namespace baxter_tictactoe;
+
+// Builds a board from a string of 9 cells: 'r' robot (blue), 'o' opponent (red), anything else empty
+Board fromString(const std::string &_s)
+{
+    Board b(9);
+    for (int i = 0; i < 9; ++i)
+    {
+        if (_s[i] == 'r') { b.setCellState(i, COL_BLUE); }
+        if (_s[i] == 'o') { b.setCellState(i,  COL_RED); }
+    }
+    return b;
+}
+
+/**
+ * A strategy that always plays the last empty cell, whose offset must not be negative.
+ */
+class LastCellStrategy : public Strategy
+{
+protected:
+    StrategyMove chooseMove(const StrategyContext &_ctx)
+    {
+        BitMask m = _ctx.board->legalMoves();
+        return StrategyMove(m == 0 ? -1 : 31 - __builtin_clz(m), false, "Last");
+    }
+
+public:
+    int offset;
+
+    LastCellStrategy(const std::string &_name) : Strategy(_name), offset(0) {};
+
+    bool configure(const StrategyConfig &_config)
+    {
+        offset = int(getConfig(_config, "offset", offset));
+        return offset >= 0;
+    }
+};
+
+/**
+ * A strategy that takes its time: it reports a move (if any), and returns another one later.
+ */
+class SlowStrategy : public Strategy
+{
+protected:
+    StrategyMove chooseMove(const StrategyContext &_ctx)
+    {
+        if (reported != -1) { _ctx.report(StrategyMove(reported, false, "Reported")); }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+        return StrategyMove(8, false, "Slow");
+    }
+
+public:
+    int reported;
+    int delay_ms;
+
+    SlowStrategy(int _reported, int _delay_ms) : Strategy("slow"), reported(_reported), delay_ms(_delay_ms) {};
+};
+
+TEST(Strategy, testHeuristics)
+{
+    std::mt19937 rng(42);
+    Board board = fromString("rr.oo....");
+
+    StrategyContext ctx;
+    ctx.board = &board;
+    ctx.rng   = &rng;
+
+    EXPECT_EQ(  victoryMove(ctx), 2);
+    EXPECT_EQ(defensiveMove(ctx), 5);
+    EXPECT_EQ(     bookMove(ctx), -1);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        int c = randomMove(ctx);
+        EXPECT_TRUE(c >= 0 && c < 9);
+        EXPECT_TRUE(board.getCell(c).getState() == COL_EMPTY);
+    }
+
+    Board full = fromString("rorroorro");
+    ctx.board  = &full;
+    EXPECT_EQ(randomMove(ctx), -1);
+
+    StrategyConfig config;
+    config["a"] = "0.25";
+    config["b"] = "many";
+    EXPECT_EQ(getConfig(config, "a", 1.0), 0.25);
+    EXPECT_EQ(getConfig(config, "b", 1.0),  1.0);
+    EXPECT_EQ(getConfig(config, "c", 2.0),  2.0);
+}
+
+TEST(Strategy, testBuiltins)
+{
+    StrategyRegistry registry;
+    std::vector<std::string> names = registry.getNames();
+    ASSERT_EQ(names.size(), 4U);
+    EXPECT_EQ(names[0], "adaptive");
+    EXPECT_EQ(names[3],    "smart");
+    EXPECT_TRUE(registry.create("minimax") == NULL);
+
+    std::mt19937    rng(42);
+    CheatingPlanner planner(1.0);
+    Board           board = fromString("or.rro.oo");
+
+    StrategyContext ctx;
+    ctx.board    = &board;
+    ctx.planner  = &planner;
+    ctx.rng      = &rng;
+    ctx.last_opp = 7;
+
+    // The smart strategy has to block, the cheating one wins by overwriting a token instead
+    std::unique_ptr<Strategy> smart = registry.create("smart");
+    ASSERT_TRUE(smart != NULL);
+    EXPECT_EQ(smart->getName(), "smart");
+    StrategyMove m = smart->move(ctx);
+    EXPECT_EQ(m.cell, 2);
+    EXPECT_FALSE(m.cheat);
+    EXPECT_EQ(m.reason, "Defensive");
+
+    std::unique_ptr<Strategy> cheating = registry.create("cheating");
+    m = cheating->move(ctx);
+    EXPECT_EQ(m.cell, 5);
+    EXPECT_TRUE(m.cheat);
+
+    // Cheats are only performed if they are (almost) sure wins
+    StrategyConfig config;
+    config["cheat_min_value"] = "1.1";
+    EXPECT_TRUE(cheating->configure(config));
+    EXPECT_FALSE(cheating->move(ctx).cheat);
+    EXPECT_EQ(cheating->getStats().moves,  2U);
+    EXPECT_EQ(cheating->getStats().cheats, 1U);
+
+    // Against a perfect opponent, the adaptive strategy always plays the strongest move
+    Board empty(9);
+    ctx.board     = &empty;
+    ctx.opp_skill = 1.0;
+    std::unique_ptr<Strategy> adaptive = registry.create("adaptive");
+    EXPECT_EQ(adaptive->move(ctx).reason, "Strongest");
+
+    std::unique_ptr<Strategy> random = registry.create("random");
+    EXPECT_NE(random->move(ctx).cell, -1);
+    EXPECT_EQ(random->getStats().failures, 0U);
+    random->resetStats();
+    EXPECT_EQ(random->getStats().moves, 0U);
+}
+
+TEST(Strategy, testRegistry)
+{
+    StrategyRegistry registry;
+
+    EXPECT_TRUE (registry.add("last", [](const std::string &_n) { return new LastCellStrategy(_n); }));
+    EXPECT_FALSE(registry.add("last", [](const std::string &_n) { return new LastCellStrategy(_n); }));
+    EXPECT_FALSE(registry.add("smart", [](const std::string &_n) { return new LastCellStrategy(_n); }));
+    EXPECT_TRUE(registry.has("last"));
+
+    std::unique_ptr<Strategy> s = registry.create("last");
+    ASSERT_TRUE(s != NULL);
+    EXPECT_EQ(s->getName(),        "last");
+    EXPECT_EQ(s->getDescription(), "last");
+
+    StrategyConfig config;
+    config["offset"] = "-1";
+    EXPECT_FALSE(s->configure(config));
+
+    Board board = fromString("rr.oo..o.");
+    StrategyContext ctx;
+    ctx.board = &board;
+    EXPECT_EQ(s->move(ctx).cell, 8);
+
+    // Libraries that are not plug-ins are refused
+    EXPECT_FALSE(registry.loadPlugin("/no/such/plugin.so"));
+    EXPECT_FALSE(registry.loadPlugin("libm.so.6"));
+    EXPECT_EQ(registry.getNames().size(), 5U);
+}
+
+TEST(Strategy, testRunner)
+{
+    StrategyRunner runner(42);
+    Board board = fromString("rr.oo....");
+
+    StrategyContext ctx;
+    ctx.board       = &board;
+    ctx.time_budget = 0.05;
+
+    // In time
+    SlowStrategy fast(-1, 0);
+    EXPECT_EQ(runner.run(fast, ctx).cell, 8);
+    EXPECT_EQ(runner.getNumOverruns(), 0U);
+
+    // Late, with a move reported in time
+    SlowStrategy late(6, 300);
+    StrategyMove m = runner.run(late, ctx);
+    EXPECT_EQ(m.cell, 6);
+    EXPECT_EQ(m.reason, "Reported");
+    EXPECT_EQ(runner.getNumOverruns(), 1U);
+    EXPECT_EQ(runner.getNumAnytime(),  1U);
+    EXPECT_LT(runner.getLatency().getMax(), 0.25);
+
+    // The late strategy is still running, so the fallback move is played right away
+    EXPECT_TRUE(runner.isBusy());
+    m = runner.run(fast, ctx);
+    EXPECT_EQ(m.cell, 2);
+    EXPECT_EQ(m.reason, "Victory");
+    EXPECT_EQ(runner.getNumFallbacks(), 1U);
+
+    runner.wait();
+    EXPECT_FALSE(runner.isBusy());
+    EXPECT_EQ(late.getStats().moves, 1U);
+
+    // Late, with an unplayable move reported
+    SlowStrategy wrong(0, 300);
+    EXPECT_EQ(runner.run(wrong, ctx).cell, 2);
+    EXPECT_EQ(runner.getNumOverruns(),  2U);
+    EXPECT_EQ(runner.getNumFallbacks(), 2U);
+    runner.wait();
+
+    // Without a time budget the strategy is waited for
+    ctx.time_budget = 0.0;
+    EXPECT_EQ(runner.run(late, ctx).cell, 8);
+    EXPECT_EQ(runner.getNumMoves(),    5U);
+    EXPECT_EQ(runner.getNumOverruns(), 2U);
+
+    runner.resetStats();
+    EXPECT_EQ(runner.getNumMoves(), 0U);
+    EXPECT_EQ(runner.getLatency().getCount(), 0U);
+
+    // The built-in strategies report a safe move before planning
+    CheatingPlanner planner;
+    AnytimeMove     best;
+    Board           empty(9);
+    ctx.board   = &empty;
+    ctx.planner = &planner;
+    ctx.best    = &best;
+
+    StrategyRegistry registry;
+    std::unique_ptr<Strategy> cheating = registry.create("cheating");
+    cheating->move(ctx);
+    EXPECT_TRUE(isPlayable(ctx, best.get()));
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
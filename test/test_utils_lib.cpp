@@ -1,9 +1,30 @@
 #include <gtest/gtest.h>
 
+#include <new>
+#include <thread>
+#include <cstdlib>
+#include <unordered_set>
+
 #include "baxter_tictactoe/tictactoe_utils.h"
 
 using namespace baxter_tictactoe;
 
+// Number of heap allocations so far, to check the allocation-free paths
+static size_t n_allocs = 0;
+
+void* operator new(size_t _size)
+{
+    ++n_allocs;
+    void *p = malloc(_size);
+    if (p == NULL) { throw std::bad_alloc(); }
+    return p;
+}
+
+void operator delete(void *_p) noexcept
+{
+    free(_p);
+}
+
 // Declare a test
 TEST(UtilsLib, testCellClass)
 {
@@ -97,6 +118,53 @@ TEST(UtilsLib, testCellClass)
     EXPECT_EQ(c.getState(), COL_BLUE);
 }
 
+TEST(UtilsLib, testPolygon)
+{
+    Contour square;
+    square.push_back(cv::Point( 0,  0));
+    square.push_back(cv::Point(10,  0));
+    square.push_back(cv::Point(10, 10));
+    square.push_back(cv::Point( 0, 10));
+
+    Polygon p(square);
+    ASSERT_EQ(p.size(), 4U);
+    EXPECT_EQ(p[2], cv::Point(10, 10));
+    EXPECT_TRUE(p.toContour() == square);
+
+    // The matrix header wraps the points of the polygon, without copying them
+    cv::Mat m = p.getMat();
+    EXPECT_EQ(m.rows, 4);
+    EXPECT_EQ(m.type(), CV_32SC2);
+    EXPECT_EQ(m.at<cv::Point>(1, 0), cv::Point(10, 0));
+
+    // Points beyond the capacity are dropped
+    Contour many(POLYGON_MAX_POINTS + 2, cv::Point(1, 2));
+    Polygon q(many);
+    EXPECT_EQ(q.size(), size_t(POLYGON_MAX_POINTS));
+    EXPECT_FALSE(q.push_back(cv::Point(3, 4)));
+    q.clear();
+    EXPECT_TRUE(q.empty());
+
+    Cell c(p, COL_RED, 5, 0);
+    EXPECT_EQ(c.getContourArea(), 100);
+    EXPECT_EQ(c.getCentroid(), cv::Point(5, 5));
+
+    Board a;
+    for (int i = 0; i < NUMBER_OF_CELLS; ++i) { EXPECT_TRUE(a.addCell(c)); }
+    EXPECT_FALSE(a.addCell(c));
+    EXPECT_EQ(a.getBoundingRect(), cv::Rect(0, 0, 11, 11));
+
+    // Boards with contours are copied without touching the heap, too
+    size_t before = n_allocs;
+    Board b(a);
+    Board d;
+    d = b;
+    EXPECT_EQ(n_allocs, before);
+
+    EXPECT_TRUE(d == a);
+    EXPECT_EQ(d.getCellContour(8)[3], cv::Point(0, 10));
+}
+
 TEST(UtilsLib, testBoardClass)
 {
     // Testing empty constructor
@@ -282,6 +350,170 @@ TEST(UtilsLib, testBoardNoCheating)
     }
 }
 
+TEST(UtilsLib, testBoardNoAllocations)
+{
+    baxter_tictactoe::MsgBoard msg;
+    for (size_t i = 0; i < 9; ++i) { msg.cells[i].state = COL_EMPTY; }
+    msg.cells[0].state = COL_RED;
+    msg.cells[4].state = COL_BLUE;
+
+    Board a(9), b(9);
+    a.fromMsgBoard(msg);
+    b.fromMsgBoard(msg);
+
+    // Copying a board onto another one of the same size, updating it from a message,
+    // and moving it around are all done without touching the heap
+    msg.cells[8].state = COL_RED;
+    size_t before = n_allocs;
+
+    b = a;
+    a.fromMsgBoard(msg);
+    Board c(std::move(a));
+    a = std::move(b);
+    b = std::move(c);
+
+    EXPECT_EQ(n_allocs, before);
+
+    EXPECT_EQ(a.getCellState(0), COL_RED);
+    EXPECT_EQ(a.getCellState(8), COL_EMPTY);
+    EXPECT_EQ(b.getCellState(4), COL_BLUE);
+    EXPECT_EQ(b.getCellState(8), COL_RED);
+    EXPECT_EQ(b.getCellAreaRed(8), 1);
+    EXPECT_EQ(b.getNumCells(), 9U);
+
+    // Invalid states are skipped
+    msg.cells[2].state = "foo";
+    b.fromMsgBoard(msg);
+    EXPECT_EQ(b.getNumCells(), 8U);
+}
+
+TEST(UtilsLib, testConstBoardQueries)
+{
+    Board b(9);
+    b.setCellState(0, COL_RED);
+    b.setCellState(4, COL_RED);
+    b.setCellState(8, COL_RED);
+    b.setCellState(2, COL_BLUE);
+
+    // Several readers can query the same board without copying it
+    const Board &cb = b;
+    std::vector<std::thread> readers;
+    std::vector<int>         results(4, 0);
+
+    for (size_t t = 0; t < results.size(); ++t)
+    {
+        readers.push_back(std::thread([&cb, &results, t]()
+        {
+            bool ok = true;
+            for (int k = 0; k < 1000; ++k)
+            {
+                ok = ok && cb.threeInARow(COL_RED) && not cb.threeInARow(COL_BLUE);
+                ok = ok && cb.getNumTokens() == 4 && cb.getNumTokens(COL_BLUE) == 1;
+                ok = ok && not cb.isFull() && not cb.isEmpty();
+                ok = ok && cb.getCellState(2) == COL_BLUE;
+                ok = ok && cb.toMsgBoard().cells[4].state == COL_RED;
+            }
+            results[t] = ok ? 1 : 0;
+        }));
+    }
+
+    for (size_t t = 0; t < readers.size(); ++t) { readers[t].join(); }
+
+    for (size_t t = 0; t < results.size(); ++t) { EXPECT_EQ(results[t], 1); }
+
+    Board c(cb);
+    c.setCellState(1, COL_BLUE);
+    EXPECT_TRUE (cb.isOneTokenAdded(c, COL_BLUE));
+    EXPECT_FALSE(cb.isOneTokenRemoved(c, COL_BLUE));
+    EXPECT_EQ(cb.toString(), "red\tempty\tblue\tempty\tred\tempty\tempty\tempty\tred");
+}
+
+TEST(UtilsLib, testBoardMoves)
+{
+    Board b(9);
+    EXPECT_EQ(b.legalMoves(), BOARD_MASK);
+
+    EXPECT_TRUE (b.play(0, COL_RED));
+    EXPECT_FALSE(b.play(0, COL_BLUE));
+    EXPECT_FALSE(b.play(1, COL_EMPTY));
+    EXPECT_FALSE(b.play(9, COL_RED));
+    EXPECT_TRUE (b.play(4, COL_BLUE));
+    EXPECT_TRUE (b.play(1, COL_RED));
+
+    EXPECT_EQ(b.legalMoves(), BOARD_MASK & ~0x013);
+    EXPECT_EQ(b.getCells(COL_RED),  0x003);
+    EXPECT_EQ(b.getCells(COL_BLUE), 0x010);
+    EXPECT_EQ(b.getCells("green"),  0x000);
+
+    // Only the move that completes the line wins, and the board is left untouched
+    EXPECT_TRUE (b.wouldWin(2, COL_RED));
+    EXPECT_FALSE(b.wouldWin(2, COL_BLUE));
+    EXPECT_FALSE(b.wouldWin(3, COL_RED));
+    EXPECT_FALSE(b.wouldWin(1, COL_RED));
+    EXPECT_EQ(b.getCellState(2), COL_EMPTY);
+
+    size_t n = 0;
+    for (BitMask m = b.legalMoves(); m != 0; m &= m - 1)
+    {
+        EXPECT_EQ(b.getCellState(lowestCell(m)), COL_EMPTY);
+        ++n;
+    }
+    EXPECT_EQ(n, 6U);
+
+    EXPECT_TRUE (b.undo(1));
+    EXPECT_FALSE(b.undo(1));
+    EXPECT_FALSE(b.wouldWin(2, COL_RED));
+    EXPECT_EQ(b.getNumTokens(), 2U);
+}
+
+TEST(UtilsLib, testBoardHash)
+{
+    Board a(9), b(9);
+    EXPECT_EQ(a.getHash(), 0U);
+
+    // The same position reached in different orders has the same hash
+    a.play(0, COL_RED);  a.play(4, COL_BLUE); a.play(8, COL_RED);
+    b.play(8, COL_RED);  b.play(4, COL_BLUE); b.play(0, COL_RED);
+    EXPECT_EQ(a.getHash(), b.getHash());
+    EXPECT_NE(a.getHash(), 0U);
+    EXPECT_TRUE(a == b);
+
+    // Colors and cells matter
+    b.setCellState(8, COL_BLUE);
+    EXPECT_NE(a.getHash(), b.getHash());
+    EXPECT_TRUE(a != b);
+    b.undo(8);
+    b.play(7, COL_RED);
+    EXPECT_NE(a.getHash(), b.getHash());
+
+    // Invalid states leave the hash alone, and undoing restores it
+    uint64_t h = b.getHash();
+    EXPECT_FALSE(b.setCellState(7, "foo"));
+    EXPECT_EQ(b.getHash(), h);
+    b.undo(7);
+    b.play(8, COL_RED);
+    EXPECT_EQ(a.getHash(), b.getHash());
+
+    // A board from a message has the same hash as one built move by move
+    Board c;
+    c.fromMsgBoard(a.toMsgBoard());
+    EXPECT_EQ(c.getHash(), a.getHash());
+
+    Board d(std::move(c));
+    EXPECT_EQ(d.getHash(), a.getHash());
+    EXPECT_EQ(c.getHash(), 0U);
+
+    d.resetCellStates();
+    EXPECT_EQ(d.getHash(), 0U);
+
+    std::unordered_set<Board> seen;
+    seen.insert(a);
+    seen.insert(b);
+    seen.insert(d);
+    EXPECT_EQ(seen.size(), 2U);
+    EXPECT_EQ(seen.count(Board(9)), 1U);
+}
+
 // Run all the tests that were declared with TEST()
 int main(int argc, char **argv)
 {
@@ -0,0 +1,429 @@
+#include <gtest/gtest.h>
+
+#include <limits.h>
+#include <math.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "baxter_tictactoe/vision_utils.h"
+
+using namespace baxter_tictactoe;
+
+/**
+ * Creates a 3x3 board whose cells are squares of side _side pixels,
+ * separated by _gap pixels and starting at (_x0, _y0).
+ */
+Board squareBoard(int _x0, int _y0, int _side, int _gap)
+{
+    Board b;
+
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            int x = _x0 + c * (_side + _gap);
+            int y = _y0 + r * (_side + _gap);
+
+            Contour contour;
+            contour.push_back(cv::Point(x        , y        ));
+            contour.push_back(cv::Point(x + _side, y        ));
+            contour.push_back(cv::Point(x + _side, y + _side));
+            contour.push_back(cv::Point(x        , y + _side));
+            b.addCell(Cell(contour));
+        }
+    }
+
+    return b;
+}
+
+TEST(VisionUtils, testColorClassifier)
+{
+    // Red hue wraps around 180
+    hsvColorRange red (colorRange(160, 20), colorRange(40, 255), colorRange(40, 255));
+    hsvColorRange blue(colorRange( 90,130), colorRange(70, 255), colorRange(70, 255));
+
+    Board board = squareBoard(100, 50, 40, 10);
+
+    cv::Mat hsv(240, 320, CV_8UC3, cv::Scalar(0, 0, 0));
+
+    // A red token (with the two sides of the hue range) in cell 1, a blue one in cell 5
+    cv::rectangle(hsv, cv::Rect(105, 55, 15, 30), cv::Scalar(170, 200, 200), CV_FILLED);
+    cv::rectangle(hsv, cv::Rect(120, 55, 15, 30), cv::Scalar( 10, 200, 200), CV_FILLED);
+    cv::rectangle(hsv, cv::Rect(155,105, 30, 30), cv::Scalar(110, 200, 200), CV_FILLED);
+
+    // Red pixels outside the board, and on the grid lines
+    cv::rectangle(hsv, cv::Rect( 10, 10, 30, 30), cv::Scalar(170, 200, 200), CV_FILLED);
+    cv::rectangle(hsv, cv::Rect(141, 50,  8, 40), cv::Scalar(170, 200, 200), CV_FILLED);
+
+    ColorClassifier classifier;
+    classifier.setColors(red, blue);
+
+    cv::Mat img_red, img_blue;
+    EXPECT_FALSE(classifier.classify(hsv, img_red, img_blue));
+
+    EXPECT_TRUE(classifier.setBoard(board, hsv.size()));
+    EXPECT_EQ(classifier.getRoi(), cv::Rect(100, 50, 141, 141));
+
+    EXPECT_TRUE(classifier.classify(hsv, img_red, img_blue));
+    EXPECT_EQ(img_red.size(),  hsv.size());
+    EXPECT_EQ(img_blue.size(), hsv.size());
+
+    EXPECT_EQ(cv::countNonZero(img_red),  30 * 30);
+    EXPECT_EQ(cv::countNonZero(img_blue), 30 * 30);
+    EXPECT_EQ(cv::countNonZero(img_red (cv::Rect(105, 55, 30, 30))), 30 * 30);
+    EXPECT_EQ(cv::countNonZero(img_blue(cv::Rect(155,105, 30, 30))), 30 * 30);
+
+    // Moving the board clears the previous region of the outputs. The red square
+    // outside the board now overlaps with cells 1, 2, 4 and 5 of the new board.
+    Board moved = squareBoard(0, 0, 20, 5);
+    EXPECT_TRUE(classifier.setBoard(moved, hsv.size()));
+    EXPECT_TRUE(classifier.classify(hsv, img_red, img_blue));
+    EXPECT_EQ(cv::countNonZero(img_red),  11 * 11 + 2 * 11 * 15 + 15 * 15);
+    EXPECT_EQ(cv::countNonZero(img_blue),       0);
+}
+
+TEST(VisionUtils, testBoardDetector)
+{
+    hsvColorRange red (colorRange(160, 20), colorRange(40, 255), colorRange(40, 255));
+    hsvColorRange blue(colorRange( 90,130), colorRange(70, 255), colorRange(70, 255));
+
+    // A red token in cell 1, a blue one in cell 5, and a red spot too small to count in cell 9
+    cv::Mat img(240, 320, CV_8UC3, cv::Scalar(200, 200, 200));
+    cv::rectangle(img, cv::Rect(105, 55, 30, 30), cv::Scalar( 50,  50, 170), CV_FILLED);
+    cv::rectangle(img, cv::Rect(155,105, 30, 30), cv::Scalar(170,  60,  40), CV_FILLED);
+    cv::rectangle(img, cv::Rect(210,160,  6,  6), cv::Scalar( 50,  50, 170), CV_FILLED);
+
+    for (int l = 0; l <= 2; ++l)
+    {
+        int s = 1 << l;
+        BoardDetector detector(l, 400);
+        detector.setColors(red, blue);
+
+        EXPECT_EQ(detector.getScale(),          1.0 / s);
+        EXPECT_EQ(detector.getAreaThreshold(), 400.0 / (s * s));
+        EXPECT_EQ(detector.toFullRes(cv::Point(10, 20)), cv::Point(10 * s, 20 * s));
+
+        Board board = squareBoard(100 / s, 50 / s, 40 / s, 10 / s);
+        EXPECT_FALSE(detector.detect(img, board));
+
+        EXPECT_TRUE(detector.setBoard(board, cv::Size(img.cols / s, img.rows / s)));
+        EXPECT_TRUE(detector.detect(img, board));
+        EXPECT_EQ(detector.getRedMask().size(), cv::Size(img.cols / s, img.rows / s));
+
+        for (size_t i = 0; i < board.getNumCells(); ++i)
+        {
+            std::string state = i == 0 ? COL_RED : i == 4 ? COL_BLUE : COL_EMPTY;
+            EXPECT_EQ(board.getCellState(i), state) << "cell " << i << " at level " << l;
+        }
+    }
+}
+
+TEST(VisionUtils, testBoardDetectorIntegral)
+{
+    hsvColorRange red (colorRange(160, 20), colorRange(40, 255), colorRange(40, 255));
+    hsvColorRange blue(colorRange( 90,130), colorRange(70, 255), colorRange(70, 255));
+
+    // A red token in cell 1, a blue one in cell 9, and a red one straddling cells 5 and 6
+    cv::Mat img(240, 320, CV_8UC3, cv::Scalar(200, 200, 200));
+    cv::rectangle(img, cv::Rect(105, 55, 30, 30), cv::Scalar( 50,  50, 170), CV_FILLED);
+    cv::rectangle(img, cv::Rect(205,155, 30, 30), cv::Scalar(170,  60,  40), CV_FILLED);
+    cv::rectangle(img, cv::Rect(180,105, 30, 30), cv::Scalar( 50,  50, 170), CV_FILLED);
+
+    Board board = squareBoard(100, 50, 40, 10);
+
+    // Within the contours, the straddling token is big enough for cell 5
+    BoardDetector contours(0, 300);
+    contours.setColors(red, blue);
+    EXPECT_TRUE(contours.setBoard(board, img.size()));
+    EXPECT_TRUE(contours.detect(img, board));
+    EXPECT_EQ(board.getCellState(4), COL_RED);
+
+    // Within the central part of the rectified cells, it is not
+    BoardDetector integral(0, 300);
+    integral.setColors(red, blue);
+    integral.setMode(DETECT_INTEGRAL, 0.6);
+    EXPECT_EQ(integral.getMode(), DETECT_INTEGRAL);
+    EXPECT_TRUE(integral.setBoard(board, img.size()));
+    EXPECT_TRUE(integral.detect(img, board));
+
+    for (size_t i = 0; i < board.getNumCells(); ++i)
+    {
+        std::string state = i == 0 ? COL_RED : i == 8 ? COL_BLUE : COL_EMPTY;
+        EXPECT_EQ(board.getCellState(i), state) << "cell " << i;
+    }
+
+    // The rectified board is a 3x3 grid of cells as big as the original ones
+    EXPECT_EQ(integral.getRedMask().size(), cv::Size(120, 120));
+    // The token covers all the counted square, so it reads as much as the whole cell
+    EXPECT_NEAR(board.getCellAreaRed(0), 40 * 40, 40 * 4);
+}
+
+TEST(VisionUtils, testBoardDetectorIntegralAreas)
+{
+    hsvColorRange red (colorRange(160, 20), colorRange(40, 255), colorRange(40, 255));
+    hsvColorRange blue(colorRange( 90,130), colorRange(70, 255), colorRange(70, 255));
+
+    // A token that fills most of cell 1
+    cv::Mat img(240, 320, CV_8UC3, cv::Scalar(200, 200, 200));
+    cv::rectangle(img, cv::Rect(101, 51, 38, 38), cv::Scalar( 50,  50, 170), CV_FILLED);
+
+    Board board = squareBoard(100, 50, 40, 10);
+
+    BoardDetector contours(0, 650);
+    contours.setColors(red, blue);
+    EXPECT_TRUE(contours.setBoard(board, img.size()));
+    EXPECT_TRUE(contours.detect(img, board));
+    ASSERT_EQ(board.getCellState(0), COL_RED);
+    double area = board.getCellAreaRed(0);
+
+    // The same token reads a comparable area in both modes, so the same threshold applies
+    BoardDetector integral(0, 650);
+    integral.setColors(red, blue);
+    integral.setMode(DETECT_INTEGRAL, 0.6);
+    EXPECT_TRUE(integral.setBoard(board, img.size()));
+    EXPECT_TRUE(integral.detect(img, board));
+    ASSERT_EQ(board.getCellState(0), COL_RED);
+    EXPECT_NEAR(board.getCellAreaRed(0), area, area * 0.2);
+}
+
+/**
+ * Draws a 3x3 board of white square cells on a black image, rotated by _angle degrees
+ * around _center, and returns the centroids of the cells in the order they are drawn.
+ */
+std::vector<cv::Point2d> drawRotatedBoard(cv::Mat &_img, cv::Point2d _center, double _angle,
+                                          double _pitch, double _side)
+{
+    double t = _angle * CV_PI / 180.0;
+    cv::Point2d u( cos(t), sin(t));
+    cv::Point2d v(-sin(t), cos(t));
+
+    std::vector<cv::Point2d> centroids;
+
+    for (int j = -1; j <= 1; ++j)
+    {
+        for (int i = -1; i <= 1; ++i)
+        {
+            cv::Point2d c = _center + u * (i * _pitch) + v * (j * _pitch);
+            cv::Point corners[4];
+
+            for (int k = 0; k < 4; ++k)
+            {
+                double su = (k == 0 || k == 3) ? -0.5 : 0.5;
+                double sv = (k < 2)            ? -0.5 : 0.5;
+                cv::Point2d p = c + u * (su * _side) + v * (sv * _side);
+                corners[k] = cv::Point(cvRound(p.x), cvRound(p.y));
+            }
+
+            cv::fillConvexPoly(_img, corners, 4, cv::Scalar(255));
+            centroids.push_back(c);
+        }
+    }
+
+    return centroids;
+}
+
+TEST(VisionUtils, testFitBoardGrid)
+{
+    // Boards rotated by 90 degrees are the same board: the cell order only
+    // depends on the rotation modulo 90 degrees
+    double angles[] = {0.0, 30.0, 120.0, -40.0, 200.0};
+
+    for (size_t a = 0; a < sizeof(angles) / sizeof(angles[0]); ++a)
+    {
+        cv::Mat img = cv::Mat::zeros(400, 500, CV_8UC1);
+        std::vector<cv::Point2d> centroids = drawRotatedBoard(img, cv::Point2d(250, 200),
+                                                              angles[a], 60, 48);
+
+        // Some distractors: blobs that are not squares, or too small, or far from the grid
+        cv::circle   (img, cv::Point(30, 30), 20, cv::Scalar(255), CV_FILLED);
+        cv::rectangle(img, cv::Rect(450, 20, 6, 6),   cv::Scalar(255), CV_FILLED);
+        cv::rectangle(img, cv::Rect(420, 330, 45, 45), cv::Scalar(255), CV_FILLED);
+
+        Board board;
+        double quality = fitBoardGrid(img, 100, board);
+
+        EXPECT_GT(quality, 0.8) << "angle " << angles[a];
+        ASSERT_EQ(board.getNumCells(), size_t(NUMBER_OF_CELLS)) << "angle " << angles[a];
+
+        // Canonical orientation: the axis closest to the x axis of the image
+        double t = angles[a];
+        while (t >=  45.0) { t -= 90.0; }
+        while (t <  -45.0) { t += 90.0; }
+        std::vector<cv::Point2d> expected = drawRotatedBoard(img, cv::Point2d(250, 200), t, 60, 48);
+
+        for (size_t i = 0; i < board.getNumCells(); ++i)
+        {
+            cv::Point c = board.getCellCentroid(i);
+            EXPECT_NEAR(c.x, expected[i].x, 2.0) << "cell " << i << " angle " << angles[a];
+            EXPECT_NEAR(c.y, expected[i].y, 2.0) << "cell " << i << " angle " << angles[a];
+        }
+    }
+
+    // Not enough cells
+    cv::Mat img = cv::Mat::zeros(400, 500, CV_8UC1);
+    cv::rectangle(img, cv::Rect(100, 100, 48, 48), cv::Scalar(255), CV_FILLED);
+
+    Board board;
+    EXPECT_EQ(fitBoardGrid(img, 100, board), 0.0);
+    EXPECT_EQ(board.getNumCells(), size_t(0));
+}
+
+TEST(VisionUtils, testThresholder)
+{
+    EXPECT_EQ(Thresholder::modeFromString("fixed"),    THRESH_MODE_FIXED);
+    EXPECT_EQ(Thresholder::modeFromString("otsu"),     THRESH_MODE_OTSU);
+    EXPECT_EQ(Thresholder::modeFromString("adaptive"), THRESH_MODE_ADAPTIVE);
+    EXPECT_EQ(Thresholder::modeFromString("foo"),      THRESH_MODE_FIXED);
+
+    // A board under a spotlight: the illumination goes from 10% on the left to 100% on the right
+    cv::Mat img(400, 500, CV_8UC1, cv::Scalar(120));
+    cv::rectangle(img, cv::Rect(140, 90, 220, 220), cv::Scalar(30), CV_FILLED);
+
+    cv::Mat cells = cv::Mat::zeros(img.size(), CV_8UC1);
+    drawRotatedBoard(cells, cv::Point2d(250, 200), 0.0, 60, 48);
+    img.setTo(cv::Scalar(220), cells);
+
+    for (int y = 0; y < img.rows; ++y)
+    {
+        uint8_t *p = img.ptr<uint8_t>(y);
+        for (int x = 0; x < img.cols; ++x)
+        {
+            double r = double(x) / (img.cols - 1);
+            p[x] = uint8_t(p[x] * (0.1 + 0.9 * r * r) + 0.5);
+        }
+    }
+
+    cv::Mat binary;
+    Board board;
+
+    // The fixed threshold loses the cells in the shadow
+    Thresholder fixed(THRESH_MODE_FIXED, 100);
+    EXPECT_EQ(fixed.apply(img, binary), 100);
+    EXPECT_EQ(fitBoardGrid(binary, 100, board), 0.0);
+
+    // The adaptive one finds all of them
+    Thresholder adaptive(THRESH_MODE_ADAPTIVE, 100, 61, 10);
+    EXPECT_LT(adaptive.apply(img, binary), 0);
+    EXPECT_GT(fitBoardGrid(binary, 100, board), 0.8);
+    EXPECT_EQ(board.getNumCells(), size_t(NUMBER_OF_CELLS));
+
+    // Otsu's threshold is computed on the region of interest only
+    cv::Mat bimodal(100, 100, CV_8UC1, cv::Scalar(40));
+    bimodal(cv::Rect(0, 0, 50, 100)).setTo(cv::Scalar(200));
+    bimodal(cv::Rect(0, 0, 10, 10)).setTo(cv::Scalar(255));
+
+    Thresholder otsu(THRESH_MODE_OTSU);
+    double thres = otsu.apply(bimodal, binary);
+    EXPECT_GE(thres,  40);
+    EXPECT_LT(thres, 200);
+    EXPECT_EQ(cv::countNonZero(binary), 50 * 100);
+
+    otsu.setRoi(cv::Rect(0, 0, 20, 20));
+    thres = otsu.apply(bimodal, binary);
+    EXPECT_GE(thres, 200);
+    EXPECT_EQ(cv::countNonZero(binary), 10 * 10);
+}
+
+TEST(VisionUtils, testThresholderUniformRegion)
+{
+    // The hand camera sees the black border of the board as a large uniform region,
+    // much wider than half a window, on a bright table
+    cv::Mat img(300, 300, CV_8UC1, cv::Scalar(200));
+    cv::Rect black(60, 60, 180, 180);
+    img(black).setTo(cv::Scalar(20));
+
+    cv::Mat binary;
+
+    // Default settings of the controller
+    Thresholder fixed(THRESH_MODE_FIXED, 55);
+    fixed.apply(img, binary);
+    EXPECT_EQ(cv::countNonZero(binary(black)), 0);
+    EXPECT_EQ(cv::countNonZero(binary), 300 * 300 - black.area());
+
+    // The adaptive threshold falls back to the fixed value where the window has no contrast,
+    // so the inside of the region does not drop out of the black mask
+    Thresholder adaptive(THRESH_MODE_ADAPTIVE, 55, 61, 10);
+    adaptive.apply(img, binary);
+    EXPECT_EQ(cv::countNonZero(binary(black)), 0);
+    EXPECT_EQ(cv::countNonZero(binary), 300 * 300 - black.area());
+
+    // Without the fallback, most of the region would be lost
+    Thresholder no_contrast(THRESH_MODE_ADAPTIVE, 55, 61, 10, 0.0);
+    no_contrast.apply(img, binary);
+    EXPECT_GT(cv::countNonZero(binary(black)), black.area() / 2);
+}
+
+TEST(VisionUtils, testBinaryMorphology)
+{
+    cv::RNG rng(7);
+
+    // Random masks, with widths that are and are not multiples of the word size
+    int sizes[][2] = {{1, 1}, {5, 64}, {37, 130}, {120, 161}};
+
+    for (size_t t = 0; t < sizeof(sizes) / sizeof(sizes[0]); ++t)
+    {
+        cv::Mat src(sizes[t][0], sizes[t][1], CV_8UC1);
+        rng.fill(src, cv::RNG::UNIFORM, 0, 2);
+        src *= 255;
+
+        int ops[] = {cv::MORPH_ERODE,  cv::MORPH_ERODE,  cv::MORPH_DILATE, cv::MORPH_DILATE,
+                     cv::MORPH_DILATE, cv::MORPH_DILATE, cv::MORPH_ERODE,  cv::MORPH_ERODE};
+        std::vector<int> seq(ops, ops + 8);
+
+        // The same chain with OpenCV, one operation at a time
+        cv::Mat expected = src.clone();
+        for (size_t i = 0; i < seq.size(); ++i)
+        {
+            if (seq[i] == cv::MORPH_ERODE) { cv::erode (expected, expected, cv::Mat()); }
+            else                           { cv::dilate(expected, expected, cv::Mat()); }
+        }
+
+        for (int tile = 1; tile <= 64; tile *= 4)
+        {
+            cv::Mat dst;
+            binaryMorphology(src, dst, seq, tile);
+            EXPECT_EQ(cv::countNonZero(dst != expected), 0) << "size " << t << " tile " << tile;
+        }
+
+        // In place
+        cv::Mat inplace = src.clone();
+        binaryMorphology(inplace, inplace, seq);
+        EXPECT_EQ(cv::countNonZero(inplace != expected), 0) << "size " << t;
+    }
+}
+
+TEST(VisionUtils, testCountSmoothedArea)
+{
+    cv::RNG rng(11);
+
+    cv::Mat bin(60, 80, CV_8UC1);
+    rng.fill(bin, cv::RNG::UNIFORM, 0, 2);
+    bin *= 255;
+
+    Board board = squareBoard(0, 5, 20, 4);
+    cv::Mat buf;
+
+    for (size_t i = 0; i < board.getNumCells(); ++i)
+    {
+        Cell &cell = board.getCell(i);
+
+        // The former chain: mask the cell, blur it, and count the nonzero pixels
+        cv::Mat crop = cell.maskImage(bin);
+        cv::GaussianBlur(crop.clone(), crop, cv::Size(3,3), 0, 0);
+        int expected = cv::countNonZero(crop);
+
+        cv::Rect rect = cv::boundingRect(cell.getContour().getMat());
+        cv::Mat mask  = cv::Mat::zeros(rect.size(), CV_8UC1);
+        cv::drawContours(mask, Contours(1, cell.getContour().toContour()), -1, cv::Scalar(255), CV_FILLED, 8,
+                         cv::noArray(), INT_MAX, -rect.tl());
+
+        EXPECT_EQ(countSmoothedArea(bin, rect, mask, buf), expected) << "cell " << i;
+    }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}